@@ -8,6 +8,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/timers.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_bt.h"
@@ -19,40 +21,38 @@
 #include "connection.h"
 #include "hid_report_data.h"
 #include "vmon.h"
+#include "latency.h"
+#include "boot_trace.h"
+#include "conn_policy.h"
+#include "reconnect.h"
+#include "mouse_coalescer.h"
 
 #define BLE_STATS_INTERVAL_SEC 1
-#define HIGH_SPEED_DEVICE_THRESHOLD_MS 6
-#define HIGH_SPEED_DEVICE_THRESHOLD_EVENTS 5
 #define BATTERY_UPDATE_INTERVAL_MS 10000
+#define DEFAULT_CONN_INTERVAL_US 7500 // what we request on connect, until the central tells otherwise
 
 static const char *TAG = "BLE_HID";
 static uint16_t s_current_rps = 0;
 static TaskHandle_t s_stats_task_handle = NULL;
 static uint16_t s_conn_id = 0;
 static bool s_connected = false;
-static bool s_is_high_speed = false;
+static uint16_t s_sent_consumer = 0; // control usages the host has seen pressed on this connection
+static uint16_t s_sent_system = 0;
 static int s_reconnect_delay = 3;
-static int64_t s_last_event_time = 0;
-static int s_fast_events_count = 0;
-static int s_batch_count = 0;
-static TimerHandle_t s_accumulator_timer = NULL;
 static TimerHandle_t s_battery_timer = NULL;
-static int16_t s_acc_x = 0;
-static int16_t s_acc_y = 0;
-static int8_t s_acc_wheel = 0;
-static int8_t s_acc_pan = 0;
-static uint8_t s_acc_buttons = 0;
-static uint8_t s_batch_size = 3;
 static bool g_enabled = true;
-typedef enum {
-    SPEED_MODE_SLOW = 0,
-    SPEED_MODE_FAST,
-    SPEED_MODE_VERYFAST
-} speed_mode_t;
 
+// Mouse motion coalescer: at most one merged report per emit period, flushed right away on button changes.
+// s_mouse_mutex is held from taking a snapshot until it is sent, so the forwarding path and s_flush_timer
+// can't reorder notifications.
+static esp_timer_handle_t s_flush_timer = NULL;
+static SemaphoreHandle_t s_mouse_mutex = NULL;
+static StaticSemaphore_t s_mouse_mutex_buffer;
+static uint32_t s_conn_interval_us = DEFAULT_CONN_INTERVAL_US;
+static mouse_coalescer_t s_acc = {0};
 static esp_ble_addr_type_t s_connected_device_addr_type = BLE_ADDR_TYPE_PUBLIC;
 static esp_bd_addr_t s_connected_device_addr;
-static speed_mode_t s_high_speed_submode = SPEED_MODE_SLOW;
+static bool s_settings_subscribed = false;
 static uint8_t hidd_service_uuid128[] = {
     /* LSB <--------------------------------------------------------------------------------> MSB */
     // first uuid, 16bit, [12],[13] is the value
@@ -93,26 +93,24 @@ uint16_t ble_conn_id() {
 }
 
 static void update_tx_power(void) {
-    char tx_power_str[10];
+    const char *tx_power_str = storage_settings()->connectivity.ble_tx_power;
     esp_power_level_t power_level = ESP_PWR_LVL_N0;
-    if (storage_get_string_setting("connectivity.bleTxPower", tx_power_str, sizeof(tx_power_str)) == ESP_OK) {
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "BLE TX power setting: %s", tx_power_str);
-        }
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "BLE TX power setting: %s", tx_power_str);
+    }
 
-        if (strcmp(tx_power_str, "n6") == 0) {
-            power_level = ESP_PWR_LVL_N6;
-        } else if (strcmp(tx_power_str, "n3") == 0) {
-            power_level = ESP_PWR_LVL_N3;
-        } else if (strcmp(tx_power_str, "n0") == 0) {
-            power_level = ESP_PWR_LVL_N0;
-        } else if (strcmp(tx_power_str, "p3") == 0) {
-            power_level = ESP_PWR_LVL_P3;
-        } else if (strcmp(tx_power_str, "p6") == 0) {
-            power_level = ESP_PWR_LVL_P6;
-        } else if (strcmp(tx_power_str, "p9") == 0) {
-            power_level = ESP_PWR_LVL_P9;
-        }
+    if (strcmp(tx_power_str, "n6") == 0) {
+        power_level = ESP_PWR_LVL_N6;
+    } else if (strcmp(tx_power_str, "n3") == 0) {
+        power_level = ESP_PWR_LVL_N3;
+    } else if (strcmp(tx_power_str, "n0") == 0) {
+        power_level = ESP_PWR_LVL_N0;
+    } else if (strcmp(tx_power_str, "p3") == 0) {
+        power_level = ESP_PWR_LVL_P3;
+    } else if (strcmp(tx_power_str, "p6") == 0) {
+        power_level = ESP_PWR_LVL_P6;
+    } else if (strcmp(tx_power_str, "p9") == 0) {
+        power_level = ESP_PWR_LVL_P9;
     }
 
     esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_DEFAULT, power_level);
@@ -170,11 +168,7 @@ static void hidd_event_callback(const esp_hidd_cb_event_t event, esp_hidd_cb_par
     switch (event) {
         case ESP_HIDD_EVENT_REG_FINISH: {
             if (param->init_finish.state == ESP_HIDD_INIT_OK) {
-                char device_name[32];
-                if (storage_get_string_setting("deviceInfo.name", device_name, sizeof(device_name)) != ESP_OK) {
-                    strcpy(device_name, DEVICE_NAME);
-                }
-                esp_ble_gap_set_device_name(device_name);
+                esp_ble_gap_set_device_name(storage_settings()->device_info.name);
                 esp_ble_gap_config_adv_data(&hidd_adv_data);
             }
             break;
@@ -187,7 +181,12 @@ static void hidd_event_callback(const esp_hidd_cb_event_t event, esp_hidd_cb_par
             update_tx_power();
             save_connected_device(param->connect.remote_bda, s_connected_device_addr_type);
             s_conn_id = param->connect.conn_id;
+            s_sent_consumer = 0;
+            s_sent_system = 0;
             s_connected = true;
+            conn_policy_on_connect(param->connect.remote_bda);
+            reconnect_on_connect();
+            boot_trace_mark(BOOT_PHASE_BLE_CONNECTED);
 
             // Start battery level updates when connected
             if (s_battery_timer == NULL) {
@@ -209,8 +208,10 @@ static void hidd_event_callback(const esp_hidd_cb_event_t event, esp_hidd_cb_par
                 xTimerStop(s_battery_timer, 0);
             }
 
-            vTaskDelay(pdMS_TO_TICKS(s_reconnect_delay * 1000));
-            esp_ble_gap_start_advertising(&hidd_adv_params);
+            s_conn_interval_us = DEFAULT_CONN_INTERVAL_US;
+            conn_policy_on_disconnect();
+
+            reconnect_start(s_reconnect_delay * 1000);
             break;
         }
         case ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT: {
@@ -232,11 +233,30 @@ static void gap_event_handler(const esp_gap_ble_cb_event_t event, esp_ble_gap_cb
 
     switch (event) {
         case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
-            esp_ble_gap_start_advertising(&hidd_adv_params);
+            if (!reconnect_active()) {
+                esp_ble_gap_start_advertising(&hidd_adv_params);
+            }
+            break;
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+            reconnect_on_adv_started(param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS);
             break;
         case ESP_GAP_BLE_SEC_REQ_EVT:
             esp_ble_gap_security_rsp(param->ble_security.ble_req.bd_addr, true);
             break;
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+            conn_policy_on_params_updated(param->update_conn_params.status == ESP_BT_STATUS_SUCCESS,
+                                          param->update_conn_params.conn_int);
+            if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+                s_conn_interval_us = param->update_conn_params.conn_int * 1250;
+
+                if (VERBOSE) {
+                    ESP_LOGI(TAG, "Connection interval = %luus, latency = %d, timeout = %dms", s_conn_interval_us,
+                             param->update_conn_params.latency, param->update_conn_params.timeout * 10);
+                }
+            } else {
+                ESP_LOGW(TAG, "Connection parameters update rejected, status = %d", param->update_conn_params.status);
+            }
+            break;
         case ESP_GAP_BLE_AUTH_CMPL_EVT:
             esp_bd_addr_t bd_addr;
             memcpy(bd_addr, param->ble_security.auth_cmpl.bd_addr, sizeof(esp_bd_addr_t));
@@ -276,6 +296,7 @@ static void gap_event_handler(const esp_gap_ble_cb_event_t event, esp_ble_gap_cb
 static void ble_stats_task(void *arg) {
     TickType_t last_wake_time = xTaskGetTickCount();
     uint16_t s_prev_rps = 0;
+    latency_stats_t latency;
     while (1) {
         if (!s_connected) {
             vTaskDelay(pdMS_TO_TICKS(100));
@@ -285,7 +306,9 @@ static void ble_stats_task(void *arg) {
         const uint32_t reports_per_sec = (s_current_rps - s_prev_rps) / BLE_STATS_INTERVAL_SEC;
         if (reports_per_sec > 0) {
             if (VERBOSE) {
-                ESP_LOGI(TAG, "BLE: %lu rps", reports_per_sec);
+                latency_get_stats(&latency);
+                ESP_LOGI(TAG, "BLE: %lu rps, latency p50 = %luus, p99 = %luus, max = %luus (n = %lu)",
+                         reports_per_sec, latency.p50_us, latency.p99_us, latency.max_us, latency.count);
             }
 
             if (esp_bt_controller_is_sleeping()) {
@@ -298,17 +321,49 @@ static void ble_stats_task(void *arg) {
     }
 }
 
-static void accumulator_timer_callback(TimerHandle_t timer) {
-    if (s_acc_x != 0 || s_acc_y != 0 || s_acc_wheel != 0 || s_acc_pan != 0 || s_acc_buttons != 0) {
-        esp_hidd_send_mouse_value(s_conn_id, s_acc_buttons, s_acc_x, s_acc_y, s_acc_wheel, s_acc_pan);
-        s_acc_x = 0;
-        s_acc_y = 0;
-        s_acc_wheel = 0;
-        s_acc_pan = 0;
+static IRAM_ATTR void send_mouse_snapshot(const mouse_snapshot_t *snapshot) {
+    esp_hidd_send_mouse_value(s_conn_id, snapshot->buttons, snapshot->x, snapshot->y, snapshot->wheel, snapshot->pan);
+    latency_record(snapshot->timestamp_us);
+    boot_trace_mark(BOOT_PHASE_FIRST_BLE_NOTIFY);
+    s_current_rps++;
+}
+
+// One notification per connection event. conn_policy picks the interval for the current traffic,
+// a 1000 Hz mouse gets the 7.5 ms fast tier and a slower mouse isn't coalesced at all.
+static IRAM_ATTR uint32_t emit_period_us(void) {
+    return s_conn_interval_us;
+}
+
+static void flush_timer_callback(void *arg) {
+    mouse_snapshot_t snapshot;
+
+    // A report that got the mutex first has already sent what was pending, then there is nothing to flush
+    xSemaphoreTake(s_mouse_mutex, portMAX_DELAY);
+    if (mouse_coalescer_flush(&s_acc, esp_timer_get_time(), &snapshot)) {
+        if (s_connected) {
+            send_mouse_snapshot(&snapshot);
+        }
+        if (s_acc.pending) {
+            esp_timer_start_once(s_flush_timer, emit_period_us());
+        }
+    }
+    xSemaphoreGive(s_mouse_mutex);
+}
+
+static void apply_link_settings(const settings_t *settings) {
+    s_reconnect_delay = settings->connectivity.ble_rec_delay;
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "BLE reconnect delay set to %d seconds", s_reconnect_delay);
     }
 }
 
-static TickType_t acc_window = pdMS_TO_TICKS(8);
+static void on_settings_changed(const settings_t *settings, const settings_t *previous) {
+    apply_link_settings(settings);
+
+    if (is_ble_enabled() && g_enabled && strcmp(settings->connectivity.ble_tx_power, previous->connectivity.ble_tx_power) != 0) {
+        update_tx_power();
+    }
+}
 
 esp_err_t ble_hid_device_init() {
     g_enabled = true;
@@ -321,40 +376,34 @@ esp_err_t ble_hid_device_init() {
     }
     ESP_ERROR_CHECK(ret);
 
-    char mode_str[16] = {0};
-    storage_get_string_setting("power.warpSpeed", mode_str, sizeof(mode_str));
-    if (mode_str[0] == 'f') {
-        s_high_speed_submode = SPEED_MODE_FAST;
-    } else if (mode_str[0] == 'v') {
-        s_high_speed_submode = SPEED_MODE_VERYFAST;
-    } else {
-        s_high_speed_submode = SPEED_MODE_SLOW;
+    apply_link_settings(storage_settings());
+    if (!s_settings_subscribed) {
+        s_settings_subscribed = storage_subscribe(on_settings_changed) == ESP_OK;
     }
 
-    // careful with this values
-    // wrong combination = "choppy" feeling
-    switch (s_high_speed_submode) {
-        case SPEED_MODE_VERYFAST:
-            s_batch_size = 3;
-            acc_window = pdMS_TO_TICKS(4);
-            break;
-        case SPEED_MODE_FAST:
-            s_batch_size = 5;
-            acc_window = pdMS_TO_TICKS(7);
-            break;
-        default:
-            s_batch_size = 7;
-            acc_window = pdMS_TO_TICKS(11);
-            break;
+    if (s_mouse_mutex == NULL) {
+        s_mouse_mutex = xSemaphoreCreateMutexStatic(&s_mouse_mutex_buffer);
+    }
+    if (s_flush_timer == NULL) {
+        const esp_timer_create_args_t flush_timer_args = {
+            .callback = flush_timer_callback,
+            .name = "mouse_flush",
+        };
+        ret = esp_timer_create(&flush_timer_args, &s_flush_timer);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create mouse flush timer: %s", esp_err_to_name(ret));
+            return ret;
+        }
     }
 
-    int reconnect_delay;
-    if (storage_get_int_setting("connectivity.bleRecDelay", &reconnect_delay) == ESP_OK) {
-        s_reconnect_delay = reconnect_delay;
+    ret = conn_policy_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "BLE reconnect delay set to %d seconds", s_reconnect_delay);
-        }
+    ret = reconnect_init();
+    if (ret != ESP_OK) {
+        return ret;
     }
 
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
@@ -412,12 +461,26 @@ esp_err_t ble_hid_device_init() {
     return ESP_OK;
 }
 
+esp_err_t ble_hid_device_set_idle(const bool idle) {
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return conn_policy_set_idle(idle);
+}
+
 esp_err_t ble_hid_device_deinit(void) {
     g_enabled = false;
-    if (s_accumulator_timer != NULL) {
-        xTimerDelete(s_accumulator_timer, 0);
-        s_accumulator_timer = NULL;
+    conn_policy_deinit();
+    reconnect_deinit();
+    if (s_flush_timer != NULL) {
+        esp_timer_stop(s_flush_timer);
+        esp_timer_delete(s_flush_timer);
+        s_flush_timer = NULL;
     }
+    xSemaphoreTake(s_mouse_mutex, portMAX_DELAY);
+    mouse_coalescer_reset(&s_acc);
+    xSemaphoreGive(s_mouse_mutex);
 
     if (s_battery_timer != NULL) {
         xTimerDelete(s_battery_timer, 0);
@@ -453,10 +516,7 @@ esp_err_t ble_hid_device_deinit(void) {
 }
 
 esp_err_t ble_hid_device_start_advertising(void) {
-    char device_name[32];
-    if (storage_get_string_setting("deviceInfo.name", device_name, sizeof(device_name)) != ESP_OK) {
-        strcpy(device_name, DEVICE_NAME);
-    }
+    const char *device_name = storage_settings()->device_info.name;
 
     if (VERBOSE) {
         ESP_LOGI(TAG, "Advertising with device name: %s", device_name);
@@ -477,91 +537,119 @@ IRAM_ATTR bool ble_hid_device_connected(void) {
     return s_connected;
 }
 
-static bool check_high_speed_device() {
-    if (s_is_high_speed == true) {
-        return true;
+// Keys beyond the NKRO bitmap, sent through the 6KRO report while NKRO is active
+static void collect_nkro_overflow(const keyboard_report_t *report, uint8_t *keycodes) {
+    uint8_t count = 0;
+    memset(keycodes, 0, 6);
+
+    for (uint16_t byte = (HID_NKRO_MAX_USAGE + 1) / 8; byte < KEYBOARD_KEY_BITMAP_LEN && count < 6; byte++) {
+        uint8_t bits = report->key_bitmap[byte];
+        while (bits && count < 6) {
+            const uint8_t bit = __builtin_ctz(bits);
+            keycodes[count++] = byte * 8 + bit;
+            bits &= bits - 1;
+        }
     }
+}
 
-    const int64_t current_time = esp_timer_get_time() / 1000;
-    if (s_last_event_time > 0) {
-        const int64_t delay = current_time - s_last_event_time;
-        if (delay < HIGH_SPEED_DEVICE_THRESHOLD_MS) {
-            s_fast_events_count++;
-            if (s_fast_events_count >= HIGH_SPEED_DEVICE_THRESHOLD_EVENTS) {
-                if (VERBOSE) {
-                    ESP_LOGI(TAG, "High speed device detected");
-                }
+esp_err_t ble_hid_device_send_keyboard_report(const keyboard_report_t *report) {
+    static const uint8_t no_keys[KEYBOARD_KEY_BITMAP_LEN] = {0};
+    static uint8_t last_overflow[6] = {0};
+    static bool nkro_active = false;
 
-                s_is_high_speed = true;
-            }
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    conn_policy_record_report(false);
+
+    const bool nkro = hidd_nkro_enabled();
+    if (nkro != nkro_active) {
+        // Release everything held through the report we are switching away from
+        if (nkro_active) {
+            esp_hidd_send_nkro_value(s_conn_id, 0, no_keys);
         } else {
-            s_fast_events_count = 0;
+            esp_hidd_send_keyboard_value(s_conn_id, 0, no_keys);
+        }
+        memset(last_overflow, 0, sizeof(last_overflow));
+        nkro_active = nkro;
+    }
+
+    s_current_rps++;
+    if (nkro) {
+        uint8_t overflow[6];
+        collect_nkro_overflow(report, overflow);
+        esp_hidd_send_nkro_value(s_conn_id, report->modifier, report->key_bitmap);
+        if (memcmp(overflow, last_overflow, sizeof(overflow)) != 0) {
+            esp_hidd_send_keyboard_value(s_conn_id, 0, overflow);
+            memcpy(last_overflow, overflow, sizeof(overflow));
         }
+    } else {
+        esp_hidd_send_keyboard_value(s_conn_id, report->modifier, report->keycodes);
     }
-    s_last_event_time = current_time;
-    return s_is_high_speed;
+
+    latency_record(report->timestamp_us);
+    boot_trace_mark(BOOT_PHASE_FIRST_BLE_NOTIFY);
+    return ESP_OK;
 }
 
-esp_err_t ble_hid_device_send_keyboard_report(const keyboard_report_t *report) {
+esp_err_t ble_hid_device_send_consumer_report(const uint16_t usage) {
     if (!s_connected) {
         return ESP_ERR_INVALID_STATE;
     }
+    if (usage == s_sent_consumer) {
+        return ESP_OK;
+    }
+    conn_policy_record_report(false);
 
     s_current_rps++;
-    esp_hidd_send_keyboard_value(s_conn_id, report->modifier, report->keycodes);
+    esp_hidd_send_consumer_value(s_conn_id, usage);
+    s_sent_consumer = usage;
     return ESP_OK;
 }
 
-// goal is to map any high (up to 1000hz) report rate to any lower BLE report rate
-IRAM_ATTR esp_err_t ble_hid_device_send_mouse_report(const mouse_report_t *report) {
+esp_err_t ble_hid_device_send_system_report(const uint16_t usage) {
     if (!s_connected) {
         return ESP_ERR_INVALID_STATE;
     }
+    if (usage == s_sent_system) {
+        return ESP_OK;
+    }
+    conn_policy_record_report(false);
 
-    if (check_high_speed_device()) {
-        if (s_accumulator_timer == NULL) {
-            s_accumulator_timer = xTimerCreate("acc_timer", acc_window, pdTRUE, NULL, accumulator_timer_callback);
-            xTimerStart(s_accumulator_timer, 0);
-        }
+    s_current_rps++;
+    esp_hidd_send_system_control_value(s_conn_id, usage);
+    s_sent_system = usage;
+    return ESP_OK;
+}
 
-        if (s_acc_buttons != report->buttons || s_batch_count >= s_batch_size) {
-            esp_hidd_send_mouse_value(s_conn_id, report->buttons, s_acc_x, s_acc_y, s_acc_wheel, s_acc_pan);
-            s_current_rps++;
-            s_acc_buttons = report->buttons;
-            if (s_batch_count >= s_batch_size) {
-                s_acc_x = 0;
-                s_acc_y = 0;
-                s_acc_wheel = 0;
-                s_acc_pan = 0;
-                s_batch_count = 0;
-            }
+// Maps any USB report rate (up to 1000 Hz) to at most one motion report per connection event.
+// Nothing is dropped: deltas received in between are merged and flushed by s_flush_timer.
+IRAM_ATTR esp_err_t ble_hid_device_send_mouse_report(const mouse_report_t *report) {
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    conn_policy_record_report(true);
 
-            xTimerReset(s_accumulator_timer, 0);
-            return ESP_OK;
-        }
+    const int64_t now = esp_timer_get_time();
+    const uint32_t period = emit_period_us();
+    mouse_snapshot_t snapshots[MOUSE_COALESCER_MAX_OUT];
 
-        s_acc_buttons = report->buttons;
-        s_acc_x += report->x;
-        s_acc_y += report->y;
-        s_acc_wheel += report->wheel;
-        s_acc_pan += report->pan;
-        s_batch_count++;
-    } else {
-        esp_hidd_send_mouse_value(s_conn_id, report->buttons, report->x, report->y, report->wheel, report->pan);
-        s_current_rps++;
-
-        if (s_accumulator_timer != NULL) {
-            xTimerDelete(s_accumulator_timer, 0);
-            s_accumulator_timer = NULL;
-            s_acc_buttons = 0;
-            s_acc_x = 0;
-            s_acc_y = 0;
-            s_acc_wheel = 0;
-            s_acc_pan = 0;
-
-            return ESP_OK;
-        }
+    xSemaphoreTake(s_mouse_mutex, portMAX_DELAY);
+    const uint8_t emit = mouse_coalescer_add(&s_acc, report->buttons, report->x, report->y, report->wheel, report->pan,
+                                             report->timestamp_us, now, period, snapshots);
+    if (emit > 0) {
+        esp_timer_stop(s_flush_timer);
+    }
+    for (uint8_t i = 0; i < emit; i++) {
+        send_mouse_snapshot(&snapshots[i]);
+    }
+
+    // Motion that didn't fit (or wasn't due yet) goes out at the next emit slot
+    const int64_t next_emit_us = s_acc.last_emit_us + period;
+    if (s_acc.pending && !esp_timer_is_active(s_flush_timer)) {
+        esp_timer_start_once(s_flush_timer, next_emit_us > now ? next_emit_us - now : 0);
     }
+    xSemaphoreGive(s_mouse_mutex);
 
     return ESP_OK;
 }
@@ -3,17 +3,23 @@
 #include <stdbool.h>
 #include "esp_err.h"
 
+#define KEYBOARD_KEY_BITMAP_LEN 32
+
 typedef struct {
     uint8_t modifier;
-    uint8_t keycodes[6];
+    uint8_t keycodes[6];                         // first six pressed keys, used for the 6KRO report
+    uint8_t key_bitmap[KEYBOARD_KEY_BITMAP_LEN]; // every pressed key, bit n is keyboard usage n
+    int64_t timestamp_us; // USB capture time, 0 if not from USB
 } keyboard_report_t;
 
+// Deltas are wide on purpose, anything beyond the BLE report range is carried over to the next notification
 typedef struct {
     uint8_t buttons;
-    uint16_t x;
-    uint16_t y;
-    int8_t wheel;
-    int8_t pan;
+    int32_t x;
+    int32_t y;
+    int32_t wheel;
+    int32_t pan;
+    int64_t timestamp_us; // USB capture time, 0 if not from USB
 } mouse_report_t;
 
 /**
@@ -42,6 +48,9 @@ bool ble_hid_device_connected(void);
 
 /**
  * @brief Send keyboard report
+ *
+ * Uses the NKRO report when the host subscribed to it, the 6KRO one otherwise.
+ *
  * @param report Keyboard report structure
  * @return ESP_OK on success
  */
@@ -54,6 +63,31 @@ esp_err_t ble_hid_device_send_keyboard_report(const keyboard_report_t *report);
  */
 esp_err_t ble_hid_device_send_mouse_report(const mouse_report_t *report);
 
+/**
+ * @brief Send consumer control report, no-op if the host already has this state
+ * @param usage Pressed Consumer page usage, 0 for none
+ * @return ESP_OK on success
+ */
+esp_err_t ble_hid_device_send_consumer_report(uint16_t usage);
+
+/**
+ * @brief Send system control report, no-op if the host already has this state
+ * @param usage Pressed Generic Desktop system control usage, 0 for none
+ * @return ESP_OK on success
+ */
+esp_err_t ble_hid_device_send_system_report(uint16_t usage);
+
+/**
+ * @brief Switch the link between the keep-alive idle and the active connection parameters
+ *
+ * Idle keeps the bond and connection on a long interval with slave latency, so resuming
+ * only takes a parameter update instead of a full stack restart and reconnect.
+ *
+ * @param idle true for idle parameters, false for the ones requested on connect
+ * @return ESP_OK if the update was requested, ESP_ERR_INVALID_STATE if not connected
+ */
+esp_err_t ble_hid_device_set_idle(bool idle);
+
 /**
  * @brief Current connection ID or UINT16_MAX if not connected
  */
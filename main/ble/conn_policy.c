@@ -0,0 +1,245 @@
+#include "conn_policy.h"
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_gap_ble_api.h"
+#include "freertos/FreeRTOS.h"
+#include "const.h"
+#include "hid_device_le_prf.h"
+
+#define POLICY_WINDOW_MS 500
+#define FAST_MOUSE_RPS 20   // pointer motion that asks for the shortest interval
+#define NORMAL_INPUT_RPS 2  // anything below only counts as occasional keystrokes
+#define RELAX_WINDOWS 6     // consecutive quieter windows before stepping one tier slower
+#define TYPING_WINDOWS 2    // consecutive busier windows before keystrokes speed the link up
+#define REQUEST_TIMEOUT_US (5 * 1000 * 1000)
+#define REJECT_BACKOFF_US (10 * 1000 * 1000)
+
+static const char *TAG = "CONN_POLICY";
+
+typedef struct {
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t timeout;
+} conn_tier_params_t;
+
+// Interval x 1.25ms, timeout x 10ms. Slave latency doesn't delay input: the peripheral may still
+// transmit on any connection event, it only lets the radio skip events while there is nothing to send.
+static const conn_tier_params_t s_tiers[CONN_TIER_MAX] = {
+    [CONN_TIER_FAST] = { HIDD_CONN_ACTIVE_INTERVAL, HIDD_CONN_ACTIVE_INTERVAL, HIDD_CONN_ACTIVE_LATENCY, HIDD_CONN_ACTIVE_TIMEOUT },
+    [CONN_TIER_NORMAL] = { 0x09, 0x0C, 2, 0xA0 },  // 11.25-15ms
+    [CONN_TIER_RELAXED] = { 0x18, 0x24, 4, 0xC8 }, // 30-45ms
+    [CONN_TIER_IDLE] = { 0x48, 0x54, 4, 0x190 },   // 90-105ms, within Apple's accessory guidelines
+};
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_timer = NULL;
+static esp_bd_addr_t s_peer;
+static bool s_connected = false;
+static bool s_idle = false;
+static conn_tier_t s_tier = CONN_TIER_FAST;
+static conn_tier_t s_requested = CONN_TIER_FAST;
+static bool s_pending = false;
+static int64_t s_pending_since = 0;
+static int64_t s_retry_after = 0;
+static uint8_t s_quiet_windows = 0;
+static uint8_t s_busy_windows = 0;
+
+static uint32_t s_mouse_reports = 0;
+static uint32_t s_key_reports = 0;
+
+static conn_tier_t tier_for_interval(const uint16_t interval) {
+    for (int tier = 0; tier < CONN_TIER_MAX; tier++) {
+        if (interval <= s_tiers[tier].max_int) {
+            return tier;
+        }
+    }
+    return CONN_TIER_IDLE;
+}
+
+// Caller holds s_lock and submits the request after releasing it
+static void begin_request(const conn_tier_t tier, esp_ble_conn_update_params_t *params) {
+    memcpy(params->bda, s_peer, sizeof(esp_bd_addr_t));
+    params->min_int = s_tiers[tier].min_int;
+    params->max_int = s_tiers[tier].max_int;
+    params->latency = s_tiers[tier].latency;
+    params->timeout = s_tiers[tier].timeout;
+
+    s_requested = tier;
+    s_pending = true;
+    s_pending_since = esp_timer_get_time();
+}
+
+static esp_err_t submit_request(esp_ble_conn_update_params_t *params) {
+    const esp_err_t err = esp_ble_gap_update_conn_params(params);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to request connection parameters: %s", esp_err_to_name(err));
+        taskENTER_CRITICAL(&s_lock);
+        s_pending = false;
+        taskEXIT_CRITICAL(&s_lock);
+    }
+    return err;
+}
+
+// Pointer motion takes the fast tier after a single busy window, keystrokes only speed the link up
+// once typing keeps going for TYPING_WINDOWS. Slower tiers are taken one step at a time after
+// RELAX_WINDOWS quiet windows, so stray keys and pauses in typing don't make the link flap.
+static void evaluate_timer_callback(void *arg) {
+    const uint32_t mouse = __atomic_exchange_n(&s_mouse_reports, 0, __ATOMIC_RELAXED);
+    const uint32_t keys = __atomic_exchange_n(&s_key_reports, 0, __ATOMIC_RELAXED);
+    const uint32_t mouse_rps = mouse * 1000 / POLICY_WINDOW_MS;
+    const uint32_t input_rps = (mouse + keys) * 1000 / POLICY_WINDOW_MS;
+    const conn_tier_t wanted = mouse_rps >= FAST_MOUSE_RPS ? CONN_TIER_FAST :
+                               input_rps >= NORMAL_INPUT_RPS ? CONN_TIER_NORMAL : CONN_TIER_RELAXED;
+
+    const int64_t now = esp_timer_get_time();
+    esp_ble_conn_update_params_t params;
+    bool request = false;
+    conn_tier_t from = CONN_TIER_FAST;
+    conn_tier_t to = CONN_TIER_FAST;
+
+    taskENTER_CRITICAL(&s_lock);
+    if (s_pending && now - s_pending_since > REQUEST_TIMEOUT_US) {
+        s_pending = false;
+    }
+
+    if (s_connected && !s_idle && !s_pending && now >= s_retry_after) {
+        conn_tier_t next = s_tier;
+        if (wanted < s_tier) {
+            s_quiet_windows = 0;
+            if (wanted == CONN_TIER_FAST || ++s_busy_windows >= TYPING_WINDOWS) {
+                next = wanted;
+                s_busy_windows = 0;
+            }
+        } else if (wanted > s_tier) {
+            s_busy_windows = 0;
+            if (++s_quiet_windows >= RELAX_WINDOWS) {
+                next = s_tier + 1;
+                s_quiet_windows = 0;
+            }
+        } else {
+            s_quiet_windows = 0;
+            s_busy_windows = 0;
+        }
+
+        if (next != s_tier) {
+            from = s_tier;
+            to = next;
+            begin_request(next, &params);
+            request = true;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (request) {
+        if (VERBOSE) {
+            ESP_LOGI(TAG, "Tier %d -> %d (mouse %lu rps, input %lu rps)", from, to, mouse_rps, input_rps);
+        }
+        submit_request(&params);
+    }
+}
+
+esp_err_t conn_policy_init(void) {
+    if (s_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = evaluate_timer_callback,
+        .name = "conn_policy",
+    };
+    const esp_err_t ret = esp_timer_create(&timer_args, &s_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create connection policy timer: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void conn_policy_deinit(void) {
+    conn_policy_on_disconnect();
+    if (s_timer != NULL) {
+        esp_timer_delete(s_timer);
+        s_timer = NULL;
+    }
+}
+
+void conn_policy_on_connect(const esp_bd_addr_t bda) {
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(s_peer, bda, sizeof(esp_bd_addr_t));
+    s_connected = true;
+    s_idle = false;
+    s_tier = CONN_TIER_FAST;
+    s_requested = CONN_TIER_FAST;
+    s_pending = true;
+    s_pending_since = esp_timer_get_time();
+    s_retry_after = 0;
+    s_quiet_windows = 0;
+    s_busy_windows = 0;
+    taskEXIT_CRITICAL(&s_lock);
+
+    __atomic_store_n(&s_mouse_reports, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_key_reports, 0, __ATOMIC_RELAXED);
+
+    if (s_timer != NULL) {
+        esp_timer_stop(s_timer);
+        esp_timer_start_periodic(s_timer, POLICY_WINDOW_MS * 1000);
+    }
+}
+
+void conn_policy_on_disconnect(void) {
+    taskENTER_CRITICAL(&s_lock);
+    s_connected = false;
+    s_pending = false;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (s_timer != NULL) {
+        esp_timer_stop(s_timer);
+    }
+}
+
+void conn_policy_on_params_updated(const bool success, const uint16_t interval) {
+    taskENTER_CRITICAL(&s_lock);
+    if (success) {
+        s_tier = tier_for_interval(interval);
+    }
+
+    // The central may refuse or pick an interval outside the requested range, don't keep insisting
+    if (s_pending && (!success || s_tier != s_requested)) {
+        s_retry_after = esp_timer_get_time() + REJECT_BACKOFF_US;
+    }
+    s_pending = false;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+IRAM_ATTR void conn_policy_record_report(const bool is_mouse) {
+    __atomic_fetch_add(is_mouse ? &s_mouse_reports : &s_key_reports, 1, __ATOMIC_RELAXED);
+}
+
+esp_err_t conn_policy_set_idle(const bool idle) {
+    esp_ble_conn_update_params_t params;
+
+    taskENTER_CRITICAL(&s_lock);
+    if (!s_connected) {
+        taskEXIT_CRITICAL(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_idle = idle;
+    s_quiet_windows = 0;
+    s_busy_windows = 0;
+    s_retry_after = 0;
+    begin_request(idle ? CONN_TIER_IDLE : CONN_TIER_FAST, &params);
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Requesting %s connection parameters", idle ? "idle" : "active");
+    }
+
+    return submit_request(&params);
+}
+
+conn_tier_t conn_policy_tier(void) {
+    return s_tier;
+}
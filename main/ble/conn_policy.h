@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CONN_TIER_FAST = 0,  // sustained mouse traffic, connect-time parameters
+    CONN_TIER_NORMAL,    // some input, slightly longer interval with slave latency
+    CONN_TIER_RELAXED,   // occasional keystrokes at most
+    CONN_TIER_IDLE,      // keep-alive link, only entered and left explicitly
+    CONN_TIER_MAX
+} conn_tier_t;
+
+/**
+ * @brief Create the policy evaluation timer
+ * @return ESP_OK on success
+ */
+esp_err_t conn_policy_init(void);
+
+/**
+ * @brief Stop and delete the policy evaluation timer
+ */
+void conn_policy_deinit(void);
+
+/**
+ * @brief Start evaluating a new connection
+ *
+ * The connect-time parameters (CONN_TIER_FAST) are assumed to be requested by the profile.
+ *
+ * @param bda Peer address
+ */
+void conn_policy_on_connect(const esp_bd_addr_t bda);
+
+/**
+ * @brief Stop evaluating, the link is gone
+ */
+void conn_policy_on_disconnect(void);
+
+/**
+ * @brief Feed the result of ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT
+ * @param success Whether the central accepted the parameters
+ * @param interval Connection interval in 1.25ms units
+ */
+void conn_policy_on_params_updated(bool success, uint16_t interval);
+
+/**
+ * @brief Count one forwarded report, lock-free
+ * @param is_mouse true for pointer reports, false for keys
+ */
+void conn_policy_record_report(bool is_mouse);
+
+/**
+ * @brief Park the link on the idle tier, or snap back to the fast tier
+ * @param idle true to enter idle, false to leave it
+ * @return ESP_OK if the update was requested, ESP_ERR_INVALID_STATE if not connected
+ */
+esp_err_t conn_policy_set_idle(bool idle);
+
+/**
+ * @brief Tier of the parameters currently in effect
+ */
+conn_tier_t conn_policy_tier(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,13 +1,10 @@
 #include "connection.h"
 #include <esp_log.h>
 #include <string.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/projdefs.h>
-#include <freertos/task.h>
 
-#include "ble_hid_device.h"
 #include "const.h"
 #include "nvs.h"
+#include "reconnect.h"
 
 #define STORAGE_NAMESPACE "hid_dev"
 #define ADDR_KEY "last_addr"
@@ -138,12 +135,11 @@ esp_err_t load_saved_device_to_cache(void) {
 }
 
 /**
- * @brief Connect to the last saved device using cached data or loading from NVS
- * 
- * @param gatts_if GATT server interface
- * @return esp_err_t ESP_OK if connection initiated successfully, error code otherwise
+ * @brief Start reconnecting to the last saved device using cached data or loading from NVS
+ *
+ * @return esp_err_t ESP_OK if reconnection started successfully, error code otherwise
  */
-esp_err_t connect_to_saved_device(const esp_gatt_if_t gatts_if) {
+esp_err_t connect_to_saved_device(void) {
     esp_err_t err;
     if (!saved_device_cache.is_valid) {
         err = load_saved_device_to_cache();
@@ -164,15 +160,13 @@ esp_err_t connect_to_saved_device(const esp_gatt_if_t gatts_if) {
                  saved_device_cache.addr_type);
     }
 
-    ble_hid_device_start_advertising();
-
-    err = esp_ble_gatts_open(gatts_if, saved_device_cache.bda, true); // true for direct connection
+    // The central initiates, all we can do is advertise: directed to it first, then to anyone
+    err = reconnect_start(0);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to connect to saved device, error: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to reconnect to saved device, error: %s", esp_err_to_name(err));
         return err;
     }
 
-    vTaskDelay(pdMS_TO_TICKS(10));
     return ESP_OK;
 }
 
@@ -32,12 +32,11 @@ esp_err_t save_connected_device(esp_bd_addr_t bda, esp_ble_addr_type_t addr_type
 esp_err_t load_saved_device_to_cache(void);
 
 /**
- * @brief Connect to the last saved device using cached data or loading from NVS
+ * @brief Start reconnecting to the last saved device using cached data or loading from NVS
  *
- * @param gatts_if GATT server interface
- * @return esp_err_t ESP_OK if connection initiated successfully, error code otherwise
+ * @return esp_err_t ESP_OK if reconnection started successfully, error code otherwise
  */
-esp_err_t connect_to_saved_device(esp_gatt_if_t gatts_if);
+esp_err_t connect_to_saved_device(void);
 
 /**
  * @brief Check if there is a saved device available
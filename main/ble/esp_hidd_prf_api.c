@@ -8,6 +8,8 @@
 #define HID_MOUSE_IN_RPT_LEN        7
 #define HID_SYS_CTRL_IN_RPT_LEN     2
 #define HID_CONSUMER_IN_RPT_LEN     2
+#define HID_NKRO_IN_RPT_LEN         (1 + HID_NKRO_BITMAP_LEN)
+#define HID_KEYBOARD_KEYS           6
 
 static uint8_t s_report_buffer[HID_KEYBOARD_IN_RPT_LEN+2] __attribute__((section(".dram1.data")));
 static bool s_enabled = true;
@@ -78,26 +80,35 @@ void esp_hidd_send_keyboard_value(const uint16_t conn_id, const key_mask_t speci
 
     s_report_buffer[0] = special_key_mask;
     memset(&s_report_buffer[1], 0, HID_KEYBOARD_IN_RPT_LEN - 1);
-    for (int i = 1; i < HID_KEYBOARD_IN_RPT_LEN - 1; i++) {
-        s_report_buffer[i + 1] = keyboard_cmd[i - 1];
-    }
+    memcpy(&s_report_buffer[2], keyboard_cmd, HID_KEYBOARD_KEYS);
 
     hid_dev_send_report(hidd_le_env.gatt_if,
         conn_id, HID_RPT_ID_KEY_IN, HID_REPORT_TYPE_INPUT, HID_KEYBOARD_IN_RPT_LEN, s_report_buffer);
 }
 
+void esp_hidd_send_nkro_value(const uint16_t conn_id, const key_mask_t special_key_mask, const uint8_t *key_bitmap) {
+    s_report_buffer[0] = special_key_mask;
+    memcpy(&s_report_buffer[1], key_bitmap, HID_NKRO_BITMAP_LEN);
+
+    hid_dev_send_report(hidd_le_env.gatt_if,
+        conn_id, HID_RPT_ID_NKRO_IN, HID_REPORT_TYPE_INPUT, HID_NKRO_IN_RPT_LEN, s_report_buffer);
+}
+
 void IRAM_ATTR esp_hidd_send_mouse_value(const uint16_t conn_id, const uint8_t mouse_button, const uint16_t mickeys_x,
                                const uint16_t mickeys_y, const int8_t wheel, const int8_t pan) {
-    s_report_buffer[0] = mickeys_x & 0xFF;
-    s_report_buffer[1] = (mickeys_x >> 8);
-    s_report_buffer[2] = mickeys_y & 0xFF;
-    s_report_buffer[3] = (mickeys_y >> 8);
-    s_report_buffer[4] = wheel;
-    s_report_buffer[5] = pan;
-    s_report_buffer[6] = mouse_button;
+    // Mouse reports are sent from both the USB forwarding task and the coalescer timer,
+    // so don't share s_report_buffer (the stack copies the value before returning)
+    uint8_t buffer[HID_MOUSE_IN_RPT_LEN];
+    buffer[0] = mickeys_x & 0xFF;
+    buffer[1] = (mickeys_x >> 8);
+    buffer[2] = mickeys_y & 0xFF;
+    buffer[3] = (mickeys_y >> 8);
+    buffer[4] = wheel;
+    buffer[5] = pan;
+    buffer[6] = mouse_button;
 
     hid_dev_send_report(hidd_le_env.gatt_if, conn_id, HID_RPT_ID_MOUSE_IN, HID_REPORT_TYPE_INPUT, HID_MOUSE_IN_RPT_LEN,
-                        s_report_buffer);
+                        buffer);
 }
 
 void esp_hidd_send_system_control_value(const uint16_t conn_id, const uint16_t sys_ctrl) {
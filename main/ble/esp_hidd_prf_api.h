@@ -142,6 +142,12 @@ uint16_t esp_hidd_get_version(void);
 
 void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, const uint8_t *keyboard_cmd);
 
+/**
+ * @brief Send the NKRO keyboard report
+ * @param key_bitmap HID_NKRO_BITMAP_LEN bytes, bit n set when keyboard usage n is pressed
+ */
+void esp_hidd_send_nkro_value(uint16_t conn_id, key_mask_t special_key_mask, const uint8_t *key_bitmap);
+
 void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, uint16_t mickeys_x, uint16_t mickeys_y, int8_t wheel, int8_t pan);
 
 void esp_hidd_send_system_control_value(uint16_t conn_id, uint16_t sys_ctrl);
@@ -2,40 +2,32 @@
 #include "esp_hidd_prf_api.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
 #include <string.h>
 #include "const.h"
 
-#define CACHE_SIZE 12
+#define RELEASE_DELAY_US 7000
 
-typedef struct {
-    char action_type[20];
-    char action[20];
-    union {
-        keyboard_key_t key;
-        mouse_button_t button;
-        system_control_t system;
-        consumer_control_t control;
-        special_key_t special;
-    } parsed;
-    uint8_t type;  // 1=keyboard, 2=mouse, 3=system, 4=consumer, 5=special
-} cache_entry_t;
+// One pending release per report type, a new press of the same type just pushes its release back
+typedef enum {
+    RELEASE_KEYBOARD = 0,
+    RELEASE_MOUSE,
+    RELEASE_SYSTEM,
+    RELEASE_CONSUMER,
+    RELEASE_NUM_TYPES
+} release_type_t;
 
 typedef struct {
+    bool pending;
     uint16_t conn_id;
-    uint8_t type;
-    union {
-        struct { keyboard_key_t key; uint8_t modifiers; };
-        mouse_button_t button;
-        system_control_t system;
-        consumer_control_t consumer;
-        special_key_t special;
-    } data;
-    esp_timer_handle_t timer;
-} release_timer_t;
+    int64_t deadline_us;
+} pending_release_t;
 
 static const char *TAG = "HID_ACTIONS";
-static cache_entry_t cache[CACHE_SIZE];
-static int cache_count = 0;
+
+static pending_release_t s_releases[RELEASE_NUM_TYPES];
+static portMUX_TYPE s_release_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_release_timer = NULL;
 
 static struct {
     bool cursor_y_axis;  // false = X axis, true = Y axis
@@ -45,47 +37,89 @@ static struct {
     .wheel_horizontal = false
 };
 
-static void release_timer_callback(void* arg) {
-    release_timer_t* timer_data = (release_timer_t*)arg;
-    
-    switch (timer_data->type) {
-        case 1: // keyboard
-            esp_hidd_send_keyboard_value(timer_data->conn_id, 0, (uint8_t[]){0,0,0,0,0,0,0,0});
+static void send_release(const release_type_t type, const uint16_t conn_id) {
+    static const uint8_t no_keys[8] = {0};
+
+    switch (type) {
+        case RELEASE_KEYBOARD:
+            esp_hidd_send_keyboard_value(conn_id, 0, no_keys);
+            break;
+        case RELEASE_MOUSE:
+            esp_hidd_send_mouse_value(conn_id, 0, 0, 0, 0, 0);
             break;
-        case 2: // mouse
-            esp_hidd_send_mouse_value(timer_data->conn_id, 0, 0, 0, 0, 0);
+        case RELEASE_SYSTEM:
+            esp_hidd_send_system_control_value(conn_id, 0);
             break;
-        case 3: // system
-            esp_hidd_send_system_control_value(timer_data->conn_id, 0);
+        case RELEASE_CONSUMER:
+            esp_hidd_send_consumer_value(conn_id, 0);
             break;
-        case 4: // consumer
-            esp_hidd_send_consumer_value(timer_data->conn_id, 0);
+        default:
             break;
     }
+}
+
+// Arms the timer for the earliest pending release, must be called with s_release_lock held
+static void rearm_release_timer(const int64_t now) {
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < RELEASE_NUM_TYPES; i++) {
+        if (s_releases[i].pending && s_releases[i].deadline_us < next) {
+            next = s_releases[i].deadline_us;
+        }
+    }
 
-    esp_timer_delete(timer_data->timer);
-    free(timer_data);
+    esp_timer_stop(s_release_timer);
+    if (next != INT64_MAX) {
+        esp_timer_start_once(s_release_timer, next > now ? next - now : 0);
+    }
 }
 
-static void schedule_release(const uint16_t conn_id, const uint8_t type, const void* data) {
-    release_timer_t* timer_data = malloc(sizeof(release_timer_t));
-    if (!timer_data) return;
+static void release_timer_callback(void* arg) {
+    pending_release_t due[RELEASE_NUM_TYPES] = {0};
+    const int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_release_lock);
+    for (int i = 0; i < RELEASE_NUM_TYPES; i++) {
+        if (s_releases[i].pending && s_releases[i].deadline_us <= now) {
+            due[i] = s_releases[i];
+            s_releases[i].pending = false;
+        }
+    }
+    rearm_release_timer(now);
+    taskEXIT_CRITICAL(&s_release_lock);
 
-    timer_data->conn_id = conn_id;
-    timer_data->type = type;
-    memcpy(&timer_data->data, data, sizeof(timer_data->data));
+    for (int i = 0; i < RELEASE_NUM_TYPES; i++) {
+        if (due[i].pending) {
+            send_release(i, due[i].conn_id);
+        }
+    }
+}
+
+static void schedule_release(const uint16_t conn_id, const release_type_t type) {
+    if (!s_release_timer) {
+        ESP_LOGE(TAG, "Release timer not initialized");
+        return;
+    }
+
+    const int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_release_lock);
+    s_releases[type].pending = true;
+    s_releases[type].conn_id = conn_id;
+    s_releases[type].deadline_us = now + RELEASE_DELAY_US;
+    rearm_release_timer(now);
+    taskEXIT_CRITICAL(&s_release_lock);
+}
+
+esp_err_t hid_actions_init(void) {
+    if (s_release_timer) {
+        return ESP_OK;
+    }
 
     const esp_timer_create_args_t timer_args = {
         .callback = release_timer_callback,
-        .arg = timer_data,
         .name = "release_timer"
     };
-    
-    if (esp_timer_create(&timer_args, &timer_data->timer) != ESP_OK) {
-        free(timer_data);
-        return;
-    }
-    esp_timer_start_once(timer_data->timer, 7000); // 50ms in microseconds
+    return esp_timer_create(&timer_args, &s_release_timer);
 }
 
 void execute_keyboard_action(const uint16_t conn_id, const keyboard_key_t key, const uint8_t modifiers) {
@@ -93,23 +127,22 @@ void execute_keyboard_action(const uint16_t conn_id, const keyboard_key_t key, c
     keyboard_cmd[0] = key;
     esp_hidd_send_keyboard_value(conn_id, modifiers, keyboard_cmd);
 
-    const struct { keyboard_key_t key; uint8_t modifiers; } data = { key, modifiers };
-    schedule_release(conn_id, 1, &data);
+    schedule_release(conn_id, RELEASE_KEYBOARD);
 }
 
 void execute_mouse_button_action(const uint16_t conn_id, const mouse_button_t button) {
     esp_hidd_send_mouse_value(conn_id, button, 0, 0, 0, 0);
-    schedule_release(conn_id, 2, &button);
+    schedule_release(conn_id, RELEASE_MOUSE);
 }
 
 void execute_system_control_action(const uint16_t conn_id, const system_control_t control) {
     esp_hidd_send_system_control_value(conn_id, control);
-    schedule_release(conn_id, 3, &control);
+    schedule_release(conn_id, RELEASE_SYSTEM);
 }
 
 void execute_consumer_control_action(const uint16_t conn_id, const consumer_control_t control) {
     esp_hidd_send_consumer_value(conn_id, control);
-    schedule_release(conn_id, 4, &control);
+    schedule_release(conn_id, RELEASE_CONSUMER);
 }
 
 void execute_special_action(const uint16_t conn_id, const special_key_t action) {
@@ -312,115 +345,108 @@ uint8_t string_to_modifiers(const char** modifiers, const int count) {
     return mod;
 }
 
-static IRAM_ATTR cache_entry_t* find_in_cache(const char* action_type, const char* action) {
-    for (int i = 0; i < cache_count; i++) {
-        if (strcmp(cache[i].action_type, action_type) == 0 && 
-            strcmp(cache[i].action, action) == 0) {
-            return &cache[i];
-        }
+static const char* infer_action_type(const char* action) {
+    if (strncmp(action, "KC_MS_", 6) == 0) {
+        return strncmp(action + 6, "BTN", 3) == 0 ? "mouse_button" : "special";
     }
-    return NULL;
-}
-
-static void add_to_cache(const char* action_type, const char* action, const uint8_t type, const void* parsed) {
-    if (cache_count >= CACHE_SIZE) {
-        memmove(&cache[0], &cache[1], sizeof(cache_entry_t) * (CACHE_SIZE - 1));
-        cache_count--;
+    if (strncmp(action, "KC_SYSTEM_", 10) == 0) {
+        return "system_control";
     }
-
-    cache_entry_t* entry = &cache[cache_count++];
-    strncpy(entry->action_type, action_type, sizeof(entry->action_type) - 1);
-    strncpy(entry->action, action, sizeof(entry->action) - 1);
-    entry->type = type;
-    memcpy(&entry->parsed, parsed, sizeof(entry->parsed));
+    if (strncmp(action, "KC_CURSOR_", 10) == 0) {
+        return "special";
+    }
+    if (strncmp(action, "KC_", 3) == 0 &&
+        (strncmp(action + 3, "AUDIO_", 6) == 0 ||
+         strncmp(action + 3, "MEDIA_", 6) == 0 ||
+         strncmp(action + 3, "WWW_", 4) == 0 ||
+         strncmp(action + 3, "BRIGHTNESS_", 11) == 0 ||
+         strcmp(action + 3, "MAIL") == 0 ||
+         strcmp(action + 3, "CALCULATOR") == 0 ||
+         strcmp(action + 3, "MY_COMPUTER") == 0)) {
+        return "consumer_control";
+    }
+    return "keyboard_key";
 }
 
-void execute_action_from_string(const uint16_t conn_id, const char* action_type, const char* action,
-                              const char** modifiers, const int modifier_count) {
-    const char* effective_type = action_type;
-    if (!action_type || action_type[0] == '\0') {
-        if (strncmp(action, "KC_MS_", 6) == 0) {
-            if (strncmp(action + 6, "BTN", 3) == 0) {
-                effective_type = "mouse_button";
-            } else {
-                effective_type = "special";
-            }
-        } else if (strncmp(action, "KC_SYSTEM_", 10) == 0) {
-            effective_type = "system_control";
-        } else if (strncmp(action, "KC_CURSOR_", 10) == 0) {
-            effective_type = "special";
-        } else if (strncmp(action, "KC_", 3) == 0 &&
-                  (strncmp(action + 3, "AUDIO_", 6) == 0 ||
-                   strncmp(action + 3, "MEDIA_", 6) == 0 ||
-                   strncmp(action + 3, "WWW_", 4) == 0 ||
-                   strncmp(action + 3, "BRIGHTNESS_", 11) == 0 ||
-                   strcmp(action + 3, "MAIL") == 0 ||
-                   strcmp(action + 3, "CALCULATOR") == 0 ||
-                   strcmp(action + 3, "MY_COMPUTER") == 0)) {
-            effective_type = "consumer_control";
-        } else {
-            effective_type = "keyboard_key";
-        }
-    }
+bool compile_action(const char* action_type, const char* action, const char** modifiers, const int modifier_count,
+                    compiled_action_t* out) {
+    out->op = ACTION_OP_NONE;
+    out->modifiers = 0;
+    out->code = 0;
 
-    const cache_entry_t* cached = find_in_cache(effective_type, action);
-    if (cached) {
-        switch (cached->type) {
-            case 1: // keyboard
-                execute_keyboard_action(conn_id, cached->parsed.key, 
-                    strcmp(effective_type, "keyboard_combo") == 0 ? 
-                    string_to_modifiers(modifiers, modifier_count) : 0);
-                return;
-            case 2: // mouse
-                execute_mouse_button_action(conn_id, cached->parsed.button);
-                return;
-            case 3: // system
-                execute_system_control_action(conn_id, cached->parsed.system);
-                return;
-            case 4: // consumer
-                execute_consumer_control_action(conn_id, cached->parsed.control);
-                return;
-            case 5: // special
-                execute_special_action(conn_id, cached->parsed.special);
-                return;
-        }
+    if (!action || action[0] == '\0') {
+        return false;
     }
 
+    const char* effective_type = (!action_type || action_type[0] == '\0') ? infer_action_type(action) : action_type;
+
     if (strcmp(effective_type, "keyboard_key") == 0 || strcmp(effective_type, "keyboard_combo") == 0) {
         const keyboard_key_t key = string_to_keyboard_key(action);
         if (key) {
-            add_to_cache(effective_type, action, 1, &key);
-            execute_keyboard_action(conn_id, key, 
-                strcmp(effective_type, "keyboard_combo") == 0 ? 
-                string_to_modifiers(modifiers, modifier_count) : 0);
+            out->op = ACTION_OP_KEYBOARD;
+            out->code = key;
+            if (strcmp(effective_type, "keyboard_combo") == 0 && modifiers) {
+                out->modifiers = string_to_modifiers(modifiers, modifier_count);
+            }
         }
     } else if (strcmp(effective_type, "mouse_button") == 0) {
         const mouse_button_t button = string_to_mouse_button(action);
         if (button) {
-            add_to_cache(effective_type, action, 2, &button);
-            execute_mouse_button_action(conn_id, button);
+            out->op = ACTION_OP_MOUSE_BUTTON;
+            out->code = button;
         }
     } else if (strcmp(effective_type, "system_control") == 0) {
         const system_control_t control = string_to_system_control(action);
         if (control) {
-            add_to_cache(effective_type, action, 3, &control);
-            execute_system_control_action(conn_id, control);
+            out->op = ACTION_OP_SYSTEM_CONTROL;
+            out->code = control;
         }
     } else {
         const special_key_t special = string_to_special_key(action);
+        const consumer_control_t consumer = special ? 0 : string_to_consumer_control(action);
         if (special) {
-            add_to_cache(effective_type, action, 5, &special);
-            execute_special_action(conn_id, special);
-            return;
-        }
-
-        const consumer_control_t consumer = string_to_consumer_control(action);
-        if (consumer) {
-            add_to_cache(effective_type, action, 4, &consumer);
-            execute_consumer_control_action(conn_id, consumer);
-            return;
+            out->op = ACTION_OP_SPECIAL;
+            out->code = special;
+        } else if (consumer) {
+            out->op = ACTION_OP_CONSUMER_CONTROL;
+            out->code = consumer;
         }
+    }
 
+    if (out->op == ACTION_OP_NONE) {
         ESP_LOGW(TAG, "Unknown action type or action: %s - %s", effective_type, action);
+        return false;
+    }
+
+    return true;
+}
+
+IRAM_ATTR void execute_compiled_action(const uint16_t conn_id, const compiled_action_t* action) {
+    switch (action->op) {
+        case ACTION_OP_KEYBOARD:
+            execute_keyboard_action(conn_id, action->code, action->modifiers);
+            break;
+        case ACTION_OP_MOUSE_BUTTON:
+            execute_mouse_button_action(conn_id, action->code);
+            break;
+        case ACTION_OP_SYSTEM_CONTROL:
+            execute_system_control_action(conn_id, action->code);
+            break;
+        case ACTION_OP_CONSUMER_CONTROL:
+            execute_consumer_control_action(conn_id, action->code);
+            break;
+        case ACTION_OP_SPECIAL:
+            execute_special_action(conn_id, action->code);
+            break;
+        default:
+            break;
+    }
+}
+
+void execute_action_from_string(const uint16_t conn_id, const char* action_type, const char* action,
+                              const char** modifiers, const int modifier_count) {
+    compiled_action_t compiled;
+    if (compile_action(action_type, action, modifiers, modifier_count, &compiled)) {
+        execute_compiled_action(conn_id, &compiled);
     }
 }
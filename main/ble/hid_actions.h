@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_err.h"
 
 // Action types
 typedef enum {
@@ -95,6 +96,29 @@ typedef enum {
     MOD_WIN = 0x08
 } key_modifier_t;
 
+// Opcodes of a compiled action
+typedef enum {
+    ACTION_OP_NONE = 0,
+    ACTION_OP_KEYBOARD,
+    ACTION_OP_MOUSE_BUTTON,
+    ACTION_OP_SYSTEM_CONTROL,
+    ACTION_OP_CONSUMER_CONTROL,
+    ACTION_OP_SPECIAL
+} action_op_t;
+
+// Action resolved from its settings strings once, dispatched without any string handling
+typedef struct {
+    uint8_t op;        // action_op_t
+    uint8_t modifiers; // key_modifier_t mask, keyboard only
+    uint16_t code;     // key, button or control code depending on op
+} compiled_action_t;
+
+/**
+ * @brief Create the shared release timer, must be called before executing any action
+ * @return ESP_OK on success
+ */
+esp_err_t hid_actions_init(void);
+
 // Function prototypes
 void execute_keyboard_action(uint16_t conn_id, keyboard_key_t key, uint8_t modifiers);
 void execute_mouse_button_action(uint16_t conn_id, mouse_button_t button);
@@ -110,6 +134,23 @@ consumer_control_t string_to_consumer_control(const char* str);
 special_key_t string_to_special_key(const char* str);
 uint8_t string_to_modifiers(const char** modifiers, int count);
 
-// Execute action from string
+/**
+ * @brief Resolve an action binding from its settings strings
+ * @param action_type Action type (e.g. "keyboard_combo"), empty to infer it from the action name
+ * @param action Action name (e.g. "KC_HOME")
+ * @param modifiers Modifier names, used for keyboard combos only
+ * @param modifier_count Number of modifiers
+ * @param out Compiled action, op is ACTION_OP_NONE if the action is unknown
+ * @return true if the action is known
+ */
+bool compile_action(const char* action_type, const char* action, const char** modifiers, int modifier_count,
+                    compiled_action_t* out);
+
+/**
+ * @brief Execute a compiled action, no-op for ACTION_OP_NONE
+ */
+void execute_compiled_action(uint16_t conn_id, const compiled_action_t* action);
+
+// Execute action from string, compiles the action on every call
 void execute_action_from_string(uint16_t conn_id, const char* action_type, const char* action,
                               const char** modifiers, int modifier_count);
@@ -22,6 +22,7 @@ struct gatts_profile_inst {
 hidd_le_env_t hidd_le_env;
 static esp_gatt_if_t s_gatts_if;
 uint8_t hidProtocolMode = HID_PROTOCOL_MODE_REPORT;
+static volatile bool s_nkro_enabled = false;
 
 uint16_t get_gatts_if(void) {
     if (hidd_le_env.hidd_cb != NULL) {
@@ -37,6 +38,20 @@ uint16_t get_gatts_if(void) {
 
 static void hid_add_id_tbl(void);
 
+bool IRAM_ATTR hidd_nkro_enabled(void) {
+    return s_nkro_enabled;
+}
+
+// CCCD values live in the attribute table, a bonded host may not write them again on reconnect
+static void load_nkro_subscription(void) {
+    uint16_t length = 0;
+    const uint8_t *value = NULL;
+    const uint16_t handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_NKRO_IN_CCC];
+
+    s_nkro_enabled = handle != 0 && esp_ble_gatts_get_attr_value(handle, &length, &value) == ESP_OK &&
+                     length >= 1 && (value[0] & 0x01);
+}
+
 static void IRAM_ATTR esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                          esp_ble_gatts_cb_param_t *param) {
     switch (event) {
@@ -74,6 +89,7 @@ static void IRAM_ATTR esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_i
             memcpy(cb_param.connect.remote_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
             cb_param.connect.conn_id = param->connect.conn_id;
             hidd_clcb_alloc(param->connect.conn_id, param->connect.remote_bda);
+            load_nkro_subscription();
             esp_ble_set_encryption(param->connect.remote_bda, ESP_BLE_SEC_ENCRYPT_NO_MITM);
             if (hidd_le_env.hidd_cb != NULL) {
                 (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_CONNECT, &cb_param);
@@ -82,10 +98,10 @@ static void IRAM_ATTR esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_i
             esp_ble_conn_update_params_t conn_params;
             memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
 
-            conn_params.latency = 0x00;
-            conn_params.min_int = 0x06; // x 1.25ms
-            conn_params.max_int = 0x06; // x 1.25ms
-            conn_params.timeout = 0xA0; // x 6.25ms
+            conn_params.latency = HIDD_CONN_ACTIVE_LATENCY;
+            conn_params.min_int = HIDD_CONN_ACTIVE_INTERVAL;
+            conn_params.max_int = HIDD_CONN_ACTIVE_INTERVAL;
+            conn_params.timeout = HIDD_CONN_ACTIVE_TIMEOUT;
 
             esp_ble_gap_update_conn_params(&conn_params);
             break;
@@ -99,7 +115,12 @@ static void IRAM_ATTR esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_i
         }
         case ESP_GATTS_WRITE_EVT: {
             esp_hidd_cb_param_t cb_param = {0};
-            if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_VAL]) {
+            if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_NKRO_IN_CCC]) {
+                s_nkro_enabled = param->write.len >= 1 && (param->write.value[0] & 0x01);
+                if (VERBOSE) {
+                    ESP_LOGI(HID_LE_PRF_TAG, "NKRO keyboard report %s", s_nkro_enabled ? "enabled" : "disabled");
+                }
+            } else if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_VAL]) {
                 cb_param.led_write.conn_id = param->write.conn_id;
                 cb_param.led_write.report_id = HID_RPT_ID_LED_OUT;
                 cb_param.led_write.length = param->write.len;
@@ -257,6 +278,13 @@ static IRAM_ATTR void hid_add_id_tbl(void) {
     hid_rpt_map[3].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_CCC];
     hid_rpt_map[3].mode = HID_PROTOCOL_MODE_REPORT;
 
+    // NKRO key input report
+    hid_rpt_map[4].id = hidReportRefNkroIn[0];
+    hid_rpt_map[4].type = hidReportRefNkroIn[1];
+    hid_rpt_map[4].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_NKRO_IN_VAL];
+    hid_rpt_map[4].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_NKRO_IN_CCC];
+    hid_rpt_map[4].mode = HID_PROTOCOL_MODE_REPORT;
+
     // Setup report ID map
-    hid_dev_register_reports(4, hid_rpt_map);
+    hid_dev_register_reports(HID_NUM_REPORTS, hid_rpt_map);
 }
@@ -9,7 +9,7 @@
 #define SUPPORT_REPORT_VENDOR                 false
 #define HID_LE_PRF_TAG                        "HID_LE_PRF"
 #define HIDD_LE_NB_HIDS_INST_MAX              (1)
-#define HID_NUM_REPORTS                       4
+#define HID_NUM_REPORTS                       5
 
 #define HIDD_GREAT_VER   0x01  //Version + Subversion
 #define HIDD_SUB_VER     0x00  //Version + Subversion
@@ -20,6 +20,7 @@
 #define HID_RPT_ID_KEY_IN        6   // Keyboard input report ID
 #define HID_RPT_ID_CC_IN         4   // Consumer Control input report ID
 #define HID_RPT_ID_SYS_IN        3   // System Control input report ID
+#define HID_RPT_ID_NKRO_IN       7   // NKRO keyboard input report ID
 #define HID_RPT_ID_LED_OUT       2  // ToDo: LED output report ID
 #define HID_RPT_ID_FEATURE       0  // ToDo: Feature report ID
 
@@ -30,11 +31,20 @@
 /// Maximal number of Report Char. that can be added in the DB for one HIDS - Up to 11
 #define HIDD_LE_NB_REPORT_INST_MAX            (8)
 
+// Connection parameters requested on connect (interval x 1.25ms, timeout x 10ms)
+#define HIDD_CONN_ACTIVE_INTERVAL             0x06
+#define HIDD_CONN_ACTIVE_LATENCY              0x00
+#define HIDD_CONN_ACTIVE_TIMEOUT              0xA0
+
 /// Maximal length of Report Char. Value
 #define HIDD_LE_REPORT_MAX_LEN                (64)
 /// Maximal length of Report Map Char. Value
 #define HIDD_LE_REPORT_MAP_MAX_LEN            (255)
 
+/// Highest keyboard usage covered by the NKRO bitmap, keeps the report within a default MTU notification
+#define HID_NKRO_MAX_USAGE                    (0x97)
+#define HID_NKRO_BITMAP_LEN                   ((HID_NKRO_MAX_USAGE + 8) / 8)
+
 /// Length of Boot Report Char. Value Maximal Length
 #define HIDD_LE_BOOT_REPORT_MAX_LEN           (8)
 
@@ -135,6 +145,12 @@ enum {
     HIDD_LE_IDX_REPORT_KEY_IN_CCC,
     HIDD_LE_IDX_REPORT_KEY_IN_REP_REF,
 
+    // Report NKRO keyboard input
+    HIDD_LE_IDX_REPORT_NKRO_IN_CHAR,
+    HIDD_LE_IDX_REPORT_NKRO_IN_VAL,
+    HIDD_LE_IDX_REPORT_NKRO_IN_CCC,
+    HIDD_LE_IDX_REPORT_NKRO_IN_REP_REF,
+
     // Report Led output
     HIDD_LE_IDX_REPORT_LED_OUT_CHAR,
     HIDD_LE_IDX_REPORT_LED_OUT_VAL,
@@ -319,4 +335,9 @@ esp_err_t hidd_register_cb(void);
 
 uint16_t get_gatts_if(void);
 
+/**
+ * @brief Whether the connected host subscribed to the NKRO keyboard report
+ */
+bool hidd_nkro_enabled(void);
+
 #endif  ///__HID_DEVICE_LE_PRF__
@@ -27,6 +27,7 @@ uint8_t hidReportRefMouseIn[HID_REPORT_REF_LEN] = {HID_RPT_ID_MOUSE_IN, HID_REPO
 uint8_t hidReportRefSysCtrlIn[HID_REPORT_REF_LEN] = {HID_RPT_ID_SYS_IN, HID_REPORT_TYPE_INPUT};
 uint8_t hidReportRefConsumerIn[HID_REPORT_REF_LEN] = {HID_RPT_ID_CC_IN, HID_REPORT_TYPE_INPUT};
 uint8_t hidReportRefKeyIn[HID_REPORT_REF_LEN] = {HID_RPT_ID_KEY_IN, HID_REPORT_TYPE_INPUT};
+uint8_t hidReportRefNkroIn[HID_REPORT_REF_LEN] = {HID_RPT_ID_NKRO_IN, HID_REPORT_TYPE_INPUT};
 uint8_t hidReportRefFeature[HID_REPORT_REF_LEN] = {HID_RPT_ID_FEATURE, HID_REPORT_TYPE_FEATURE};
 
 static const uint16_t hid_ccc_default = 0x0100;
@@ -129,6 +130,26 @@ const uint8_t hidReportMap[] __attribute__((section(".rodata"))) = {
     0x75, 0x08, //  Report Size (8)
     0x81, 0x01, //  Input (Cnst,Arr,Abs)
     0xc0, // End Collection
+
+    // NKRO keyboard, used instead of report 6 once the host subscribes to it
+    0x05, 0x01, // Usage Page (Generic Desktop)
+    0x09, 0x06, // Usage (Keyboard)
+    0xa1, 0x01, // Collection (Application)
+    0x85, 0x07, //  Report ID (7)
+    0x05, 0x07, //  Usage Page (Keyboard)
+    0x19, 0xe0, //  Usage Minimum (224)
+    0x29, 0xe7, //  Usage Maximum (231)
+    0x15, 0x00, //  Logical Minimum (0)
+    0x25, 0x01, //  Logical Maximum (1)
+    0x95, 0x08, //  Report Count (8)
+    0x75, 0x01, //  Report Size (1)
+    0x81, 0x02, //  Input (Data,Var,Abs)
+    0x19, 0x00, //  Usage Minimum (0)
+    0x29, 0x97, //  Usage Maximum (151), HID_NKRO_MAX_USAGE
+    0x95, 0x98, //  Report Count (152)
+    0x75, 0x01, //  Report Size (1)
+    0x81, 0x02, //  Input (Data,Var,Abs)
+    0xc0, // End Collection
 };
 
 uint8_t hidReportMapLen = sizeof(hidReportMap);
@@ -437,6 +458,38 @@ esp_gatts_attr_db_t hidd_le_gatt_db[HIDD_LE_IDX_NB] =
             hidReportRefKeyIn
         }
     },
+    [HIDD_LE_IDX_REPORT_NKRO_IN_CHAR] = {
+        {ESP_GATT_AUTO_RSP}, {
+            ESP_UUID_LEN_16, (uint8_t *) &character_declaration_uuid,
+            ESP_GATT_PERM_READ,
+            CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+            (uint8_t *) &char_prop_read_notify
+        }
+    },
+    [HIDD_LE_IDX_REPORT_NKRO_IN_VAL] = {
+        {ESP_GATT_AUTO_RSP}, {
+            ESP_UUID_LEN_16, (uint8_t *) &hid_report_uuid,
+            ESP_GATT_PERM_READ_ENCRYPTED,
+            HIDD_LE_REPORT_MAX_LEN, 0,
+            NULL
+        }
+    },
+    [HIDD_LE_IDX_REPORT_NKRO_IN_CCC] = {
+        {ESP_GATT_AUTO_RSP}, {
+            ESP_UUID_LEN_16, (uint8_t *) &character_client_config_uuid,
+            (ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_WRITE_ENCRYPTED),
+            sizeof(uint16_t), sizeof(uint16_t),
+            (uint8_t *) &hid_ccc_default
+        }
+    },
+    [HIDD_LE_IDX_REPORT_NKRO_IN_REP_REF] = {
+        {ESP_GATT_AUTO_RSP}, {
+            ESP_UUID_LEN_16, (uint8_t *) &hid_report_ref_descr_uuid,
+            ESP_GATT_PERM_READ,
+            sizeof(hidReportRefNkroIn), sizeof(hidReportRefNkroIn),
+            hidReportRefNkroIn
+        }
+    },
     [HIDD_LE_IDX_REPORT_LED_OUT_CHAR] = {
         {ESP_GATT_AUTO_RSP}, {
             ESP_UUID_LEN_16, (uint8_t *) &character_declaration_uuid,
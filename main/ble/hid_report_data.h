@@ -24,6 +24,7 @@ extern uint8_t hidReportRefMouseIn[HID_REPORT_REF_LEN];
 extern uint8_t hidReportRefSysCtrlIn[HID_REPORT_REF_LEN];
 extern uint8_t hidReportRefConsumerIn[HID_REPORT_REF_LEN];
 extern uint8_t hidReportRefKeyIn[HID_REPORT_REF_LEN];
+extern uint8_t hidReportRefNkroIn[HID_REPORT_REF_LEN];
 extern uint8_t hidReportRefFeature[HID_REPORT_REF_LEN];
 
 // Battery Service Attributes Indexes
@@ -0,0 +1,83 @@
+#include "mouse_coalescer.h"
+#include <string.h>
+#include "esp_attr.h"
+
+static IRAM_ATTR inline int32_t clamp_delta(const int32_t value, const int32_t limit) {
+    return value > limit ? limit : value < -limit ? -limit : value;
+}
+
+static IRAM_ATTR inline int32_t saturating_add(const int32_t a, const int32_t b) {
+    int32_t sum;
+    if (__builtin_add_overflow(a, b, &sum)) {
+        return b > 0 ? INT32_MAX : INT32_MIN;
+    }
+    return sum;
+}
+
+// Takes as much of the pending motion as fits into one BLE report, the rest stays pending
+static IRAM_ATTR void take_snapshot(mouse_coalescer_t *c, const int64_t now, mouse_snapshot_t *snapshot) {
+    snapshot->buttons = c->buttons;
+    snapshot->x = clamp_delta(c->x, MOUSE_COALESCER_XY_MAX);
+    snapshot->y = clamp_delta(c->y, MOUSE_COALESCER_XY_MAX);
+    snapshot->wheel = clamp_delta(c->wheel, MOUSE_COALESCER_WHEEL_MAX);
+    snapshot->pan = clamp_delta(c->pan, MOUSE_COALESCER_WHEEL_MAX);
+    snapshot->timestamp_us = c->timestamp_us;
+    c->x -= snapshot->x;
+    c->y -= snapshot->y;
+    c->wheel -= snapshot->wheel;
+    c->pan -= snapshot->pan;
+    c->pending = c->x != 0 || c->y != 0 || c->wheel != 0 || c->pan != 0;
+    if (!c->pending) {
+        c->timestamp_us = 0;
+    }
+    c->last_emit_us = now;
+}
+
+void mouse_coalescer_reset(mouse_coalescer_t *c) {
+    memset(c, 0, sizeof(*c));
+}
+
+IRAM_ATTR uint8_t mouse_coalescer_add(mouse_coalescer_t *c, const uint8_t buttons, const int32_t x, const int32_t y,
+                                      const int32_t wheel, const int32_t pan, const int64_t timestamp_us,
+                                      const int64_t now, const uint32_t period_us,
+                                      mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT]) {
+    uint8_t count = 0;
+    const bool buttons_changed = buttons != c->buttons;
+
+    // Motion made with the old buttons must not be reported with the new ones (drag start/end).
+    // Anything beyond one full report rides along with the new button state.
+    if (buttons_changed && c->pending) {
+        take_snapshot(c, now, &out[count++]);
+    }
+
+    if (x != 0 || y != 0 || wheel != 0 || pan != 0) {
+        if (!c->pending) {
+            c->timestamp_us = timestamp_us;
+        }
+        c->x = saturating_add(c->x, x);
+        c->y = saturating_add(c->y, y);
+        c->wheel = saturating_add(c->wheel, wheel);
+        c->pan = saturating_add(c->pan, pan);
+        c->pending = c->x != 0 || c->y != 0 || c->wheel != 0 || c->pan != 0;
+    }
+    c->buttons = buttons;
+
+    if (buttons_changed) {
+        if (!c->pending) {
+            c->timestamp_us = timestamp_us;
+        }
+        take_snapshot(c, now, &out[count++]);
+    } else if (c->pending && now - c->last_emit_us >= period_us) {
+        take_snapshot(c, now, &out[count++]);
+    }
+
+    return count;
+}
+
+IRAM_ATTR bool mouse_coalescer_flush(mouse_coalescer_t *c, const int64_t now, mouse_snapshot_t *out) {
+    if (!c->pending) {
+        return false;
+    }
+    take_snapshot(c, now, out);
+    return true;
+}
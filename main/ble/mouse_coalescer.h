@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOUSE_COALESCER_XY_MAX 32767 // see hidReportMap
+#define MOUSE_COALESCER_WHEEL_MAX 127
+#define MOUSE_COALESCER_MAX_OUT 2
+
+// One BLE mouse notification
+typedef struct {
+    uint8_t buttons;
+    int16_t x;
+    int16_t y;
+    int8_t wheel;
+    int8_t pan;
+    int64_t timestamp_us; // capture time of the oldest report merged into it
+} mouse_snapshot_t;
+
+// Motion received but not sent yet. Not thread safe, the caller provides the locking.
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t wheel;
+    int32_t pan;
+    uint8_t buttons;      // the state the pending motion was made with
+    bool pending;         // some motion is left to send
+    int64_t timestamp_us; // capture time of the oldest report not sent yet
+    int64_t last_emit_us;
+} mouse_coalescer_t;
+
+/**
+ * @brief Drop any pending motion and forget the button state
+ * @param c Coalescer
+ */
+void mouse_coalescer_reset(mouse_coalescer_t *c);
+
+/**
+ * @brief Merge a USB mouse report into the pending motion
+ *
+ * On a button change the motion made with the old buttons goes out first, then the new button state.
+ * Otherwise a snapshot is only taken once per emit period.
+ *
+ * @param c Coalescer
+ * @param buttons Button state of the report
+ * @param x,y,wheel,pan Deltas of the report
+ * @param timestamp_us USB capture time of the report
+ * @param now Current time
+ * @param period_us Minimum time between two snapshots
+ * @param out Snapshots to send, in order
+ * @return Number of snapshots written to out, up to MOUSE_COALESCER_MAX_OUT
+ */
+uint8_t mouse_coalescer_add(mouse_coalescer_t *c, uint8_t buttons, int32_t x, int32_t y, int32_t wheel, int32_t pan,
+                            int64_t timestamp_us, int64_t now, uint32_t period_us,
+                            mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT]);
+
+/**
+ * @brief Take whatever motion is pending, for the emit period timer
+ * @param c Coalescer
+ * @param now Current time
+ * @param out Snapshot to send
+ * @return true if out was filled
+ */
+bool mouse_coalescer_flush(mouse_coalescer_t *c, int64_t now, mouse_snapshot_t *out);
+
+#ifdef __cplusplus
+}
+#endif
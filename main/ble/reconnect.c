@@ -0,0 +1,351 @@
+#include "reconnect.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_gap_ble_api.h"
+#include "freertos/FreeRTOS.h"
+#include "const.h"
+#include "connection.h"
+
+#define DIRECTED_BURST_MS 1280 // controller limit for high duty directed advertising
+#define ADV_INT_FAST 0x20      // x 0.625ms, first undirected step
+#define ADV_INT_SLOW 0x800     // 1.28s, the low duty interval the backoff settles on
+#define ADV_STEP_MS 2000       // length of the first undirected step, doubles with each step
+
+static const char *TAG = "BLE_RECONNECT";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_timer = NULL;
+static reconnect_stage_t s_stage = RECONNECT_IDLE;
+static uint8_t s_step = 0;
+static int64_t s_started_us = 0;
+static int64_t s_undirected_at_us = 0;
+static bool s_advertising = false; // the cycle started advertising, a connection must stop it
+
+static uint32_t s_attempts = 0;
+static uint32_t s_directed = 0;
+static uint32_t s_undirected = 0;
+static uint32_t s_last_ms = 0;
+static uint32_t s_min_ms = 0;
+static uint32_t s_max_ms = 0;
+static uint64_t s_total_ms = 0;
+
+static void advertise(esp_ble_adv_params_t *params) {
+    esp_ble_gap_stop_advertising();
+    const esp_err_t err = esp_ble_gap_start_advertising(params);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start advertising: %s", esp_err_to_name(err));
+    }
+}
+
+// Advertises for the cycle that picked the params, unless a connection ended it meanwhile. Checked
+// again once started: a connection that came in between found nothing to stop, so stop it here.
+// Returns whether the cycle is still running.
+static bool advertise_for(const uint32_t attempt, esp_ble_adv_params_t *params) {
+    taskENTER_CRITICAL(&s_lock);
+    const bool running = s_stage != RECONNECT_IDLE && s_attempts == attempt;
+    s_advertising = running;
+    taskEXIT_CRITICAL(&s_lock);
+    if (!running) {
+        return false;
+    }
+
+    advertise(params);
+
+    taskENTER_CRITICAL(&s_lock);
+    const bool ended = s_stage == RECONNECT_IDLE || s_attempts != attempt;
+    taskEXIT_CRITICAL(&s_lock);
+    if (ended) {
+        esp_ble_gap_stop_advertising();
+    }
+    return !ended;
+}
+
+static inline bool is_resolvable(const esp_bd_addr_t addr, const esp_ble_addr_type_t addr_type) {
+    return addr_type == BLE_ADDR_TYPE_RANDOM && (addr[0] & 0xC0) == 0x40;
+}
+
+// Finds the bond of the saved peer. A peer with an identity key is targeted by its identity address,
+// the controller resolves it through the resolving list, so our own address must go through it too.
+static bool bonded_peer(esp_bd_addr_t peer_addr, esp_ble_addr_type_t *peer_addr_type, esp_ble_addr_type_t *own_addr_type) {
+    esp_bd_addr_t saved_addr;
+    esp_ble_addr_type_t saved_type;
+    if (get_saved_device(saved_addr, &saved_type) != ESP_OK) {
+        return false;
+    }
+
+    int num = esp_ble_get_bond_device_num();
+    if (num <= 0) {
+        return false;
+    }
+
+    esp_ble_bond_dev_t *bonds = malloc(sizeof(esp_ble_bond_dev_t) * num);
+    if (bonds == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    if (esp_ble_get_bond_device_list(&num, bonds) == ESP_OK) {
+        for (int i = 0; i < num && !found; i++) {
+            const esp_ble_bond_key_info_t *keys = &bonds[i].bond_key;
+            const bool has_identity = keys->key_mask & ESP_LE_KEY_PID;
+            if (memcmp(bonds[i].bd_addr, saved_addr, ESP_BD_ADDR_LEN) != 0 &&
+                !(has_identity && memcmp(keys->pid_key.static_addr, saved_addr, ESP_BD_ADDR_LEN) == 0)) {
+                continue;
+            }
+
+            found = true;
+            if (has_identity) {
+                memcpy(peer_addr, keys->pid_key.static_addr, ESP_BD_ADDR_LEN);
+                *peer_addr_type = keys->pid_key.addr_type;
+                *own_addr_type = BLE_ADDR_TYPE_RPA_PUBLIC;
+            } else {
+                memcpy(peer_addr, bonds[i].bd_addr, ESP_BD_ADDR_LEN);
+                *peer_addr_type = bonds[i].bd_addr_type;
+                *own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+            }
+        }
+    }
+    free(bonds);
+
+    // Without an identity key a resolvable address has most likely rotated already
+    return found && !(*own_addr_type == BLE_ADDR_TYPE_PUBLIC && is_resolvable(peer_addr, *peer_addr_type));
+}
+
+static bool directed_params(esp_ble_adv_params_t *params) {
+    memset(params, 0, sizeof(*params));
+    if (!bonded_peer(params->peer_addr, &params->peer_addr_type, &params->own_addr_type)) {
+        return false;
+    }
+
+    params->adv_int_min = ADV_INT_FAST; // ignored for high duty, kept valid anyway
+    params->adv_int_max = ADV_INT_FAST;
+    params->adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+    params->channel_map = ADV_CHNL_ALL;
+    params->adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+    return true;
+}
+
+// Returns how long the step lasts in ms, 0 for the last one which lasts until connected
+static uint32_t undirected_params(const uint8_t step, esp_ble_adv_params_t *params) {
+    const uint16_t interval = ADV_INT_FAST << step;
+
+    memset(params, 0, sizeof(*params));
+    params->adv_int_min = interval;
+    params->adv_int_max = interval + interval / 2;
+    params->adv_type = ADV_TYPE_IND;
+    params->own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+    params->channel_map = ADV_CHNL_ALL;
+    params->adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+
+    return interval >= ADV_INT_SLOW ? 0 : ADV_STEP_MS << step;
+}
+
+// Runs in the esp_timer task, each stage arms the timer for the next one
+static void stage_timer_callback(void *arg) {
+    esp_ble_adv_params_t params;
+    uint32_t next_ms = 0;
+    bool advertising = false;
+    bool silence = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    const int64_t holdoff_us = s_undirected_at_us - esp_timer_get_time();
+    switch (s_stage) {
+        case RECONNECT_DIRECTED:
+            if (holdoff_us > 0) {
+                s_stage = RECONNECT_HOLDOFF;
+                next_ms = (holdoff_us + 999) / 1000;
+                silence = true;
+                break;
+            }
+            // fall through
+        case RECONNECT_HOLDOFF:
+            s_stage = RECONNECT_UNDIRECTED;
+            s_step = 0;
+            next_ms = undirected_params(s_step, &params);
+            advertising = true;
+            break;
+        case RECONNECT_UNDIRECTED:
+            s_step++;
+            next_ms = undirected_params(s_step, &params);
+            advertising = true;
+            break;
+        default:
+            break;
+    }
+    if (silence) {
+        s_advertising = false;
+    }
+    reconnect_stage_t stage = s_stage;
+    const uint8_t step = s_step;
+    const uint32_t attempt = s_attempts;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (silence) {
+        esp_ble_gap_stop_advertising();
+    } else if (advertising) {
+        if (VERBOSE) {
+            ESP_LOGI(TAG, "Undirected advertising, step %d, interval %dus", step, params.adv_int_min * 625);
+        }
+        if (!advertise_for(attempt, &params)) {
+            stage = RECONNECT_IDLE;
+        }
+    }
+
+    if (stage != RECONNECT_IDLE && next_ms > 0) {
+        esp_timer_start_once(s_timer, (uint64_t)next_ms * 1000);
+    }
+}
+
+esp_err_t reconnect_init(void) {
+    if (s_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = stage_timer_callback,
+        .name = "reconnect",
+    };
+    const esp_err_t ret = esp_timer_create(&timer_args, &s_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create reconnect timer: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void reconnect_deinit(void) {
+    taskENTER_CRITICAL(&s_lock);
+    s_stage = RECONNECT_IDLE;
+    s_advertising = false;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (s_timer != NULL) {
+        esp_timer_stop(s_timer);
+        esp_timer_delete(s_timer);
+        s_timer = NULL;
+    }
+}
+
+esp_err_t reconnect_start(const uint32_t holdoff_ms) {
+    if (s_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_ble_adv_params_t params;
+    const bool directed = directed_params(&params);
+    const int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    if (s_stage != RECONNECT_IDLE) {
+        taskEXIT_CRITICAL(&s_lock);
+        return ESP_OK;
+    }
+    s_attempts++;
+    s_started_us = now;
+    s_undirected_at_us = now + (int64_t)holdoff_ms * 1000;
+    s_stage = directed ? RECONNECT_DIRECTED : RECONNECT_HOLDOFF;
+    const uint32_t attempt = s_attempts;
+    taskEXIT_CRITICAL(&s_lock);
+
+    esp_timer_stop(s_timer);
+    if (directed) {
+        if (VERBOSE) {
+            ESP_LOGI(TAG, "Directed advertising to %02x:%02x:%02x:%02x:%02x:%02x",
+                     params.peer_addr[0], params.peer_addr[1], params.peer_addr[2],
+                     params.peer_addr[3], params.peer_addr[4], params.peer_addr[5]);
+        }
+        if (!advertise_for(attempt, &params)) {
+            return ESP_OK;
+        }
+        return esp_timer_start_once(s_timer, DIRECTED_BURST_MS * 1000);
+    }
+
+    return esp_timer_start_once(s_timer, (uint64_t)holdoff_ms * 1000);
+}
+
+void reconnect_on_connect(void) {
+    const int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    if (s_stage == RECONNECT_IDLE) {
+        taskEXIT_CRITICAL(&s_lock);
+        return;
+    }
+
+    // A connection right after the directed burst ended still answered the directed PDU
+    const bool directed = s_stage != RECONNECT_UNDIRECTED;
+    const uint32_t elapsed_ms = (now - s_started_us) / 1000;
+    if (directed) {
+        s_directed++;
+    } else {
+        s_undirected++;
+    }
+    s_last_ms = elapsed_ms;
+    s_total_ms += elapsed_ms;
+    if (s_min_ms == 0 || elapsed_ms < s_min_ms) {
+        s_min_ms = elapsed_ms;
+    }
+    if (elapsed_ms > s_max_ms) {
+        s_max_ms = elapsed_ms;
+    }
+    const uint8_t step = s_step;
+    const bool advertising = s_advertising;
+    s_stage = RECONNECT_IDLE;
+    s_advertising = false;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (s_timer != NULL) {
+        esp_timer_stop(s_timer);
+    }
+    // The connection stopped the advertising it answered, not a stage the timer started just before
+    if (advertising) {
+        esp_ble_gap_stop_advertising();
+    }
+
+    if (VERBOSE) {
+        if (directed) {
+            ESP_LOGI(TAG, "Reconnected in %lums (directed)", elapsed_ms);
+        } else {
+            ESP_LOGI(TAG, "Reconnected in %lums (undirected, step %d)", elapsed_ms, step);
+        }
+    }
+}
+
+void reconnect_on_adv_started(const bool success) {
+    if (success || s_timer == NULL) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    const bool directed = s_stage == RECONNECT_DIRECTED;
+    taskEXIT_CRITICAL(&s_lock);
+
+    // e.g. the peer uses a resolvable address the controller can't target, don't wait the burst out
+    if (directed) {
+        ESP_LOGW(TAG, "Directed advertising refused, falling back to undirected");
+        esp_timer_stop(s_timer);
+        esp_timer_start_once(s_timer, 0);
+    }
+}
+
+bool reconnect_active(void) {
+    return s_stage != RECONNECT_IDLE;
+}
+
+void reconnect_get_stats(reconnect_stats_t *stats) {
+    const int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    const uint32_t completed = s_directed + s_undirected;
+    stats->attempts = s_attempts;
+    stats->directed = s_directed;
+    stats->undirected = s_undirected;
+    stats->last_ms = s_last_ms;
+    stats->min_ms = s_min_ms;
+    stats->max_ms = s_max_ms;
+    stats->avg_ms = completed ? s_total_ms / completed : 0;
+    stats->stage = s_stage;
+    stats->elapsed_ms = s_stage != RECONNECT_IDLE ? (now - s_started_us) / 1000 : 0;
+    taskEXIT_CRITICAL(&s_lock);
+}
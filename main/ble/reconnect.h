@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    RECONNECT_IDLE = 0,     // connected, or nobody asked to reconnect
+    RECONNECT_DIRECTED,     // high duty directed advertising to the bonded peer
+    RECONNECT_HOLDOFF,      // radio quiet until the configured reconnect delay has passed
+    RECONNECT_UNDIRECTED,   // undirected advertising, interval backing off step by step
+} reconnect_stage_t;
+
+typedef struct {
+    uint32_t attempts;    // reconnect cycles started
+    uint32_t directed;    // cycles ended by a connection during directed advertising
+    uint32_t undirected;  // cycles ended by a connection during undirected advertising
+    uint32_t last_ms;     // duration of the last completed cycle
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t avg_ms;
+    reconnect_stage_t stage;
+    uint32_t elapsed_ms;  // time spent in the cycle in progress, 0 when idle
+} reconnect_stats_t;
+
+/**
+ * @brief Create the reconnect timer
+ * @return ESP_OK on success
+ */
+esp_err_t reconnect_init(void);
+
+/**
+ * @brief Abandon any cycle in progress and delete the timer
+ */
+void reconnect_deinit(void);
+
+/**
+ * @brief Start a reconnect cycle, no-op if one is already running
+ *
+ * Directed advertising to the saved peer starts right away if it is bonded, targeting its identity
+ * address when it shared one. Otherwise, or once the burst is over, undirected advertising starts
+ * as soon as holdoff_ms have passed since the call. Never blocks.
+ *
+ * @param holdoff_ms Minimum delay before advertising to anyone but the saved peer
+ * @return ESP_OK on success
+ */
+esp_err_t reconnect_start(uint32_t holdoff_ms);
+
+/**
+ * @brief End the cycle in progress and record how long it took
+ */
+void reconnect_on_connect(void);
+
+/**
+ * @brief Feed the result of ESP_GAP_BLE_ADV_START_COMPLETE_EVT
+ * @param success Whether the controller started advertising
+ */
+void reconnect_on_adv_started(bool success);
+
+/**
+ * @brief Check whether a cycle owns the advertising state
+ * @return true while reconnecting
+ */
+bool reconnect_active(void);
+
+/**
+ * @brief Get reconnect time metrics
+ * @param stats Output structure
+ */
+void reconnect_get_stats(reconnect_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
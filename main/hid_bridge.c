@@ -2,7 +2,6 @@
 #include <connection.h>
 #include <const.h>
 #include <esp_gap_ble_api.h>
-#include <hid_device_le_prf.h>
 #include <string.h>
 #include <vmon.h>
 #include <driver/gpio.h>
@@ -17,6 +16,7 @@
 #include "freertos/semphr.h"
 #include "usb/usb_hid_host.h"
 #include "ble_hid_device.h"
+#include "reconnect.h"
 #include "buttons.h"
 #include "hid_actions.h"
 #include "rgb_leds.h"
@@ -24,18 +24,57 @@
 #include "ulp.h"
 #include "web/wifi_manager.h"
 #include "utils/storage.h"
+#include "utils/pointer_transform.h"
+#include "utils/boot_trace.h"
+#include "esp_timer.h"
+
+#define POWER_CHECK_INTERVAL_MS 1000
+#define MOUSE_SENSITIVITY_MIN 50 // percent, range of the settings page sliders
+#define MOUSE_SENSITIVITY_MAX 300
+#define MOUSE_ACCELERATION_MAX 200
+
+// Reports captured while the BLE link is being woken or reconnected, replayed once it is back
+#define PENDING_REPORTS_MAX 16
+#define LINK_WAIT_TIMEOUT_US (5 * 1000 * 1000)
+#define LINK_POLL_MS 10
 
 static const char *TAG = "HID_BRIDGE";
-static StaticTimer_t s_inactivity_timer_struct;
-static StaticTimer_t s_deep_sleep_timer_struct;
+static StaticTimer_t s_power_timer_struct;
 static StaticSemaphore_t s_ble_stack_mutex_struct;
-static TimerHandle_t s_inactivity_timer = NULL;
-static TimerHandle_t s_deep_sleep_timer = NULL;
+static TimerHandle_t s_power_timer = NULL;
 static SemaphoreHandle_t s_ble_stack_mutex = NULL;
 static bool s_hid_bridge_initialized = false;
 static bool s_hid_bridge_running = false;
 static bool s_ble_stack_active = true;
-static uint16_t s_sensitivity = 100;
+
+// Link parked on the keep-alive idle connection parameters, cleared by the first activity
+static bool s_ble_idle = false;
+
+typedef enum {
+    PENDING_KEYBOARD = 0,
+    PENDING_MOUSE,
+    PENDING_CONSUMER,
+    PENDING_SYSTEM,
+} pending_kind_t;
+
+typedef struct {
+    pending_kind_t kind;
+    union {
+        keyboard_report_t keyboard;
+        mouse_report_t mouse;
+        uint16_t usage; // consumer and system control state
+    };
+} pending_report_t;
+
+// Single producer (USB forward task), single consumer (ble_link_task). The consumer pops an entry
+// before sending it, so the producer never merges into or evicts it. s_replaying keeps the producer
+// queueing until the backlog, including the entry in flight, is fully sent.
+static pending_report_t s_pending[PENDING_REPORTS_MAX];
+static uint8_t s_pending_head = 0;
+static uint8_t s_pending_count = 0;
+static bool s_replaying = false;
+static portMUX_TYPE s_pending_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_link_task = NULL;
 
 static int s_inactivity_timeout_ms = 150 * 1000;
 static int s_deep_sleep_timeout_ms = 600 * 1000;
@@ -44,6 +83,35 @@ static bool s_enable_sleep = true;
 static bool s_enable_deep_sleep = true;
 static bool s_never_sleep = false;
 
+// Written on every forwarded report/button, read once per POWER_CHECK_INTERVAL_MS
+static TickType_t s_last_activity = 0;
+
+// Owned by the power check timer
+static TickType_t s_seen_activity = 0;
+static TickType_t s_inactivity_since = 0;
+static TickType_t s_deep_sleep_since = 0;
+static bool s_inactivity_armed = true;
+static bool s_deep_sleep_armed = true;
+
+// Pairs with the re-check in check_inactivity(): either this sees the idle flag, or the check sees the new activity
+static IRAM_ATTR void mark_activity(void) {
+    __atomic_store_n(&s_last_activity, xTaskGetTickCount(), __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&s_ble_idle, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&s_ble_idle, false, __ATOMIC_SEQ_CST)) {
+        ble_hid_device_set_idle(false);
+    }
+}
+
+static void rearm_inactivity(void) {
+    s_inactivity_since = xTaskGetTickCount();
+    s_inactivity_armed = true;
+}
+
+static void rearm_deep_sleep(void) {
+    s_deep_sleep_since = xTaskGetTickCount();
+    s_deep_sleep_armed = true;
+}
+
 static void enter_deep_sleep() {
     if (VERBOSE) {
         ESP_LOGI(TAG, "Going to deep sleep…");
@@ -60,14 +128,15 @@ void enable_no_sleep_mode() {
     s_never_sleep = true;
 }
 
-static void inactivity_timer_callback(const TimerHandle_t xTimer) {
+static void check_inactivity(void) {
     if (xSemaphoreTake(s_ble_stack_mutex, pdMS_TO_TICKS(250)) != pdTRUE) {
-        ESP_LOGW(TAG, "Failed to take BLE stack mutex in inactivity timer");
+        ESP_LOGW(TAG, "Failed to take BLE stack mutex in inactivity check");
+        rearm_inactivity();
         return;
     }
 
     if (!usb_hid_host_device_connected() || !ble_hid_device_connected() || !s_ble_stack_active) {
-        xTimerReset(xTimer, 0);
+        rearm_inactivity();
         xSemaphoreGive(s_ble_stack_mutex);
         return;
     }
@@ -104,21 +173,45 @@ static void inactivity_timer_callback(const TimerHandle_t xTimer) {
             ESP_LOGD(TAG, "Not sleeping while connected to a power source");
         }
 
-        xTimerReset(xTimer, 0);
+        rearm_inactivity();
         xSemaphoreGive(s_ble_stack_mutex);
         return;
     }
 
-    if (VERBOSE) {
-        ESP_LOGI(TAG, "No USB HID events for a while, stopping BLE stack");
-    }
-
     if (!s_two_sleeps) {
         xSemaphoreGive(s_ble_stack_mutex);
         enter_deep_sleep();
         return;
     }
 
+    // Keeping the connection on a slow interval resumes with a single parameter update,
+    // the full teardown is only a fallback for when the update can't even be requested
+    const TickType_t activity = __atomic_load_n(&s_last_activity, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s_ble_idle, true, __ATOMIC_SEQ_CST);
+    if (ble_hid_device_set_idle(true) == ESP_OK) {
+        // Activity in the meantime either missed the flag or sent its wake-up before the idle request,
+        // the link must not be left idle in both cases
+        if (__atomic_load_n(&s_last_activity, __ATOMIC_SEQ_CST) != activity ||
+            !__atomic_load_n(&s_ble_idle, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&s_ble_idle, false, __ATOMIC_SEQ_CST);
+            ble_hid_device_set_idle(false);
+            xSemaphoreGive(s_ble_stack_mutex);
+            return;
+        }
+
+        if (VERBOSE) {
+            ESP_LOGI(TAG, "No USB HID events for a while, BLE link idle");
+        }
+
+        xSemaphoreGive(s_ble_stack_mutex);
+        return;
+    }
+    __atomic_store_n(&s_ble_idle, false, __ATOMIC_SEQ_CST);
+
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "No USB HID events for a while, stopping BLE stack");
+    }
+
     const esp_err_t ret = ble_hid_device_deinit();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to deinitialize BLE HID device: %s", esp_err_to_name(ret));
@@ -129,13 +222,15 @@ static void inactivity_timer_callback(const TimerHandle_t xTimer) {
         }
 
         s_ble_stack_active = false;
-        xSemaphoreGive(s_ble_stack_mutex);
     }
+
+    xSemaphoreGive(s_ble_stack_mutex);
 }
 
-static void deep_sleep_timer_callback(const TimerHandle_t xTimer) {
+static void check_deep_sleep(void) {
     if (xSemaphoreTake(s_ble_stack_mutex, pdMS_TO_TICKS(250)) != pdTRUE) {
-        ESP_LOGW(TAG, "Failed to take BLE stack mutex in deep sleep timer");
+        ESP_LOGW(TAG, "Failed to take BLE stack mutex in deep sleep check");
+        rearm_deep_sleep();
         return;
     }
 
@@ -146,7 +241,7 @@ static void deep_sleep_timer_callback(const TimerHandle_t xTimer) {
     }
 
     if (is_psu_connected()) {
-        xTimerReset(xTimer, 0);
+        rearm_deep_sleep();
         ESP_LOGD(TAG, "Not sleeping while connected to a power source");
         xSemaphoreGive(s_ble_stack_mutex);
         return;
@@ -156,113 +251,312 @@ static void deep_sleep_timer_callback(const TimerHandle_t xTimer) {
     enter_deep_sleep();
 }
 
-static void wakeup() {
-    if (!s_ble_stack_active) {
-        if (xSemaphoreTake(s_ble_stack_mutex, pdMS_TO_TICKS(25)) != pdTRUE) {
-            ESP_LOGW(TAG, "Failed to take BLE stack mutex in process_report");
-            return;
-        }
+// Single low-frequency check replacing per-report timer resets: computes idle time
+// from the last activity timestamp and runs each sleep stage once per idle period
+static void power_timer_callback(const TimerHandle_t xTimer) {
+    const TickType_t now = xTaskGetTickCount();
+    const TickType_t last_activity = __atomic_load_n(&s_last_activity, __ATOMIC_RELAXED);
+
+    if (last_activity != s_seen_activity) {
+        s_seen_activity = last_activity;
+        s_inactivity_since = last_activity;
+        s_deep_sleep_since = last_activity;
+        s_inactivity_armed = true;
+        s_deep_sleep_armed = true;
+    }
 
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "Restarting BLE stack…");
-        }
+    if (s_inactivity_armed && now - s_inactivity_since >= pdMS_TO_TICKS(s_inactivity_timeout_ms)) {
+        s_inactivity_armed = false;
+        check_inactivity();
+    }
 
-        const esp_err_t ret = ble_hid_device_init(VERBOSE);
-        if (ret != ESP_OK) {
-            s_ble_stack_active = false;
-            ESP_LOGE(TAG, "Failed to initialize BLE HID device: %s", esp_err_to_name(ret));
-            xSemaphoreGive(s_ble_stack_mutex);
-            return;
-        }
+    if (s_deep_sleep_armed && now - s_deep_sleep_since >= pdMS_TO_TICKS(s_deep_sleep_timeout_ms)) {
+        s_deep_sleep_armed = false;
+        check_deep_sleep();
+    }
+}
 
-        s_ble_stack_active = true;
+static void restart_ble_stack(void) {
+    if (s_ble_stack_active) {
+        return;
+    }
+
+    if (xSemaphoreTake(s_ble_stack_mutex, pdMS_TO_TICKS(250)) != pdTRUE) {
+        ESP_LOGW(TAG, "Failed to take BLE stack mutex in BLE link task");
+        return;
+    }
+
+    if (s_ble_stack_active) {
         xSemaphoreGive(s_ble_stack_mutex);
+        return;
+    }
 
-        vTaskDelay(pdMS_TO_TICKS(50));
-        if (has_saved_device()) {
-            connect_to_saved_device(get_gatts_if());
-        }
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Restarting BLE stack…");
+    }
+
+    const esp_err_t ret = ble_hid_device_init(VERBOSE);
+    if (ret != ESP_OK) {
+        s_ble_stack_active = false;
+        ESP_LOGE(TAG, "Failed to initialize BLE HID device: %s", esp_err_to_name(ret));
+        xSemaphoreGive(s_ble_stack_mutex);
+        return;
+    }
+
+    s_ble_stack_active = true;
+    xSemaphoreGive(s_ble_stack_mutex);
+
+    vTaskDelay(pdMS_TO_TICKS(50));
+    if (has_saved_device()) {
+        connect_to_saved_device();
     }
 }
 
-static void rot_cb(const int8_t direction) {
-    if (!ble_hid_device_connected()) {
+static IRAM_ATTR void wakeup(void) {
+    if (s_link_task) {
+        xTaskNotifyGive(s_link_task);
+    }
+}
+
+static IRAM_ATTR bool link_ready(void) {
+    return s_ble_stack_active && ble_hid_device_connected();
+}
+
+static IRAM_ATTR inline int32_t saturate_i32(const int64_t value) {
+    return value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : (int32_t)value;
+}
+
+static IRAM_ATTR bool has_pending(void) {
+    return __atomic_load_n(&s_pending_count, __ATOMIC_RELAXED) != 0 || __atomic_load_n(&s_replaying, __ATOMIC_RELAXED);
+}
+
+// Reports are only held for a link that is on its way back: the stack is paused and gets woken, or a
+// reconnect cycle is running. Otherwise nothing would send them but a much later connection, which
+// would replay stale input, so they are dropped. A backlog being replayed keeps queueing to stay in order.
+static IRAM_ATTR bool link_coming_back(void) {
+    return !s_ble_stack_active || reconnect_active() || has_pending();
+}
+
+// Mouse motion with unchanged buttons is merged into the tail entry. When full the oldest entry goes,
+// keyboard and control entries are full states so the final state stays right.
+static IRAM_ATTR void queue_pending(const pending_kind_t kind, const void *report) {
+    if (!link_coming_back()) {
         return;
     }
 
-    char action[24];
-    if (direction == 1) {
-        if (storage_get_string_setting("buttons.encoder.right", action, sizeof(action)) == ESP_OK) {
-            if (VERBOSE) {
-                ESP_LOGI(TAG, "Rotate right, action = %s", action);
-            }
+    taskENTER_CRITICAL(&s_pending_lock);
+    pending_report_t *tail = s_pending_count ?
+        &s_pending[(s_pending_head + s_pending_count - 1) % PENDING_REPORTS_MAX] : NULL;
+
+    const mouse_report_t *mouse = report;
+    const keyboard_report_t *keyboard = report;
+    const uint16_t *usage = report;
+    bool append = !tail || tail->kind != kind;
+
+    if (!append) {
+        switch (kind) {
+            case PENDING_MOUSE:
+                append = tail->mouse.buttons != mouse->buttons;
+                if (!append) {
+                    tail->mouse.x = saturate_i32((int64_t)tail->mouse.x + mouse->x);
+                    tail->mouse.y = saturate_i32((int64_t)tail->mouse.y + mouse->y);
+                    tail->mouse.wheel = saturate_i32((int64_t)tail->mouse.wheel + mouse->wheel);
+                    tail->mouse.pan = saturate_i32((int64_t)tail->mouse.pan + mouse->pan);
+                }
+                break;
+            case PENDING_KEYBOARD:
+                append = tail->keyboard.modifier != keyboard->modifier ||
+                         memcmp(tail->keyboard.key_bitmap, keyboard->key_bitmap, sizeof(keyboard->key_bitmap)) != 0;
+                break;
+            default:
+                append = tail->usage != *usage;
+                break;
+        }
+    }
 
-            execute_action_from_string(ble_conn_id(), "", action, NULL, 0);
+    if (append) {
+        if (s_pending_count == PENDING_REPORTS_MAX) {
+            s_pending_head = (s_pending_head + 1) % PENDING_REPORTS_MAX;
+            s_pending_count--;
         }
-    } else if (direction == -1) {
-        if (storage_get_string_setting("buttons.encoder.left", action, sizeof(action)) == ESP_OK) {
-            if (VERBOSE) {
-                ESP_LOGI(TAG, "Rotate left, action = %s", action);
-            }
 
-            execute_action_from_string(ble_conn_id(), "", action, NULL, 0);
+        pending_report_t *entry = &s_pending[(s_pending_head + s_pending_count) % PENDING_REPORTS_MAX];
+        entry->kind = kind;
+        switch (kind) {
+            case PENDING_MOUSE:
+                entry->mouse = *mouse;
+                entry->mouse.timestamp_us = 0;
+                break;
+            case PENDING_KEYBOARD:
+                entry->keyboard = *keyboard;
+                entry->keyboard.timestamp_us = 0;
+                break;
+            default:
+                entry->usage = *usage;
+                break;
         }
+        s_pending_count++;
     }
+    taskEXIT_CRITICAL(&s_pending_lock);
 
-    xTimerReset(s_inactivity_timer, 0);
-    xTimerReset(s_deep_sleep_timer, 0);
     wakeup();
 }
 
-static void rot_click_cb(void) {
-    if (!ble_hid_device_connected()) {
-        return;
+static void replay_pending(const bool send) {
+    uint8_t replayed = 0;
+    uint8_t dropped = 0;
+    pending_report_t entry;
+
+    while (true) {
+        taskENTER_CRITICAL(&s_pending_lock);
+        const bool empty = s_pending_count == 0;
+        if (!empty) {
+            entry = s_pending[s_pending_head];
+            s_pending_head = (s_pending_head + 1) % PENDING_REPORTS_MAX;
+            s_pending_count--;
+        }
+        s_replaying = !empty;
+        taskEXIT_CRITICAL(&s_pending_lock);
+
+        if (empty) {
+            break;
+        }
+
+        if (send) {
+            switch (entry.kind) {
+                case PENDING_MOUSE:
+                    ble_hid_device_send_mouse_report(&entry.mouse);
+                    break;
+                case PENDING_KEYBOARD:
+                    ble_hid_device_send_keyboard_report(&entry.keyboard);
+                    break;
+                case PENDING_CONSUMER:
+                    ble_hid_device_send_consumer_report(entry.usage);
+                    break;
+                case PENDING_SYSTEM:
+                    ble_hid_device_send_system_report(entry.usage);
+                    break;
+            }
+            replayed++;
+        } else {
+            dropped++;
+        }
     }
 
-    char action[24];
-    if (storage_get_string_setting("buttons.encoder.click", action, sizeof(action)) == ESP_OK) {
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "Click, action = %s", action);
+    if (dropped) {
+        ESP_LOGW(TAG, "BLE link not back in time, dropped %d buffered reports", dropped);
+    } else if (VERBOSE && replayed) {
+        ESP_LOGI(TAG, "Replayed %d buffered reports", replayed);
+    }
+}
+
+// Brings the BLE stack back and replays buffered reports, keeping bluedroid bring-up off the USB tasks
+static void ble_link_task(void *pvParameters) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        restart_ble_stack();
+
+        const int64_t deadline = esp_timer_get_time() + LINK_WAIT_TIMEOUT_US;
+        while (!link_ready() && esp_timer_get_time() < deadline) {
+            vTaskDelay(pdMS_TO_TICKS(LINK_POLL_MS));
         }
 
-        execute_action_from_string(ble_conn_id(), "", action, NULL, 0);
+        replay_pending(link_ready());
     }
+}
 
-    xTimerReset(s_inactivity_timer, 0);
-    xTimerReset(s_deep_sleep_timer, 0);
-    wakeup();
+// Bindings compiled from settings, a physical input dispatches with an array index
+typedef struct {
+    compiled_action_t keys[SETTINGS_NUM_BUTTONS];
+    compiled_action_t long_press[SETTINGS_NUM_BUTTONS];
+    compiled_action_t encoder_left;
+    compiled_action_t encoder_right;
+    compiled_action_t encoder_click;
+} bindings_t;
+
+// Settings are compiled into the table nobody reads and then published, so the button and
+// encoder tasks never dispatch from a half-written one
+static bindings_t s_binding_tables[2];
+static const bindings_t *s_bindings = &s_binding_tables[0];
+
+static inline const bindings_t *current_bindings(void) {
+    return __atomic_load_n(&s_bindings, __ATOMIC_ACQUIRE);
 }
 
-static void execute_button_action(const uint8_t button, bool isLongPress) {
-    char keyActionType[32];
-    sprintf(keyActionType, "buttons.%s[%d].acType", isLongPress ? "longPress" : "keys", button);
+static void compile_button_binding(const settings_button_action_t *config, compiled_action_t *out) {
+    const char *mods[SETTINGS_MAX_MODS];
+    for (int i = 0; i < config->num_mods; i++) {
+        mods[i] = config->mods[i];
+    }
 
-    char keyAction[32];
-    sprintf(keyAction, "buttons.%s[%d].action", isLongPress ? "longPress" : "keys", button);
+    compile_action(config->ac_type, config->action, mods, config->num_mods, out);
+}
 
-    char *mods[4];
-    char mod_buffers[4][8];
-    for(int i = 0; i < 4; i++) {
-        mods[i] = mod_buffers[i];
+static void compile_bindings(const settings_t *settings) {
+    bindings_t *next = current_bindings() == &s_binding_tables[0] ? &s_binding_tables[1] : &s_binding_tables[0];
+    for (int i = 0; i < SETTINGS_NUM_BUTTONS; i++) {
+        compile_button_binding(&settings->buttons.keys[i], &next->keys[i]);
+        compile_button_binding(&settings->buttons.long_press[i], &next->long_press[i]);
     }
-    char modsPath[32];
-    size_t mods_count = 4;
 
-    char acType[24], action[24];
-    if (storage_get_string_setting(keyActionType, acType, sizeof(acType)) == ESP_OK &&
-        storage_get_string_setting(keyAction, action, sizeof(action)) == ESP_OK) {
+    compile_action("", settings->buttons.encoder.left, NULL, 0, &next->encoder_left);
+    compile_action("", settings->buttons.encoder.right, NULL, 0, &next->encoder_right);
+    compile_action("", settings->buttons.encoder.click, NULL, 0, &next->encoder_click);
+    __atomic_store_n(&s_bindings, next, __ATOMIC_RELEASE);
+}
 
+static void rot_cb(const int8_t direction) {
+    if (!ble_hid_device_connected()) {
+        return;
+    }
+
+    const bindings_t *bindings = current_bindings();
+    if (direction == 1) {
         if (VERBOSE) {
-            ESP_LOGI(TAG, "%s, btn #%d, action type = %s, action = %s", isLongPress ? "Long press" : "Click", button, acType, action);
+            ESP_LOGI(TAG, "Rotate right, op = %d, code = 0x%x", bindings->encoder_right.op, bindings->encoder_right.code);
         }
 
-        if (strcmp(acType, "keyboard_combo") == 0) {
-            sprintf(modsPath, "buttons.%s[%d].mods", isLongPress ? "longPress" : "keys", button);
-            storage_get_string_array_setting(modsPath, mods, &mods_count, 8);
+        execute_compiled_action(ble_conn_id(), &bindings->encoder_right);
+    } else if (direction == -1) {
+        if (VERBOSE) {
+            ESP_LOGI(TAG, "Rotate left, op = %d, code = 0x%x", bindings->encoder_left.op, bindings->encoder_left.code);
         }
 
-        execute_action_from_string(ble_conn_id(), acType, action, (const char**)mods, mods_count);
+        execute_compiled_action(ble_conn_id(), &bindings->encoder_left);
+    }
+
+    mark_activity();
+    wakeup();
+}
+
+static void rot_click_cb(void) {
+    if (!ble_hid_device_connected()) {
+        return;
+    }
+
+    const compiled_action_t *action = &current_bindings()->encoder_click;
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Click, op = %d, code = 0x%x", action->op, action->code);
+    }
+
+    execute_compiled_action(ble_conn_id(), action);
+
+    mark_activity();
+    wakeup();
+}
+
+static void execute_button_action(const uint8_t button, bool isLongPress) {
+    if (button >= SETTINGS_NUM_BUTTONS) {
+        return;
     }
+
+    const bindings_t *bindings = current_bindings();
+    const compiled_action_t *action = isLongPress ? &bindings->long_press[button] : &bindings->keys[button];
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "%s, btn #%d, op = %d, code = 0x%x", isLongPress ? "Long press" : "Click", button, action->op, action->code);
+    }
+
+    execute_compiled_action(ble_conn_id(), action);
 }
 
 static void buttons_cb(const uint8_t button) {
@@ -271,8 +565,7 @@ static void buttons_cb(const uint8_t button) {
     }
 
     execute_button_action(button, false);
-    xTimerReset(s_inactivity_timer, 0);
-    xTimerReset(s_deep_sleep_timer, 0);
+    mark_activity();
     wakeup();
 }
 
@@ -282,62 +575,54 @@ static void buttons_long_press_cb(const uint8_t button) {
     }
 
     execute_button_action(button, true);
-    xTimerReset(s_inactivity_timer, 0);
-    xTimerReset(s_deep_sleep_timer, 0);
+    mark_activity();
     wakeup();
 }
 
-esp_err_t hid_bridge_init() {
-    if (s_hid_bridge_initialized) {
-        ESP_LOGW(TAG, "HID bridge already initialized");
-        return ESP_OK;
-    }
-
-    int sleep_timeout;
-    if (storage_get_int_setting("power.sleepTimeout", &sleep_timeout) == ESP_OK) {
-        s_inactivity_timeout_ms = sleep_timeout * 1000;
+static void apply_power_settings(const settings_t *settings) {
+    s_inactivity_timeout_ms = settings->power.sleep_timeout * 1000;
+    s_deep_sleep_timeout_ms = settings->power.deep_sleep_timeout * 1000;
+    s_enable_sleep = settings->power.enable_sleep;
+    s_two_sleeps = settings->power.two_sleeps;
+    s_enable_deep_sleep = settings->power.deep_sleep && settings->power.two_sleeps;
 
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "Sleep timeout set to %d seconds", sleep_timeout);
-        }
-    } else {
-        ESP_LOGW(TAG, "Failed to get sleep timeout from settings, using default");
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Sleep %s, timeout %d seconds", s_enable_sleep ? "enabled" : "disabled", settings->power.sleep_timeout);
+        ESP_LOGI(TAG, "Deep sleep %s, timeout %d seconds", s_enable_deep_sleep ? "enabled" : "disabled", settings->power.deep_sleep_timeout);
     }
+}
 
-    int deep_sleep_timeout;
-    if (storage_get_int_setting("power.deepSleepTimeout", &deep_sleep_timeout) == ESP_OK) {
-        s_deep_sleep_timeout_ms = deep_sleep_timeout * 1000;
+static inline int clamp_int(const int value, const int min, const int max) {
+    return value < min ? min : value > max ? max : value;
+}
 
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "Deep sleep timeout set to %d seconds", deep_sleep_timeout);
-        }
-    } else {
-        ESP_LOGW(TAG, "Failed to get deep sleep timeout from settings, using default");
-    }
+// The settings JSON can hold anything, keep the transform within the range the settings page offers
+static void apply_pointer_settings(const settings_t *settings) {
+    const int mouse_sens = settings->mouse.sensitivity;
+    const int mouse_accel = settings->mouse.acceleration;
+    pointer_transform_init(mouse_sens > 0 ? clamp_int(mouse_sens, MOUSE_SENSITIVITY_MIN, MOUSE_SENSITIVITY_MAX) : 100,
+                           clamp_int(mouse_accel, 0, MOUSE_ACCELERATION_MAX));
+}
 
-    bool enable_sleep;
-    if (storage_get_bool_setting("power.enableSleep", &enable_sleep) == ESP_OK) {
-        s_enable_sleep = enable_sleep;
+// Runs in the task that saved the settings; the power timer picks up new timeouts on its next tick
+static void on_settings_changed(const settings_t *settings, const settings_t *previous) {
+    apply_power_settings(settings);
+    compile_bindings(settings);
 
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "Sleep %s", enable_sleep ? "enabled" : "disabled");
-        }
-    } else {
-        ESP_LOGW(TAG, "Failed to get enable sleep setting, using default (enabled)");
+    if (settings->mouse.sensitivity != previous->mouse.sensitivity ||
+        settings->mouse.acceleration != previous->mouse.acceleration) {
+        apply_pointer_settings(settings);
     }
+}
 
-    bool enable_deep_sleep, two_sleeps;
-    if (storage_get_bool_setting("power.deepSleep", &enable_deep_sleep) == ESP_OK && storage_get_bool_setting("power.twoSleeps", &two_sleeps) == ESP_OK) {
-        s_enable_deep_sleep = enable_deep_sleep && two_sleeps;
-        s_two_sleeps = two_sleeps;
-
-        if (VERBOSE) {
-            ESP_LOGI(TAG, "Deep sleep %s", s_enable_deep_sleep ? "enabled" : "disabled");
-        }
-    } else {
-        ESP_LOGW(TAG, "Failed to get enable deep sleep setting, using default (enabled)");
+esp_err_t hid_bridge_init() {
+    if (s_hid_bridge_initialized) {
+        ESP_LOGW(TAG, "HID bridge already initialized");
+        return ESP_OK;
     }
 
+    apply_power_settings(storage_settings());
+
     s_ble_stack_mutex = xSemaphoreCreateMutexStatic(&s_ble_stack_mutex_struct);
     if (s_ble_stack_mutex == NULL) {
         ESP_LOGE(TAG, "Failed to create BLE stack mutex");
@@ -346,19 +631,10 @@ esp_err_t hid_bridge_init() {
 
     s_ble_stack_active = true;
 
-    s_inactivity_timer = xTimerCreateStatic("inactivity_timer", pdMS_TO_TICKS(s_inactivity_timeout_ms),
-        pdFALSE, NULL, inactivity_timer_callback, &s_inactivity_timer_struct);
-    if (s_inactivity_timer == NULL) {
-        ESP_LOGE(TAG, "Failed to create inactivity timer");
-        vSemaphoreDelete(s_ble_stack_mutex);
-        s_ble_stack_mutex = NULL;
-        return ESP_ERR_NO_MEM;
-    }
-
-    s_deep_sleep_timer = xTimerCreateStatic("deep_sleep_timer", pdMS_TO_TICKS(s_deep_sleep_timeout_ms),
-        pdFALSE, NULL, deep_sleep_timer_callback, &s_deep_sleep_timer_struct);
-    if (s_deep_sleep_timer == NULL) {
-        ESP_LOGE(TAG, "Failed to create deep sleep timer");
+    s_power_timer = xTimerCreateStatic("power_timer", pdMS_TO_TICKS(POWER_CHECK_INTERVAL_MS),
+        pdTRUE, NULL, power_timer_callback, &s_power_timer_struct);
+    if (s_power_timer == NULL) {
+        ESP_LOGE(TAG, "Failed to create power timer");
         vSemaphoreDelete(s_ble_stack_mutex);
         s_ble_stack_mutex = NULL;
         return ESP_ERR_NO_MEM;
@@ -367,41 +643,46 @@ esp_err_t hid_bridge_init() {
     esp_err_t ret = usb_hid_host_init(hid_bridge_process_report);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize USB HID host: %s", esp_err_to_name(ret));
-        xTimerDelete(s_inactivity_timer, 0);
-        xTimerDelete(s_deep_sleep_timer, 0);
+        xTimerDelete(s_power_timer, 0);
         return ret;
     }
+    boot_trace_mark(BOOT_PHASE_USB_HOST);
 
     ret = ble_hid_device_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize BLE HID device: %s", esp_err_to_name(ret));
         usb_hid_host_deinit();
-        xTimerDelete(s_inactivity_timer, 0);
-        xTimerDelete(s_deep_sleep_timer, 0);
+        xTimerDelete(s_power_timer, 0);
         return ret;
     }
+    boot_trace_mark(BOOT_PHASE_BLE_STACK);
+
+    ret = hid_actions_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize HID actions: %s", esp_err_to_name(ret));
+    }
+    compile_bindings(storage_settings());
+    apply_pointer_settings(storage_settings());
+    storage_subscribe(on_settings_changed);
 
-    int mouse_sens;
-    if (storage_get_int_setting("mouse.sensitivity", &mouse_sens) == ESP_OK) {
-        s_sensitivity = mouse_sens;
+    if (s_link_task == NULL) {
+        xTaskCreatePinnedToCore(ble_link_task, "ble_link", 3072, NULL, 7, &s_link_task, 1);
     }
 
     s_hid_bridge_initialized = true;
+    boot_trace_mark(BOOT_PHASE_HID_BRIDGE);
 
     if (VERBOSE) {
         ESP_LOGI(TAG, "HID bridge initialized");
     }
 
     if (has_saved_device()) {
-        connect_to_saved_device(get_gatts_if());
-    }
-
-    if (xTimerStart(s_inactivity_timer, 0) != pdPASS) {
-        ESP_LOGE(TAG, "Failed to start inactivity timer");
+        connect_to_saved_device();
     }
 
-    if (xTimerStart(s_deep_sleep_timer, 0) != pdPASS) {
-        ESP_LOGE(TAG, "Failed to start deep sleep timer");
+    mark_activity();
+    if (xTimerStart(s_power_timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start power timer");
     }
 
     rotary_enc_subscribe(rot_cb);
@@ -421,16 +702,10 @@ esp_err_t hid_bridge_deinit(void) {
         hid_bridge_stop();
     }
 
-    if (s_inactivity_timer != NULL) {
-        xTimerStop(s_inactivity_timer, 0);
-        xTimerDelete(s_inactivity_timer, 0);
-        s_inactivity_timer = NULL;
-    }
-
-    if (s_deep_sleep_timer != NULL) {
-        xTimerStop(s_deep_sleep_timer, 0);
-        xTimerDelete(s_deep_sleep_timer, 0);
-        s_deep_sleep_timer = NULL;
+    if (s_power_timer != NULL) {
+        xTimerStop(s_power_timer, 0);
+        xTimerDelete(s_power_timer, 0);
+        s_power_timer = NULL;
     }
 
     if (xSemaphoreTake(s_ble_stack_mutex, pdMS_TO_TICKS(250)) != pdTRUE) {
@@ -509,8 +784,78 @@ esp_err_t hid_bridge_stop(void) {
     return ESP_OK;
 }
 
+#define HID_KEY_ERROR_ROLLOVER 1
+
+static IRAM_ATTR inline uint32_t read_bits(const uint8_t *data, const uint16_t length, const uint32_t bit_offset,
+                                           const uint8_t bit_size) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bit_size; i++) {
+        const uint32_t bit = bit_offset + i;
+        if (bit / 8 < length && (data[bit / 8] >> (bit % 8) & 1)) {
+            value |= 1UL << i;
+        }
+    }
+    return value;
+}
+
+static IRAM_ATTR void press_key(keyboard_report_t *kb, const uint32_t usage, uint8_t *num_keys) {
+    if (usage >= HID_KEY_LEFT_CTRL && usage <= HID_KEY_RIGHT_GUI) {
+        kb->modifier |= 1 << (usage - HID_KEY_LEFT_CTRL);
+        return;
+    }
+    if (usage <= HID_KEY_ERROR_ROLLOVER || usage >= KEYBOARD_KEY_BITMAP_LEN * 8) {
+        return;
+    }
+
+    kb->key_bitmap[usage / 8] |= 1 << (usage % 8);
+    if (*num_keys < sizeof(kb->keycodes)) {
+        kb->keycodes[(*num_keys)++] = usage;
+    }
+}
+
+// Translates both keycode arrays (boot-style 6KRO) and usage bitmaps (NKRO) into a pressed-key set.
+// Returns false when the keyboard reports a rollover error, the previous state should be kept then.
+static IRAM_ATTR bool translate_keyboard_report(const usb_hid_report_t *report, keyboard_report_t *kb) {
+    uint8_t num_keys = 0;
+
+    for (int i = 0; i < report->info->num_fields; i++) {
+        const usb_hid_field_attr_t *attr = &report->info->attrs[i];
+        const uint16_t bit_offset = report->info->bit_offsets[i];
+        if (attr->usage_page != HID_USAGE_KEYPAD || attr->constant || attr->report_size == 0) {
+            continue;
+        }
+
+        if (attr->array) {
+            if (attr->report_size > 16) {
+                continue;
+            }
+            for (uint16_t j = 0; j < attr->report_count; j++) {
+                const int32_t index = read_bits(report->data, report->length,
+                                                bit_offset + j * attr->report_size, attr->report_size);
+                if (index == 0 || index < attr->logical_min || index > attr->logical_max) {
+                    continue;
+                }
+
+                const uint32_t usage = attr->usage + (index - attr->logical_min);
+                if (usage == HID_KEY_ERROR_ROLLOVER) {
+                    return false;
+                }
+                press_key(kb, usage, &num_keys);
+            }
+        } else if (attr->report_size == 1) {
+            for (uint16_t j = 0; j < attr->report_count; j++) {
+                if (read_bits(report->data, report->length, bit_offset + j, 1)) {
+                    press_key(kb, attr->usage + j, &num_keys);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 static esp_err_t process_keyboard_report(const usb_hid_report_t *report) {
-    const uint8_t expected_fields = usb_hid_host_get_num_fields(report->report_id, report->if_id);
+    const uint16_t expected_fields = usb_hid_host_get_num_fields(report->report_id, report->if_id);
     if (expected_fields != report->info->num_fields) {
         ESP_LOGW(TAG, "Unexpected number of fields: expected=%d, got=%d", expected_fields, report->info->num_fields);
         return ESP_OK;
@@ -519,24 +864,14 @@ static esp_err_t process_keyboard_report(const usb_hid_report_t *report) {
     static keyboard_report_t ble_kb_report = {0};
     memset(&ble_kb_report, 0, sizeof(keyboard_report_t));
 
-    uint8_t btn_idx = 0;
-    for (int i = 0; i < report->info->num_fields; i++) {
-        const usb_hid_field_t *field = &report->fields[i];
-        if (field->value == NULL) {
-            continue;
-        }
+    if (!translate_keyboard_report(report, &ble_kb_report)) {
+        return ESP_OK;
+    }
 
-        if (field->attr.usage_page == HID_USAGE_KEYPAD && !field->attr.constant) {
-            if (field->attr.usage == HID_KEY_LEFT_CTRL) {
-                // field->value is a pointer to the first report array item out of field->attr.report_count
-                // for keyboard, field->value[0] will be HID_KEY_LEFT_CTRL
-                ble_kb_report.modifier = field->value[0];
-            }
-            else if (field->attr.usage == 0 && field->attr.array && !field->attr.constant) {
-                memcpy(&ble_kb_report.keycodes[btn_idx], &((uint8_t*)(field->value))[btn_idx], sizeof(uint8_t));
-                btn_idx++;
-            } 
-        } 
+    ble_kb_report.timestamp_us = report->timestamp_us;
+    if (!link_ready() || has_pending()) {
+        queue_pending(PENDING_KEYBOARD, &ble_kb_report);
+        return ESP_OK;
     }
 
     const esp_err_t ret = ble_hid_device_send_keyboard_report(&ble_kb_report);
@@ -546,89 +881,148 @@ static esp_err_t process_keyboard_report(const usb_hid_report_t *report) {
     return ret;
 }
 
-static mouse_report_t ble_mouse_report = {0};
-
-static IRAM_ATTR esp_err_t process_mouse_report(const usb_hid_report_t *report)
-{
-    ble_mouse_report.buttons = *report->fields[report->info->mouse_fields.buttons].value;
-    ble_mouse_report.x = *report->fields[report->info->mouse_fields.x].value;
-    ble_mouse_report.y = *report->fields[report->info->mouse_fields.y].value;
-    ble_mouse_report.wheel = *report->fields[report->info->mouse_fields.wheel].value;
-    ble_mouse_report.pan = *report->fields[report->info->mouse_fields.pan].value;
-
-    if (s_sensitivity != 100) {
-        ble_mouse_report.x = (int32_t)(int16_t)ble_mouse_report.x * s_sensitivity / 100;
-        ble_mouse_report.y = (int32_t)(int16_t)ble_mouse_report.y * s_sensitivity / 100;
+#define BLE_CONSUMER_MAX_USAGE 0x2A0 // see hidReportMap
+
+#define ROUTED_MOUSE    (1 << 0)
+#define ROUTED_CONSUMER (1 << 1)
+#define ROUTED_SYSTEM   (1 << 2)
+
+// Last control usages seen on USB, shared by all devices like the keys of the BLE keyboard.
+// Only changes are forwarded, what the host already has is tracked per connection by ble_hid_device.
+static uint16_t s_seen_consumer = 0;
+static uint16_t s_seen_system = 0;
+
+static IRAM_ATTR int32_t route_value(const usage_route_t *route, const usb_hid_field_attr_t *attr,
+                                     const int64_t value) {
+    switch (route->transform) {
+        case ROUTE_XF_BITMAP:
+            return (uint32_t)value << route->base;
+        case ROUTE_XF_FLAGS:
+            return value ? route->base + __builtin_ctz((uint32_t)value) : 0;
+        case ROUTE_XF_ARRAY: {
+            const uint32_t mask = (1UL << attr->report_size) - 1;
+            for (uint16_t j = 0; j < attr->report_count; j++) {
+                const int32_t index = ((uint64_t)value >> (j * attr->report_size)) & mask;
+                if (index >= attr->logical_min && index <= attr->logical_max && route->base + index > 0) {
+                    return route->base + index;
+                }
+            }
+            return 0;
+        }
+        default:
+            return saturate_i32(value);
     }
-
-    return ble_hid_device_send_mouse_report(&ble_mouse_report);
-}
-
-bool hid_bridge_is_ble_paused(void) {
-    return !s_ble_stack_active && usb_hid_host_device_connected();
 }
 
-void IRAM_ATTR hid_bridge_process_report(const usb_hid_report_t *const report) {
-    if (!s_hid_bridge_initialized) {
-        ESP_LOGE(TAG, "HID bridge not initialized");
+// Control reports carry state, only changes are forwarded. Buffered like keys while the link is down,
+// a media key that wakes the host still arrives.
+static IRAM_ATTR void send_control(const pending_kind_t kind, uint16_t *seen, const uint16_t usage) {
+    if (usage == *seen) {
         return;
     }
+    *seen = usage;
 
-    if (report == NULL) {
-        ESP_LOGE(TAG, "Report is NULL");
+    if (!link_ready() || has_pending()) {
+        queue_pending(kind, &usage);
         return;
     }
 
-    if (!s_ble_stack_active) {
-        if (xSemaphoreTake(s_ble_stack_mutex, pdMS_TO_TICKS(25)) != pdTRUE) {
-            ESP_LOGW(TAG, "Failed to take BLE stack mutex in process_report");
-            return;
+    if (kind == PENDING_CONSUMER) {
+        ble_hid_device_send_consumer_report(usage);
+    } else {
+        ble_hid_device_send_system_report(usage);
+    }
+}
+
+// One pass over the routes compiled with the descriptor, every routed field lands in its BLE slot
+static IRAM_ATTR void process_routed_report(const usb_hid_report_t *report) {
+    const report_info_t *info = report->info;
+    mouse_report_t mouse = {0};
+    uint16_t consumer = 0;
+    uint16_t system = 0;
+    uint8_t routed = 0;
+
+    for (uint16_t i = 0; i < info->num_routes; i++) {
+        const usage_route_t *route = &info->routes[i];
+        const int32_t value = route_value(route, &info->attrs[route->field], info->values[route->field]);
+
+        switch (route->dst) {
+            case ROUTE_MOUSE_X:
+                mouse.x = saturate_i32((int64_t)mouse.x + value);
+                break;
+            case ROUTE_MOUSE_Y:
+                mouse.y = saturate_i32((int64_t)mouse.y + value);
+                break;
+            case ROUTE_MOUSE_WHEEL:
+                mouse.wheel = saturate_i32((int64_t)mouse.wheel + value);
+                break;
+            case ROUTE_MOUSE_PAN:
+                mouse.pan = saturate_i32((int64_t)mouse.pan + value);
+                break;
+            case ROUTE_MOUSE_BUTTONS:
+                mouse.buttons |= value;
+                break;
+            case ROUTE_CONSUMER:
+                if (!consumer && value <= BLE_CONSUMER_MAX_USAGE) {
+                    consumer = value;
+                }
+                routed |= ROUTED_CONSUMER;
+                continue;
+            case ROUTE_SYSTEM:
+                if (!system && value >= HID_USAGE_SYSTEM_CONTROL_MIN && value <= HID_USAGE_SYSTEM_CONTROL_MAX) {
+                    system = value;
+                }
+                routed |= ROUTED_SYSTEM;
+                continue;
         }
+        routed |= ROUTED_MOUSE;
+    }
 
-        if (!s_ble_stack_active) {
-            if (VERBOSE) {
-                ESP_LOGI(TAG, "USB HID event received, restarting BLE stack");
-            }
+    if (routed & ROUTED_CONSUMER) {
+        send_control(PENDING_CONSUMER, &s_seen_consumer, consumer);
+    }
+    if (routed & ROUTED_SYSTEM) {
+        send_control(PENDING_SYSTEM, &s_seen_system, system);
+    }
+    if (!(routed & ROUTED_MOUSE)) {
+        return;
+    }
 
-            const esp_err_t ret = ble_hid_device_init(VERBOSE);
-            if (ret != ESP_OK) {
-                s_ble_stack_active = false;
-                ESP_LOGE(TAG, "Failed to initialize BLE HID device: %s", esp_err_to_name(ret));
-                xSemaphoreGive(s_ble_stack_mutex);
-                return;
-            }
+    pointer_transform_apply(&mouse.x, &mouse.y);
+    mouse.timestamp_us = report->timestamp_us;
 
-            s_ble_stack_active = true;
-            xSemaphoreGive(s_ble_stack_mutex);
+    if (!link_ready() || has_pending()) {
+        queue_pending(PENDING_MOUSE, &mouse);
+        return;
+    }
 
-            vTaskDelay(pdMS_TO_TICKS(50));
-            if (has_saved_device()) {
-                connect_to_saved_device(get_gatts_if());
-            }
+    ble_hid_device_send_mouse_report(&mouse);
+}
 
-            return;
-        }
+bool hid_bridge_is_ble_paused(void) {
+    return !s_ble_stack_active && usb_hid_host_device_connected();
+}
 
-        xSemaphoreGive(s_ble_stack_mutex);
+void IRAM_ATTR hid_bridge_process_report(const usb_hid_report_t *const report) {
+    if (!s_hid_bridge_initialized) {
+        ESP_LOGE(TAG, "HID bridge not initialized");
         return;
     }
 
-    if (!ble_hid_device_connected()) {
-        ESP_LOGD(TAG, "BLE HID device not connected");
+    if (report == NULL) {
+        ESP_LOGE(TAG, "Report is NULL");
         return;
     }
 
+    boot_trace_mark(BOOT_PHASE_FIRST_USB_REPORT);
+
+    // While the link is down reports are buffered and the wake is handed off to ble_link_task
     if (report->info->is_keyboard) {
         process_keyboard_report(report);
-    } else if (report->info->is_mouse) {
-        process_mouse_report(report);
     }
-
-    if (s_inactivity_timer != NULL && usb_hid_host_device_connected() && ble_hid_device_connected()) {
-        xTimerReset(s_inactivity_timer, 0);
+    if (report->info->num_routes) {
+        process_routed_report(report);
     }
 
-    if (s_deep_sleep_timer != NULL && usb_hid_host_device_connected() && ble_hid_device_connected()) {
-        xTimerReset(s_deep_sleep_timer, 0);
-    }
+    mark_activity();
 }
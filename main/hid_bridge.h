@@ -7,11 +7,10 @@
 extern "C" {
 #endif
 
-#define USB_HOST_MAX_INTERFACES      4
+#define USB_HOST_MAX_DEVICES         4 // behind a hub
+#define USB_HOST_MAX_INTERFACES      4 // per device
+#define USB_HID_MAX_IFACES           (USB_HOST_MAX_DEVICES * USB_HOST_MAX_INTERFACES)
 #define USB_HID_MAX_RAW_REPORT_SIZE  24
-#define MAX_REPORT_FIELDS            16
-#define MAX_COLLECTION_DEPTH         3
-#define MAX_REPORTS_PER_INTERFACE    8
 
 // HID Report Types
 #define HID_TYPE_INPUT       1
@@ -46,6 +45,11 @@ extern "C" {
 #define HID_USAGE_DIAL       0x37
 #define HID_USAGE_WHEEL      0x38
 #define HID_USAGE_HAT_SWITCH 0x39
+#define HID_USAGE_SYSTEM_CONTROL_MIN 0x81 // System Power Down
+#define HID_USAGE_SYSTEM_CONTROL_MAX 0xB7 // System Display Swap, last one of the BLE report
+
+// Consumer Page Usages
+#define HID_USAGE_AC_PAN     0x238
 
 // Mouse Buttons
 #define HID_MOUSE_LEFT       253
@@ -246,8 +250,8 @@ typedef struct {
     uint16_t usage_page;
     uint16_t usage;
     uint16_t usage_maximum;
-    uint8_t report_size;
-    uint8_t report_count;
+    uint16_t report_size;
+    uint16_t report_count;
     int logical_min;
     int logical_max;
     bool constant;
@@ -256,48 +260,93 @@ typedef struct {
     bool array;
 } usb_hid_field_attr_t;
 
-typedef struct {
-    usb_hid_field_attr_t attr;
-    int64_t *value;
-} usb_hid_field_t;
-
 typedef struct {
     usb_hid_field_attr_t attr;
     uint16_t bit_offset;
     uint16_t bit_size;
 } report_field_info_t;
 
+// Extraction ops, compiled once per field by parse_report_descriptor()
+typedef enum {
+    FIELD_OP_GENERIC = 0, // bit-by-bit fallback, extract_field_value()
+    FIELD_OP_SKIP,        // constant/padding, value is always 0
+    FIELD_OP_S8,          // byte-aligned 8 bit, sign-extended
+    FIELD_OP_S16,         // byte-aligned 16 bit little-endian, sign-extended
+    FIELD_OP_S32,         // byte-aligned 32 bit little-endian, sign-extended
+    FIELD_OP_BYTES,       // byte-aligned 5..8 bytes (e.g. 6KRO keycode array), sign-extended
+    FIELD_OP_PACKED,      // unaligned <= 32 bit (e.g. 12-bit X/Y), shift + mask + sign-extend
+    FIELD_OP_BITMAP,      // run of 1-bit usages (buttons, modifiers), shift + mask, unsigned
+} field_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t shift;
+    uint8_t nbytes;
+    uint8_t bit_size;
+    uint16_t byte_offset;
+    uint32_t mask;
+} field_plan_t;
+
+// Outgoing BLE report slot a field is translated into
+typedef enum {
+    ROUTE_MOUSE_X = 0,
+    ROUTE_MOUSE_Y,
+    ROUTE_MOUSE_WHEEL,
+    ROUTE_MOUSE_PAN,
+    ROUTE_MOUSE_BUTTONS,
+    ROUTE_CONSUMER,       // single pressed consumer usage
+    ROUTE_SYSTEM,         // single pressed system control usage
+} route_dst_t;
+
+// How the extracted value becomes the slot value
+typedef enum {
+    ROUTE_XF_VALUE = 0,   // as is (relative axes)
+    ROUTE_XF_BITMAP,      // 1-bit usages, shifted left by base
+    ROUTE_XF_FLAGS,       // 1-bit usages, base + index of the lowest set bit, 0 if none
+    ROUTE_XF_ARRAY,       // usage indices, base + first index within the logical range, 0 if none
+} route_xf_t;
+
+// One field to slot translation, compiled once per field by parse_report_descriptor()
+typedef struct {
+    uint16_t field;
+    uint8_t dst;
+    uint8_t transform;
+    int32_t base;
+} usage_route_t;
+
+// Runtime view of one report. Per-field data is stored as columns of num_fields entries,
+// all of them in the arena of the owning report_map_t.
 typedef struct {
-    report_field_info_t fields[MAX_REPORT_FIELDS];
-    uint8_t num_fields;
+    usb_hid_field_attr_t *attrs;
+    int64_t *values;        // decoded by the forwarding task, only valid during the report callback
+    field_plan_t *plan;
+    uint16_t *bit_offsets;
+    uint16_t *bit_sizes;
     uint16_t total_bits;
-    uint16_t usage_stack[MAX_REPORT_FIELDS];
-    uint8_t usage_stack_pos;
-    bool is_mouse;
+    uint16_t num_fields;
+    usage_route_t *routes;  // fields the keyboard path doesn't handle, in field order
+    uint16_t num_routes;
     bool is_keyboard;
-    struct {
-        uint8_t x;
-        uint8_t y;
-        uint8_t wheel;
-        uint8_t pan;
-        uint8_t buttons;
-    } mouse_fields;
 } report_info_t;
 
+// Sized exactly to the parsed descriptor, released with report_map_free()
 typedef struct {
-    report_info_t reports[MAX_REPORTS_PER_INTERFACE];
-    uint8_t report_ids[MAX_REPORTS_PER_INTERFACE];
-    uint8_t num_reports;
-    uint16_t collection_stack[MAX_COLLECTION_DEPTH];
-    uint8_t collection_depth;
+    report_info_t *reports;
+    uint8_t *report_ids;
+    uint16_t num_reports;
+    bool has_report_ids;  // reports on the wire start with their ID byte
+    void *arena;
+    size_t arena_size;
 } report_map_t;
 
 typedef struct {
-    uint8_t if_id;
+    uint8_t if_id;        // interface slot, unique among the connected devices
     uint8_t report_id;
     usb_hid_field_type_t type;
-    usb_hid_field_t* fields;
-    report_info_t* info;
+    report_info_t* info;  // info->values holds the decoded fields
+    const uint8_t *data;  // raw report without the report ID byte
+    uint16_t length;
+    int64_t timestamp_us; // esp_timer_get_time() at USB capture
 } usb_hid_report_t;
 
 /**
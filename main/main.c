@@ -34,6 +34,7 @@
 // #include "ulp/ulp_bat.h"
 #include "esp_sleep.h"
 #include "wifi_manager.h"
+#include "utils/boot_trace.h"
 
 #define MAIN_LOOP_DELAY_MS 35
 
@@ -50,6 +51,7 @@ static void init_web_stack(void);
 static void rot_long_press_cb(void);
 
 void app_main(void) {
+    boot_trace_start();
     if (VERBOSE) {
         ESP_LOGI(TAG, "Starting USB HID to BLE HID bridge");
     }
@@ -60,12 +62,15 @@ void app_main(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    boot_trace_mark(BOOT_PHASE_NVS);
 
     init_variables();
     init_global_settings();
+    boot_trace_mark(BOOT_PHASE_SETTINGS);
     init_pm();
     init_gpio();
     adc_init();
+    boot_trace_mark(BOOT_PHASE_PERIPHERALS);
 
     const uint8_t btn2 = gpio_get_level(GPIO_BUTTON_SW2);
     if (!btn2) {
@@ -95,7 +100,9 @@ void app_main(void) {
     rotary_enc_init();
     buttons_init();
     led_control_init(NUM_LEDS, GPIO_WS2812B_PIN);
+    boot_trace_mark(BOOT_PHASE_INPUTS);
     descriptor_parser_init();
+    boot_trace_mark(BOOT_PHASE_DESCRIPTOR_CACHE);
     run_hid_bridge();
     rotary_enc_subscribe_long_press(rot_long_press_cb);
 
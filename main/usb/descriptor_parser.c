@@ -1,327 +1,967 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "descriptor_parser.h"
 #include <usb_hid_host.h>
 #include "hid_bridge.h"
+#include <const.h>
 
 #define HID_NVS_NAMESPACE "hid_desc"
+#define DESC_CACHE_VERSION 2
+
 static const char *TAG = "HID_DSC_PRS";
 
-void descriptor_parser_init(void) {
-    // ToDo
-}
-
-void parse_report_descriptor(const uint8_t *desc, const size_t length, const uint8_t interface_num, report_map_t *report_map) {
-    uint16_t current_usage_page = 0;
-    uint8_t report_size = 0;
-    uint8_t report_count = 0;
-    int logical_min = 0;
-    int logical_max = 0;
-    uint16_t current_usage = 0;
-    uint16_t usage_minimum = 0;
-    uint16_t usage_maximum = 0;
-    bool has_usage_range = false;
-    uint8_t current_report_id = 0;
-    bool is_relative = false;
-
-    report_info_t *current_report = &report_map->reports[0];
-    report_map->report_ids[0] = 0;
-    report_map->num_reports = 1;
-    current_report->num_fields = 0;
-    current_report->total_bits = 0;
-    current_report->usage_stack_pos = 0;
-    current_report->is_mouse = false;
-    current_report->is_keyboard = false;
-
-    for (size_t i = 0; i < length;) {
-        const uint8_t item = desc[i++];
-        const uint8_t item_size = item & 0x3;
-        const uint8_t item_type = (item >> 2) & 0x3;
-        const uint8_t item_tag = (item >> 4) & 0xF;
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t field_size;
+    uint16_t num_reports;
+    uint8_t iface_num;   // only used to pick the slot to replace, not part of the match
+    uint16_t vid;
+    uint16_t pid;
+    uint16_t desc_len;
+    uint32_t desc_hash;
+} desc_cache_header_t;
 
-        uint32_t data = 0;
-        if (item_size > 0) {
-            for (uint8_t j = 0; j < item_size && i < length; j++) {
-                data |= desc[i++] << (j * 8);
+typedef struct __attribute__((packed)) {
+    uint8_t report_id;
+    uint16_t num_fields;
+    uint16_t total_bits;
+} desc_cache_report_t;
+
+#define DESC_CACHE_SLOTS USB_HID_MAX_IFACES
+
+// Headers of the cached entries, loaded by descriptor_parser_init(). Entries are found by content,
+// so a keyboard and a mouse on interface 0 of two devices behind a hub get a slot each.
+static desc_cache_header_t s_cache_index[DESC_CACHE_SLOTS];
+static uint32_t s_arena_allocs = 0;
+static uint8_t s_cache_next_victim = 0;
+
+// Parse-time state, grown as the descriptor declares more, only lives until the runtime map is built
+typedef struct {
+    report_field_info_t *fields;
+    uint16_t num_fields;
+    uint16_t capacity;
+    uint16_t total_bits;
+    uint8_t report_id;
+} report_scratch_t;
+
+typedef struct {
+    report_scratch_t *reports;
+    uint16_t num_reports;
+    uint16_t capacity;
+} report_map_scratch_t;
+
+// Global items, saved and restored as a whole by Push/Pop
+typedef struct {
+    uint16_t usage_page;
+    int32_t logical_min;
+    int32_t logical_max;
+    uint32_t logical_max_raw; // zero-extended, plenty of devices encode an unsigned maximum
+    int32_t physical_min;
+    int32_t physical_max;
+    int32_t unit_exponent;
+    uint32_t unit;
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+} hid_globals_t;
+
+// A usage as written. Short ones take the Usage Page in effect at the main item (HID 1.11 6.2.2.8),
+// so a Usage Page that follows the Usage still applies; 4-byte ones carry their own page.
+typedef struct {
+    uint32_t value;
+    bool extended;
+} hid_usage_t;
+
+// Local items, cleared by every main item
+typedef struct {
+    hid_usage_t *usages;
+    uint16_t num_usages;
+    uint16_t capacity;
+    hid_usage_t usage_min;
+    hid_usage_t usage_max;
+    bool has_min;
+    bool has_max;
+    uint8_t delimiter_depth;
+    bool delimiter_taken; // the current delimiter set already gave a usage, the rest are aliases
+} hid_locals_t;
+
+typedef struct {
+    hid_globals_t globals;
+    hid_globals_t *stack;
+    uint16_t stack_depth;
+    uint16_t stack_capacity;
+    hid_locals_t locals;
+    uint16_t collection_depth;
+} hid_parser_t;
+
+// Per-interface footprint of the 8 reports x 16 fields layout this replaced, for the savings log
+#define FIXED_MAP_REPORTS 8
+#define FIXED_MAP_FIELDS 16
+#define FIXED_REPORT_MAP_SIZE \
+    (FIXED_MAP_REPORTS * (FIXED_MAP_FIELDS * (sizeof(report_field_info_t) + sizeof(field_plan_t) + sizeof(uint16_t)) + 16) + \
+     FIXED_MAP_REPORTS + 8)
+
+#define ARENA_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+static void compile_field_plan(const usb_hid_field_attr_t *attr, const uint16_t bit_offset, const uint16_t bit_size,
+                               field_plan_t *plan) {
+    const uint8_t shift = bit_offset % 8;
+
+    plan->op = FIELD_OP_GENERIC;
+    plan->shift = shift;
+    plan->byte_offset = bit_offset / 8;
+    plan->bit_size = bit_size > 64 ? 0 : bit_size;
+    plan->nbytes = (shift + bit_size + 7) / 8;
+    plan->mask = bit_size >= 32 ? 0xFFFFFFFF : (1UL << bit_size) - 1;
+
+    if (attr->constant || bit_size == 0) {
+        plan->op = FIELD_OP_SKIP;
+    } else if (attr->report_size == 1 && bit_size <= 32) {
+        // Button/modifier bitmaps are never signed
+        plan->op = FIELD_OP_BITMAP;
+    } else if (shift == 0 && bit_size == 8) {
+        plan->op = FIELD_OP_S8;
+    } else if (shift == 0 && bit_size == 16) {
+        plan->op = FIELD_OP_S16;
+    } else if (shift == 0 && bit_size == 32) {
+        plan->op = FIELD_OP_S32;
+    } else if (shift == 0 && bit_size % 8 == 0 && bit_size <= 64) {
+        plan->op = FIELD_OP_BYTES;
+    } else if (bit_size <= 32) {
+        plan->op = FIELD_OP_PACKED;
+    }
+}
+
+static void compile_extraction_plan(report_info_t *report) {
+    uint16_t generic = 0;
+    for (int i = 0; i < report->num_fields; i++) {
+        compile_field_plan(&report->attrs[i], report->bit_offsets[i], report->bit_sizes[i], &report->plan[i]);
+        if (report->plan[i].op == FIELD_OP_GENERIC) {
+            generic++;
+        }
+    }
+
+    if (VERBOSE && generic > 0) {
+        ESP_LOGI(TAG, "%d of %d fields use generic extraction", generic, report->num_fields);
+    }
+}
+
+// Picks the BLE report slot a field is translated into, false if nothing on the BLE side takes it
+static bool route_field(const usb_hid_field_attr_t *attr, const uint16_t bit_size, usage_route_t *route) {
+    if (attr->constant || bit_size == 0) {
+        return false;
+    }
+
+    const bool axis = attr->variable && attr->relative;
+    const bool bits = attr->variable && attr->report_size == 1 && bit_size <= 32;
+    const bool indices = attr->array && attr->report_size <= 16 && bit_size <= 64;
+    route->transform = ROUTE_XF_VALUE;
+    route->base = 0;
+
+    switch (attr->usage_page) {
+        case HID_USAGE_PAGE_GENERIC_DESKTOP:
+            if (axis && attr->usage == HID_USAGE_X) {
+                route->dst = ROUTE_MOUSE_X;
+                return true;
+            }
+            if (axis && attr->usage == HID_USAGE_Y) {
+                route->dst = ROUTE_MOUSE_Y;
+                return true;
+            }
+            if (axis && attr->usage == HID_USAGE_WHEEL) {
+                route->dst = ROUTE_MOUSE_WHEEL;
+                return true;
+            }
+            if (attr->usage_maximum < HID_USAGE_SYSTEM_CONTROL_MIN ||
+                attr->usage_maximum > HID_USAGE_SYSTEM_CONTROL_MAX) {
+                return false;
             }
+            route->dst = ROUTE_SYSTEM;
+            break;
+        case HID_USAGE_PAGE_BUTTON:
+            // The BLE mouse has 8 buttons, fields starting further up are dropped
+            if (!bits || attr->usage < 1 || attr->usage > 8) {
+                return false;
+            }
+            route->dst = ROUTE_MOUSE_BUTTONS;
+            route->transform = ROUTE_XF_BITMAP;
+            route->base = attr->usage - 1;
+            return true;
+        case HID_USAGE_PAGE_CONSUMER:
+            if (axis && attr->usage == HID_USAGE_AC_PAN) {
+                route->dst = ROUTE_MOUSE_PAN;
+                return true;
+            }
+            route->dst = ROUTE_CONSUMER;
+            break;
+        default:
+            return false;
+    }
+
+    // Control keys come either as one bit per usage or as an array of usage indices
+    if (bits) {
+        route->transform = ROUTE_XF_FLAGS;
+        route->base = attr->usage;
+        return true;
+    }
+    if (indices) {
+        route->transform = ROUTE_XF_ARRAY;
+        route->base = attr->usage - attr->logical_min;
+        return true;
+    }
+    return false;
+}
+
+static uint16_t count_routes(const report_field_info_t *fields, const uint16_t num_fields) {
+    usage_route_t route;
+    uint16_t count = 0;
+    for (int i = 0; i < num_fields; i++) {
+        if (route_field(&fields[i].attr, fields[i].bit_size, &route)) {
+            count++;
         }
+    }
+    return count;
+}
 
-        switch (item_type) {
-            case 0: // Main
-                switch (item_tag) {
-                    case 8: // Input
-                    case 9: // Output
-                        if (current_report && current_report->num_fields < MAX_REPORT_FIELDS) {
-                            const bool is_constant = (data & 0x01) != 0;
-                            const bool is_variable = (data & 0x02) != 0;
-                            is_relative = (data & 0x04) != 0;
-                            const bool is_array = !is_variable;
-
-                            // If we have a report ID, find or create the corresponding report info
-                            if (current_report_id != 0) {
-                                int report_index = -1;
-                                for (int j = 0; j < report_map->num_reports; j++) {
-                                    if (report_map->report_ids[j] == current_report_id) {
-                                        report_index = j;
-                                        current_report = &report_map->reports[j];
-                                        break;
-                                    }
-                                }
-                                if (report_index == -1) {
-                                    if (report_map->num_reports >= MAX_REPORTS_PER_INTERFACE) {
-                                        ESP_LOGE(TAG, "Too many reports for interface %d", interface_num);
-                                        continue;
-                                    }
-                                    report_index = report_map->num_reports;
-                                    report_map->report_ids[report_index] = current_report_id;
-                                    current_report = &report_map->reports[report_index];
-                                    current_report->num_fields = 0;
-                                    current_report->total_bits = 0;
-                                    current_report->usage_stack_pos = 0;
-                                    current_report->is_mouse = false;
-                                    current_report->is_keyboard = false;
-                                    report_map->num_reports++;
-                                }
-                            }
-
-                            if (is_constant) {
-                                // Handle constant/padding field
-                                report_field_info_t *field = &current_report->fields[current_report->num_fields];
-                                field->attr.usage_page = current_usage_page;
-                                field->attr.usage = 0;
-                                field->attr.usage_maximum = 0;
-                                field->attr.report_size = report_size;
-                                field->attr.report_count = report_count;
-                                field->attr.logical_min = 0;
-                                field->attr.logical_max = 0;
-                                field->attr.constant = true;
-                                field->attr.variable = false;
-                                field->attr.relative = false;
-                                field->attr.array = false;
-                                field->bit_offset = current_report->total_bits;
-                                field->bit_size = report_size * report_count;
-                                current_report->total_bits += report_size * report_count;
-                                current_report->num_fields++;
-                            } else if (is_array) {
-                                // Handle array field - store as single field with range
-                                report_field_info_t *field = &current_report->fields[current_report->num_fields];
-                                field->attr.usage_page = current_usage_page;
-                                if (has_usage_range) {
-                                    field->attr.usage = usage_minimum;
-                                    field->attr.usage_maximum = usage_maximum;
-                                } else if (current_report->usage_stack_pos > 0) {
-                                    field->attr.usage = current_report->usage_stack[0];
-                                    field->attr.usage_maximum = field->attr.usage;
-                                } else {
-                                    field->attr.usage = current_usage;
-                                    field->attr.usage_maximum = field->attr.usage;
-                                }
-                                field->attr.report_size = report_size;
-                                field->attr.report_count = report_count;
-                                field->attr.logical_min = logical_min;
-                                field->attr.logical_max = logical_max;
-                                field->attr.constant = false;
-                                field->attr.variable = false;
-                                field->attr.relative = is_relative;
-                                field->attr.array = true;
-                                field->bit_offset = current_report->total_bits;
-                                field->bit_size = report_size * report_count;
-                                current_report->total_bits += report_size * report_count;
-                                current_report->num_fields++;
-                            } else {
-                                // Handle variable items - FIXED SECTION
-                                if (has_usage_range) {
-                                    // For usage ranges, create a single field with multiple usages
-                                    report_field_info_t *field = &current_report->fields[current_report->num_fields];
-                                    field->attr.usage_page = current_usage_page;
-                                    field->attr.usage = usage_minimum;
-                                    field->attr.usage_maximum = usage_maximum;
-                                    field->attr.report_size = report_size;
-                                    field->attr.report_count = report_count;
-                                    field->attr.logical_min = logical_min;
-                                    field->attr.logical_max = logical_max;
-                                    field->attr.constant = false;
-                                    field->attr.variable = true;
-                                    field->attr.relative = is_relative;
-                                    field->attr.array = false;
-                                    field->bit_offset = current_report->total_bits;
-                                    field->bit_size = report_size * report_count;
-                                    current_report->total_bits += report_size * report_count;
-                                    current_report->num_fields++;
-                                } else {
-                                    // For individual usages
-                                    const uint8_t usages_available = current_report->usage_stack_pos;
-
-                                    if (usages_available == 0 && current_usage != 0) {
-                                        // If we have a single usage but multiple report counts, create one field
-                                        report_field_info_t *field = &current_report->fields[current_report->num_fields];
-                                        field->attr.usage_page = current_usage_page;
-                                        field->attr.usage = current_usage;
-                                        field->attr.usage_maximum = current_usage;
-                                        field->attr.report_size = report_size;
-                                        field->attr.report_count = report_count;
-                                        field->attr.logical_min = logical_min;
-                                        field->attr.logical_max = logical_max;
-                                        field->attr.constant = false;
-                                        field->attr.variable = true;
-                                        field->attr.relative = is_relative;
-                                        field->attr.array = false;
-                                        field->bit_offset = current_report->total_bits;
-                                        field->bit_size = report_size * report_count;
-                                        current_report->total_bits += report_size * report_count;
-                                        current_report->num_fields++;
-                                    } else if (usages_available >= report_count) {
-                                        // If we have enough usages for each report count, create separate fields
-                                        for (uint8_t j = 0; j < report_count && current_report->num_fields < MAX_REPORT_FIELDS; j++) {
-                                            report_field_info_t *field = &current_report->fields[current_report->num_fields];
-                                            field->attr.usage_page = current_usage_page;
-                                            field->attr.usage = current_report->usage_stack[j];
-                                            field->attr.usage_maximum = field->attr.usage;
-                                            field->attr.report_size = report_size;
-                                            field->attr.report_count = 1;
-                                            field->attr.logical_min = logical_min;
-                                            field->attr.logical_max = logical_max;
-                                            field->attr.constant = false;
-                                            field->attr.variable = true;
-                                            field->attr.relative = is_relative;
-                                            field->attr.array = false;
-                                            field->bit_offset = current_report->total_bits;
-                                            field->bit_size = report_size;
-                                            current_report->total_bits += report_size;
-                                            current_report->num_fields++;
-                                        }
-                                    } else {
-                                        // If we don't have enough usages, create one field with the last usage
-                                        report_field_info_t *field = &current_report->fields[current_report->num_fields];
-                                        field->attr.usage_page = current_usage_page;
-                                        field->attr.usage = usages_available > 0 ?
-                                            current_report->usage_stack[usages_available - 1] : current_usage;
-                                        field->attr.usage_maximum = field->attr.usage;
-                                        field->attr.report_size = report_size;
-                                        field->attr.report_count = report_count;
-                                        field->attr.logical_min = logical_min;
-                                        field->attr.logical_max = logical_max;
-                                        field->attr.constant = false;
-                                        field->attr.variable = true;
-                                        field->attr.relative = is_relative;
-                                        field->attr.array = false;
-                                        field->bit_offset = current_report->total_bits;
-                                        field->bit_size = report_size * report_count;
-                                        current_report->total_bits += report_size * report_count;
-                                        current_report->num_fields++;
-                                    }
-                                }
-                            }
-
-                            // Reset usage tracking after field processing
-                            current_report->usage_stack_pos = 0;
-                            has_usage_range = false;
-                            usage_minimum = 0;
-                            usage_maximum = 0;
-                        }
-                        break;
-                    case 10: // Collection
-                        if (report_map->collection_depth < MAX_COLLECTION_DEPTH) {
-                            report_map->collection_stack[report_map->collection_depth++] = data;
-                        }
-                        break;
-                    case 12: // End Collection
-                        if (report_map->collection_depth > 0) {
-                            report_map->collection_depth--;
-                        }
-                        break;
-                }
-                break;
+// report->routes must have room for every routed field, see count_routes()
+static void finalize_report(report_info_t *report) {
+    report->is_keyboard = false;
+    report->num_routes = 0;
+
+    for (int j = 0; j < report->num_fields; j++) {
+        const usb_hid_field_attr_t *attr = &report->attrs[j];
+        if (attr->usage_page == HID_USAGE_KEYPAD) {
+            report->is_keyboard = true;
+        }
+
+        // route_field() fills the route before it knows, only routed fields get a slot
+        usage_route_t route;
+        if (route_field(attr, report->bit_sizes[j], &route)) {
+            route.field = j;
+            report->routes[report->num_routes++] = route;
+        }
+    }
+
+    compile_extraction_plan(report);
+}
+
+// Returns the array to use for count + 1 entries, or NULL (the old array is kept) when out of memory
+static void *grow(void *array, uint16_t *capacity, const uint16_t count, const size_t item_size) {
+    if (count < *capacity) {
+        return array;
+    }
+    if (*capacity == UINT16_MAX) {
+        return NULL;
+    }
+
+    const uint32_t wanted = *capacity ? *capacity * 2 : 4;
+    const uint16_t new_capacity = wanted > UINT16_MAX ? UINT16_MAX : wanted;
+    void *grown = realloc(array, new_capacity * item_size);
+    if (grown) {
+        *capacity = new_capacity;
+    }
+    return grown;
+}
+
+static report_scratch_t *scratch_report(report_map_scratch_t *map, const uint8_t report_id) {
+    for (int i = 0; i < map->num_reports; i++) {
+        if (map->reports[i].report_id == report_id) {
+            return &map->reports[i];
+        }
+    }
+
+    report_scratch_t *reports = grow(map->reports, &map->capacity, map->num_reports, sizeof(report_scratch_t));
+    if (!reports) {
+        return NULL;
+    }
+    map->reports = reports;
+
+    report_scratch_t *report = &reports[map->num_reports++];
+    memset(report, 0, sizeof(report_scratch_t));
+    report->report_id = report_id;
+    return report;
+}
+
+static report_field_info_t *scratch_field(report_scratch_t *report) {
+    report_field_info_t *fields = grow(report->fields, &report->capacity, report->num_fields,
+                                       sizeof(report_field_info_t));
+    if (!fields) {
+        return NULL;
+    }
+    report->fields = fields;
+
+    report_field_info_t *field = &fields[report->num_fields++];
+    memset(field, 0, sizeof(report_field_info_t));
+    return field;
+}
+
+static void scratch_free(report_map_scratch_t *map) {
+    for (int i = 0; i < map->num_reports; i++) {
+        free(map->reports[i].fields);
+    }
+    free(map->reports);
+    memset(map, 0, sizeof(report_map_scratch_t));
+}
 
-            case 1: // Global
-                switch (item_tag) {
-                    case 0: // Usage Page
-                        current_usage_page = data;
-                        break;
-                    case 1: // Logical Minimum
-                        if (item_size == 1 && (data & 0x80)) {
-                            logical_min = (int8_t) data;
-                        } else if (item_size == 2 && (data & 0x8000)) {
-                            logical_min = (int16_t) data;
-                        } else {
-                            logical_min = (int) data;
-                        }
-                        break;
-                    case 2: // Logical Maximum
-                        if (item_size == 1 && (data & 0x80)) {
-                            logical_max = (int8_t) data;
-                        } else if (item_size == 2 && (data & 0x8000)) {
-                            logical_max = (int16_t) data;
-                        } else {
-                            logical_max = (int) data;
-                        }
-                        break;
-                    case 7: // Report Size
-                        report_size = data;
-                        break;
-                    case 8: // Report ID
-                        current_report_id = data;
-                        break;
-                    case 9: // Report Count
-                        report_count = data;
-                        break;
+static esp_err_t add_field(report_scratch_t *report, const hid_globals_t *globals, const uint32_t usage,
+                           const uint32_t usage_max, const uint32_t count, const uint32_t flags) {
+    const uint64_t bits = (uint64_t)globals->report_size * count;
+    if (report->total_bits + bits > UINT16_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    report_field_info_t *field = scratch_field(report);
+    if (!field) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const bool constant = (flags & 0x01) != 0;
+    const bool variable = (flags & 0x02) != 0;
+    field->attr.report_size = globals->report_size;
+    field->attr.report_count = count;
+    field->attr.constant = constant;
+    if (constant) {
+        field->attr.usage_page = globals->usage_page;
+    } else {
+        field->attr.usage_page = usage >> 16;
+        field->attr.usage = usage & 0xFFFF;
+        field->attr.usage_maximum = usage_max & 0xFFFF;
+        field->attr.logical_min = globals->logical_min;
+        field->attr.logical_max = globals->logical_max < globals->logical_min ?
+                                  (int)globals->logical_max_raw : globals->logical_max;
+        field->attr.variable = variable;
+        field->attr.relative = (flags & 0x04) != 0;
+        field->attr.array = !variable;
+    }
+    field->bit_offset = report->total_bits;
+    field->bit_size = bits;
+    report->total_bits += bits;
+    return ESP_OK;
+}
+
+// Extended usage, page << 16 | id
+static inline uint32_t resolve_usage(const hid_globals_t *globals, const hid_usage_t usage) {
+    return usage.extended ? usage.value : (uint32_t)globals->usage_page << 16 | (usage.value & 0xFFFF);
+}
+
+static esp_err_t add_input(hid_parser_t *parser, report_map_scratch_t *map, const uint32_t flags) {
+    const hid_globals_t *globals = &parser->globals;
+    const hid_locals_t *locals = &parser->locals;
+    if (globals->report_size == 0 || globals->report_count == 0) {
+        return ESP_OK;
+    }
+
+    report_scratch_t *report = scratch_report(map, globals->report_id);
+    if (!report) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const bool range = locals->has_min && locals->has_max;
+    const uint32_t first = range ? resolve_usage(globals, locals->usage_min) :
+                           locals->num_usages ? resolve_usage(globals, locals->usages[0]) : 0;
+    const uint32_t last = range ? resolve_usage(globals, locals->usage_max) :
+                          locals->num_usages ? resolve_usage(globals, locals->usages[locals->num_usages - 1]) : first;
+
+    // Padding, arrays (index into the usages) and bitmaps of consecutive usages stay a single field
+    if ((flags & 0x01) || !(flags & 0x02) || (range && globals->report_size == 1)) {
+        return add_field(report, globals, first, last, globals->report_count, flags);
+    }
+
+    // Variable values get a field per usage, the last usage covers whatever count is left
+    const uint32_t available = range ? (last >= first ? last - first + 1 : 1) : locals->num_usages;
+    uint32_t j = 0;
+    for (; j + 1 < available && j < globals->report_count; j++) {
+        const uint32_t usage = range ? first + j : resolve_usage(globals, locals->usages[j]);
+        const esp_err_t err = add_field(report, globals, usage, usage, 1, flags);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (j < globals->report_count) {
+        const uint32_t usage = available == 0 ? 0 : range ? first + j : resolve_usage(globals, locals->usages[j]);
+        return add_field(report, globals, usage, usage, globals->report_count - j, flags);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t main_item(hid_parser_t *parser, report_map_scratch_t *map, const uint8_t tag, const uint32_t data) {
+    esp_err_t err = ESP_OK;
+
+    switch (tag) {
+        case 8: // Input
+            err = add_input(parser, map, data);
+            break;
+        case 9:  // Output
+        case 11: // Feature
+            // Only input reports are forwarded, their bits are counted per report type anyway
+            break;
+        case 10: // Collection
+            if (parser->collection_depth < UINT16_MAX) {
+                parser->collection_depth++;
+            }
+            break;
+        case 12: // End Collection
+            if (parser->collection_depth > 0) {
+                parser->collection_depth--;
+            }
+            break;
+    }
+
+    hid_locals_t *locals = &parser->locals;
+    locals->num_usages = 0;
+    locals->has_min = false;
+    locals->has_max = false;
+    locals->delimiter_depth = 0;
+    locals->delimiter_taken = false;
+    return err;
+}
+
+static esp_err_t global_item(hid_parser_t *parser, const uint8_t tag, const uint32_t data, const int32_t sdata) {
+    hid_globals_t *globals = &parser->globals;
+
+    switch (tag) {
+        case 0: // Usage Page
+            globals->usage_page = data;
+            break;
+        case 1: // Logical Minimum
+            globals->logical_min = sdata;
+            break;
+        case 2: // Logical Maximum
+            globals->logical_max = sdata;
+            globals->logical_max_raw = data;
+            break;
+        case 3: // Physical Minimum
+            globals->physical_min = sdata;
+            break;
+        case 4: // Physical Maximum
+            globals->physical_max = sdata;
+            break;
+        case 5: // Unit Exponent
+            globals->unit_exponent = sdata;
+            break;
+        case 6: // Unit
+            globals->unit = data;
+            break;
+        case 7: // Report Size
+            globals->report_size = data;
+            break;
+        case 8: // Report ID
+            globals->report_id = data;
+            break;
+        case 9: // Report Count
+            globals->report_count = data;
+            break;
+        case 10: { // Push
+            hid_globals_t *stack = grow(parser->stack, &parser->stack_capacity, parser->stack_depth,
+                                        sizeof(hid_globals_t));
+            if (!stack) {
+                return ESP_ERR_NO_MEM;
+            }
+            parser->stack = stack;
+            stack[parser->stack_depth++] = *globals;
+            break;
+        }
+        case 11: // Pop
+            if (parser->stack_depth > 0) {
+                *globals = parser->stack[--parser->stack_depth];
+            } else {
+                ESP_LOGW(TAG, "Pop without Push ignored");
+            }
+            break;
+    }
+    return ESP_OK;
+}
+
+static void local_item(hid_parser_t *parser, const uint8_t tag, const uint32_t data, const uint8_t size) {
+    hid_locals_t *locals = &parser->locals;
+    const hid_usage_t usage = {.value = data, .extended = size == 4};
+    const bool alias = locals->delimiter_depth > 0 && locals->delimiter_taken;
+
+    switch (tag) {
+        case 0: // Usage
+            if (!alias) {
+                hid_usage_t *usages = grow(locals->usages, &locals->capacity, locals->num_usages, sizeof(hid_usage_t));
+                if (usages) {
+                    locals->usages = usages;
+                    usages[locals->num_usages++] = usage;
                 }
+                locals->delimiter_taken = locals->delimiter_depth > 0;
+            }
+            break;
+        case 1: // Usage Minimum
+            if (!alias) {
+                locals->usage_min = usage;
+                locals->has_min = true;
+            }
+            break;
+        case 2: // Usage Maximum
+            if (!alias) {
+                locals->usage_max = usage;
+                locals->has_max = true;
+                locals->delimiter_taken = locals->delimiter_depth > 0;
+            }
+            break;
+        case 10: // Delimiter
+            if (data == 1) {
+                if (locals->delimiter_depth < UINT8_MAX) {
+                    locals->delimiter_depth++;
+                }
+                locals->delimiter_taken = false;
+            } else if (locals->delimiter_depth > 0) {
+                locals->delimiter_depth--;
+            }
+            break;
+        default: // Designator and String items don't affect decoding
+            break;
+    }
+}
+
+// Every read is bounds checked against length, truncated or garbage descriptors only end the parse early
+static esp_err_t parse_into_scratch(const uint8_t *desc, const size_t length, const uint8_t interface_num,
+                                    report_map_scratch_t *map) {
+    hid_parser_t parser = {0};
+    esp_err_t err = ESP_OK;
+    size_t i = 0;
+
+    while (i < length && err == ESP_OK) {
+        const uint8_t prefix = desc[i++];
+
+        if (prefix == 0xFE) {
+            // Long item: bDataSize, bLongItemTag, data. No long item tags are defined, skip them.
+            if (length - i < 2 || length - i - 2 < desc[i]) {
                 break;
+            }
+            i += 2 + desc[i];
+            continue;
+        }
 
-            case 2: // Local
-                switch (item_tag) {
-                    case 0: // Usage
-                        if (current_report && current_report->usage_stack_pos < MAX_REPORT_FIELDS) {
-                            current_report->usage_stack[current_report->usage_stack_pos++] = data;
-                        }
-                        current_usage = data;
-                        break;
-                    case 1: // Usage Minimum
-                        usage_minimum = data;
-                        has_usage_range = true;
-                        break;
-                    case 2: // Usage Maximum
-                        usage_maximum = data;
-                        has_usage_range = true;
-                        break;
-                }
+        const uint8_t size = (prefix & 0x3) == 3 ? 4 : prefix & 0x3;
+        const uint8_t type = (prefix >> 2) & 0x3;
+        const uint8_t tag = (prefix >> 4) & 0xF;
+        if (length - i < size) {
+            ESP_LOGW(TAG, "Truncated item at offset %d for interface %d", i - 1, interface_num);
+            break;
+        }
+
+        uint32_t data = 0;
+        for (uint8_t j = 0; j < size; j++) {
+            data |= (uint32_t)desc[i + j] << (j * 8);
+        }
+        i += size;
+        const int32_t sdata = size == 1 ? (int8_t)data : size == 2 ? (int16_t)data : (int32_t)data;
+
+        switch (type) {
+            case 0:
+                err = main_item(&parser, map, tag, data);
+                break;
+            case 1:
+                err = global_item(&parser, tag, data, sdata);
+                break;
+            case 2:
+                local_item(&parser, tag, data, size);
+                break;
+            default: // Reserved
                 break;
         }
     }
 
-    for (int i = 0; i < report_map->num_reports; i++) {
+    free(parser.stack);
+    free(parser.locals.usages);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to parse descriptor for interface %d: %s", interface_num, esp_err_to_name(err));
+    }
+    return err;
+}
+
+// Arena bytes of one report, padded so the next report's values stay 8-byte aligned
+static size_t report_arena_size(const report_scratch_t *report) {
+    const uint16_t n = report->num_fields;
+    return ARENA_ALIGN(n * (sizeof(int64_t) + sizeof(field_plan_t) + sizeof(usb_hid_field_attr_t) + 2 * sizeof(uint16_t)) +
+                       count_routes(report->fields, n) * sizeof(usage_route_t));
+}
+
+// One allocation holding every column: report infos, then per report its decoded values, plans,
+// routes, attributes, bit offsets and sizes, then the report IDs. Each report starts 8-byte aligned.
+static esp_err_t report_map_build(const report_map_scratch_t *scratch, report_map_t *report_map) {
+    size_t size = ARENA_ALIGN(scratch->num_reports * sizeof(report_info_t));
+    for (int i = 0; i < scratch->num_reports; i++) {
+        size += report_arena_size(&scratch->reports[i]);
+    }
+    size += scratch->num_reports;
+
+    report_map_free(report_map);
+    if (scratch->num_reports == 0) {
+        return ESP_OK;
+    }
+
+    uint8_t *arena = calloc(1, size);
+    if (!arena) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_arena_allocs++;
+
+    report_map->arena = arena;
+    report_map->arena_size = size;
+    report_map->num_reports = scratch->num_reports;
+    report_map->reports = (report_info_t *)arena;
+    size_t pos = ARENA_ALIGN(scratch->num_reports * sizeof(report_info_t));
+
+    for (int i = 0; i < scratch->num_reports; i++) {
+        const report_scratch_t *src = &scratch->reports[i];
         report_info_t *report = &report_map->reports[i];
-        for (int j = 0; j < report->num_fields; j++) {
-            const report_field_info_t *field = &report->fields[j];
+        const uint16_t n = src->num_fields;
+        const size_t report_start = pos;
 
-            if (field->attr.usage_page == HID_USAGE_PAGE_GENERIC_DESKTOP) {
-                if (field->attr.usage == HID_USAGE_X || field->attr.usage == HID_USAGE_Y) {
-                    report->is_mouse = true;
-                }
-                if (field->attr.usage == HID_USAGE_X) {
-                    report->mouse_fields.x = j;
-                } else if (field->attr.usage == HID_USAGE_Y) {
-                    report->mouse_fields.y = j;
-                } else if (field->attr.usage == HID_USAGE_WHEEL) {
-                    report->mouse_fields.wheel = j;
-                }
-            } else if (field->attr.usage == HID_USAGE_PAGE_GENERIC_DESKTOP && field->attr.usage_page == HID_USAGE_PAGE_BUTTON) {
-                report->mouse_fields.buttons = j;
-            } else if (field->attr.usage == 0x238) { // Pan
-                report->mouse_fields.pan = j;
+        report->values = (int64_t *)(arena + pos);
+        pos += n * sizeof(int64_t);
+        report->plan = (field_plan_t *)(arena + pos);
+        pos += n * sizeof(field_plan_t);
+        report->routes = (usage_route_t *)(arena + pos);
+        pos += count_routes(src->fields, n) * sizeof(usage_route_t);
+        report->attrs = (usb_hid_field_attr_t *)(arena + pos);
+        pos += n * sizeof(usb_hid_field_attr_t);
+        report->bit_offsets = (uint16_t *)(arena + pos);
+        report->bit_sizes = report->bit_offsets + n;
+        pos = report_start + report_arena_size(src);
+
+        report->num_fields = n;
+        report->total_bits = src->total_bits;
+        for (int j = 0; j < n; j++) {
+            report->attrs[j] = src->fields[j].attr;
+            report->bit_offsets[j] = src->fields[j].bit_offset;
+            report->bit_sizes[j] = src->fields[j].bit_size;
+        }
+        finalize_report(report);
+    }
+
+    report_map->report_ids = arena + pos;
+    for (int i = 0; i < scratch->num_reports; i++) {
+        report_map->report_ids[i] = scratch->reports[i].report_id;
+        if (scratch->reports[i].report_id != 0) {
+            report_map->has_report_ids = true;
+        }
+    }
+    return ESP_OK;
+}
+
+void report_map_free(report_map_t *report_map) {
+    free(report_map->arena);
+    memset(report_map, 0, sizeof(report_map_t));
+}
+
+size_t report_map_fixed_size(void) {
+    return FIXED_REPORT_MAP_SIZE;
+}
+
+uint32_t report_map_get_alloc_count(void) {
+    return s_arena_allocs;
+}
+
+esp_err_t parse_report_descriptor(const uint8_t *desc, const size_t length, const uint8_t interface_num,
+                                  report_map_t *report_map) {
+    report_map_scratch_t scratch = {0};
+    esp_err_t err = desc ? parse_into_scratch(desc, length, interface_num, &scratch) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_OK) {
+        err = report_map_build(&scratch, report_map);
+    } else {
+        report_map_free(report_map);
+    }
+    scratch_free(&scratch);
+    return err;
+}
+
+static uint32_t descriptor_hash(const uint8_t *desc, const size_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= desc[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void cache_key(const uint8_t slot, char *key, const size_t key_size) {
+    snprintf(key, key_size, "if%u", slot);
+}
+
+static bool cache_header_matches(const desc_cache_header_t *header, const uint16_t vid, const uint16_t pid,
+                                 const size_t desc_len, const uint32_t desc_hash) {
+    return header->version == DESC_CACHE_VERSION &&
+           header->field_size == sizeof(report_field_info_t) &&
+           header->num_reports > 0 &&
+           header->vid == vid && header->pid == pid &&
+           header->desc_len == desc_len && header->desc_hash == desc_hash;
+}
+
+static int cache_find(const uint16_t vid, const uint16_t pid, const size_t desc_len, const uint32_t desc_hash) {
+    for (int i = 0; i < DESC_CACHE_SLOTS; i++) {
+        if (cache_header_matches(&s_cache_index[i], vid, pid, desc_len, desc_hash)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Same device and interface first (its descriptor changed), then a free slot, then round robin
+static uint8_t cache_victim(const desc_cache_header_t *header) {
+    int empty = -1;
+    for (int i = 0; i < DESC_CACHE_SLOTS; i++) {
+        const desc_cache_header_t *entry = &s_cache_index[i];
+        if (entry->version == 0) {
+            if (empty < 0) {
+                empty = i;
             }
+        } else if (entry->vid == header->vid && entry->pid == header->pid && entry->iface_num == header->iface_num) {
+            return i;
+        }
+    }
+
+    if (empty >= 0) {
+        return empty;
+    }
+
+    const uint8_t slot = s_cache_next_victim;
+    s_cache_next_victim = (s_cache_next_victim + 1) % DESC_CACHE_SLOTS;
+    return slot;
+}
+
+void descriptor_parser_init(void) {
+    memset(s_cache_index, 0, sizeof(s_cache_index));
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(HID_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < DESC_CACHE_SLOTS; i++) {
+        char key[8];
+        cache_key(i, key, sizeof(key));
+
+        // Reading a prefix of a blob is not supported, get the whole thing once at boot
+        size_t blob_len = 0;
+        if (nvs_get_blob(nvs_handle, key, NULL, &blob_len) != ESP_OK || blob_len < sizeof(desc_cache_header_t)) {
+            continue;
+        }
+
+        uint8_t *blob = malloc(blob_len);
+        if (!blob) {
+            break;
+        }
+
+        if (nvs_get_blob(nvs_handle, key, blob, &blob_len) == ESP_OK) {
+            memcpy(&s_cache_index[i], blob, sizeof(desc_cache_header_t));
+            if (VERBOSE) {
+                ESP_LOGI(TAG, "Cached descriptor in slot %d: %04x:%04x interface %d, %d reports",
+                         i, s_cache_index[i].vid, s_cache_index[i].pid, s_cache_index[i].iface_num,
+                         s_cache_index[i].num_reports);
+            }
+        }
+        free(blob);
+    }
+
+    nvs_close(nvs_handle);
+}
+
+bool descriptor_cache_load(const uint16_t vid, const uint16_t pid, const uint8_t *desc, const size_t length,
+                           const uint8_t interface_num, report_map_t *report_map) {
+    if (interface_num >= USB_HOST_MAX_INTERFACES || !desc || !report_map) {
+        return false;
+    }
+
+    const uint32_t hash = descriptor_hash(desc, length);
+    const int slot = cache_find(vid, pid, length, hash);
+    if (slot < 0) {
+        return false;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(HID_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    char key[8];
+    cache_key(slot, key, sizeof(key));
+
+    size_t blob_len = 0;
+    uint8_t *blob = NULL;
+    err = nvs_get_blob(nvs_handle, key, NULL, &blob_len);
+    if (err == ESP_OK && blob_len >= sizeof(desc_cache_header_t)) {
+        blob = malloc(blob_len);
+        if (blob) {
+            err = nvs_get_blob(nvs_handle, key, blob, &blob_len);
+        }
+    }
+    nvs_close(nvs_handle);
+
+    if (!blob || err != ESP_OK) {
+        free(blob);
+        return false;
+    }
+
+    // Validate the stored header again, the index may be stale if another device wrote the slot
+    const desc_cache_header_t *header = (const desc_cache_header_t *)blob;
+    bool valid = cache_header_matches(header, vid, pid, length, hash);
+
+    // Counts are only bounded by the blob length, a report with an ID seen before is corrupted
+    report_map_scratch_t scratch = {0};
+    bool out_of_memory = false;
+    size_t pos = sizeof(desc_cache_header_t);
+    for (uint16_t i = 0; valid && i < header->num_reports; i++) {
+        desc_cache_report_t entry;
+        if (pos + sizeof(entry) > blob_len) {
+            valid = false;
+            break;
+        }
+        memcpy(&entry, blob + pos, sizeof(entry));
+        pos += sizeof(entry);
+
+        const size_t fields_len = entry.num_fields * sizeof(report_field_info_t);
+        if (pos + fields_len > blob_len) {
+            valid = false;
+            break;
+        }
 
-            if (field->attr.usage_page == HID_USAGE_KEYPAD) {
-                report->is_keyboard = true;
+        report_scratch_t *report = scratch_report(&scratch, entry.report_id);
+        if (!report) {
+            out_of_memory = true;
+            break;
+        }
+        if (scratch.num_reports != i + 1) {
+            valid = false;
+            break;
+        }
+        report->total_bits = entry.total_bits;
+
+        for (uint16_t j = 0; j < entry.num_fields; j++, pos += sizeof(report_field_info_t)) {
+            report_field_info_t *field = scratch_field(report);
+            if (!field) {
+                out_of_memory = true;
+                break;
+            }
+            memcpy(field, blob + pos, sizeof(report_field_info_t));
+            if (field->bit_offset + field->bit_size > report->total_bits) {
+                valid = false;
+                break;
             }
         }
+        if (out_of_memory) {
+            break;
+        }
+    }
+    valid = valid && (out_of_memory || pos == blob_len);
+    free(blob);
 
-        if (report->is_keyboard) {
-            report->is_mouse = false;
+    if (!valid) {
+        ESP_LOGW(TAG, "Discarding corrupted descriptor cache for interface %d", interface_num);
+        memset(&s_cache_index[slot], 0, sizeof(desc_cache_header_t));
+    }
+
+    const esp_err_t build_err = valid && !out_of_memory ? report_map_build(&scratch, report_map) : ESP_FAIL;
+    scratch_free(&scratch);
+    if (build_err != ESP_OK) {
+        return false;
+    }
+
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Loaded report map for %04x:%04x interface %d from cache", vid, pid, interface_num);
+    }
+
+    return true;
+}
+
+esp_err_t descriptor_cache_store(const uint16_t vid, const uint16_t pid, const uint8_t *desc, const size_t length,
+                                 const uint8_t interface_num, const report_map_t *report_map) {
+    if (interface_num >= USB_HOST_MAX_INTERFACES || !desc || !report_map || report_map->num_reports == 0 ||
+        length > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const desc_cache_header_t header = {
+        .version = DESC_CACHE_VERSION,
+        .field_size = sizeof(report_field_info_t),
+        .num_reports = report_map->num_reports,
+        .iface_num = interface_num,
+        .vid = vid,
+        .pid = pid,
+        .desc_len = length,
+        .desc_hash = descriptor_hash(desc, length),
+    };
+
+    if (cache_find(vid, pid, length, header.desc_hash) >= 0) {
+        return ESP_OK;
+    }
+    const uint8_t slot = cache_victim(&header);
+
+    size_t blob_len = sizeof(header);
+    for (uint16_t i = 0; i < report_map->num_reports; i++) {
+        blob_len += sizeof(desc_cache_report_t) + report_map->reports[i].num_fields * sizeof(report_field_info_t);
+    }
+
+    uint8_t *blob = malloc(blob_len);
+    if (!blob) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(blob, &header, sizeof(header));
+    size_t pos = sizeof(header);
+    for (uint16_t i = 0; i < report_map->num_reports; i++) {
+        const report_info_t *report = &report_map->reports[i];
+        const desc_cache_report_t entry = {
+            .report_id = report_map->report_ids[i],
+            .num_fields = report->num_fields,
+            .total_bits = report->total_bits,
+        };
+        memcpy(blob + pos, &entry, sizeof(entry));
+        pos += sizeof(entry);
+        for (uint16_t j = 0; j < report->num_fields; j++) {
+            const report_field_info_t field = {
+                .attr = report->attrs[j],
+                .bit_offset = report->bit_offsets[j],
+                .bit_size = report->bit_sizes[j],
+            };
+            memcpy(blob + pos, &field, sizeof(field));
+            pos += sizeof(field);
         }
     }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(HID_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        free(blob);
+        return err;
+    }
+
+    char key[8];
+    cache_key(slot, key, sizeof(key));
+    err = nvs_set_blob(nvs_handle, key, blob, blob_len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    free(blob);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving descriptor cache: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_cache_index[slot] = header;
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Cached report map for %04x:%04x interface %d (%d bytes)", vid, pid, interface_num, blob_len);
+    }
+
+    return ESP_OK;
 }
 
 IRAM_ATTR int64_t extract_field_value(const uint8_t *data, const uint16_t bit_offset,
@@ -372,3 +1012,91 @@ IRAM_ATTR int64_t extract_field_value(const uint8_t *data, const uint16_t bit_of
 
     return (int64_t)value;
 }
+
+static IRAM_ATTR inline int64_t sign_extend(const uint64_t value, const uint8_t bit_size) {
+    const uint64_t sign = 1ULL << (bit_size - 1);
+    return (int64_t)((value ^ sign) - sign);
+}
+
+IRAM_ATTR void extract_report_fields(const uint8_t *data, const report_info_t *report, int64_t *values) {
+    const field_plan_t *plan = report->plan;
+    for (uint16_t i = 0; i < report->num_fields; i++, plan++) {
+        const uint8_t *p = data + plan->byte_offset;
+        switch (plan->op) {
+            case FIELD_OP_SKIP:
+                values[i] = 0;
+                break;
+            case FIELD_OP_S8:
+                values[i] = (int8_t)p[0];
+                break;
+            case FIELD_OP_S16:
+                values[i] = (int16_t)(p[0] | p[1] << 8);
+                break;
+            case FIELD_OP_S32:
+                values[i] = (int32_t)(p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+                break;
+            case FIELD_OP_BYTES: {
+                uint64_t value = 0;
+                for (uint8_t j = 0; j < plan->nbytes; j++) {
+                    value |= (uint64_t)p[j] << (j * 8);
+                }
+                values[i] = plan->bit_size < 64 ? sign_extend(value, plan->bit_size) : (int64_t)value;
+                break;
+            }
+            case FIELD_OP_PACKED:
+            case FIELD_OP_BITMAP: {
+                uint64_t window = 0;
+                for (uint8_t j = 0; j < plan->nbytes; j++) {
+                    window |= (uint64_t)p[j] << (j * 8);
+                }
+                const uint32_t value = (window >> plan->shift) & plan->mask;
+                values[i] = plan->op == FIELD_OP_BITMAP ? value : sign_extend(value, plan->bit_size);
+                break;
+            }
+            default:
+                values[i] = extract_field_value(data, report->bit_offsets[i], report->bit_sizes[i]);
+                break;
+        }
+    }
+}
+
+IRAM_ATTR report_info_t *report_map_find(report_map_t *report_map, const uint8_t report_id) {
+    for (int i = 0; i < report_map->num_reports; i++) {
+        if (report_map->report_ids[i] == report_id) {
+            return &report_map->reports[i];
+        }
+    }
+    return NULL;
+}
+
+IRAM_ATTR esp_err_t decode_report(report_map_t *report_map, const uint8_t *data, const size_t length,
+                                  usb_hid_report_t *report) {
+    report->report_id = 0;
+    report->type = USB_HID_FIELD_TYPE_INPUT;
+    report->info = NULL;
+    report->data = data;
+    report->length = length;
+
+    if (report_map->has_report_ids) {
+        if (length == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        report->report_id = data[0];
+        report->data++;
+        report->length--;
+    }
+
+    report->info = report_map_find(report_map, report->report_id);
+    if (!report->info) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // The plan reads total_bits worth of data, a short transfer would decode bytes of an older report.
+    // The length is never more than the ring slot holds, so this also keeps the plan in the slot.
+    if ((report->info->total_bits + 7) / 8 > report->length) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    extract_report_fields(report->data, report->info, report->info->values);
+    return ESP_OK;
+}
@@ -15,12 +15,65 @@ void descriptor_parser_init(void);
 
 /**
  * @brief Parse a HID report descriptor
+ *
+ * Handles every short item of HID 1.11 including Push/Pop and Delimiter, skips long items.
+ * Reports, fields and nesting are only bounded by available memory. Only input items
+ * produce fields.
+ *
  * @param desc Report descriptor data
  * @param length Length of descriptor data
  * @param interface_num Interface number
- * @param report_map Output report map structure
+ * @param report_map Output report map structure, its previous arena is released
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM when out of memory,
+ *         ESP_ERR_INVALID_SIZE if a report is longer than 65535 bits
  */
-void parse_report_descriptor(const uint8_t *desc, size_t length, uint8_t interface_num, report_map_t *report_map);
+esp_err_t parse_report_descriptor(const uint8_t *desc, size_t length, uint8_t interface_num, report_map_t *report_map);
+
+/**
+ * @brief Release the arena of a report map and clear it
+ * @param report_map Report map filled by parse_report_descriptor() or descriptor_cache_load()
+ */
+void report_map_free(report_map_t *report_map);
+
+/**
+ * @brief Get the size a report map took with fixed per-interface capacity
+ * @return Size in bytes, to compare with report_map_t::arena_size
+ */
+size_t report_map_fixed_size(void);
+
+/**
+ * @brief Get the number of report map arenas allocated since boot
+ *
+ * Decode buffers live in the arena, so this must not change while reports are being forwarded.
+ * @return Allocation count
+ */
+uint32_t report_map_get_alloc_count(void);
+
+/**
+ * @brief Load a previously parsed report map from the NVS cache
+ * @param vid Device vendor ID
+ * @param pid Device product ID
+ * @param desc Report descriptor data, hashed to validate the cached entry
+ * @param length Length of descriptor data
+ * @param interface_num Interface number
+ * @param report_map Output report map structure, its previous arena is released
+ * @return true if a valid entry was found and loaded
+ */
+bool descriptor_cache_load(uint16_t vid, uint16_t pid, const uint8_t *desc, size_t length,
+                           uint8_t interface_num, report_map_t *report_map);
+
+/**
+ * @brief Store a parsed report map in the NVS cache, no-op if already cached
+ * @param vid Device vendor ID
+ * @param pid Device product ID
+ * @param desc Report descriptor data
+ * @param length Length of descriptor data
+ * @param interface_num Interface number
+ * @param report_map Parsed report map
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t descriptor_cache_store(uint16_t vid, uint16_t pid, const uint8_t *desc, size_t length,
+                                 uint8_t interface_num, const report_map_t *report_map);
 
 /**
  * @brief Extract a field value from raw report data
@@ -31,6 +84,37 @@ void parse_report_descriptor(const uint8_t *desc, size_t length, uint8_t interfa
  */
 int64_t extract_field_value(const uint8_t *data, uint16_t bit_offset, uint16_t bit_size);
 
+/**
+ * @brief Extract all field values of a report using its compiled plan
+ * @param data Raw report data (without report ID byte)
+ * @param report Report info with a plan compiled by parse_report_descriptor()
+ * @param values Output array, at least report->num_fields entries
+ */
+void extract_report_fields(const uint8_t *data, const report_info_t *report, int64_t *values);
+
+/**
+ * @brief Find the report info of a report ID
+ * @param report_map Report map of the interface
+ * @param report_id Report ID, 0 when the interface has none
+ * @return Report info, or NULL if the descriptor doesn't declare the report
+ */
+report_info_t *report_map_find(report_map_t *report_map, uint8_t report_id);
+
+/**
+ * @brief Decode a raw input report into the values of its report info
+ *
+ * Strips the report ID byte when the interface uses report IDs and fills report_id, type, info,
+ * data and length of the report. if_id and timestamp_us are left to the caller.
+ *
+ * @param report_map Report map of the interface the report came from
+ * @param data Raw report data as received
+ * @param length Length of the raw report
+ * @param report Output report, info->values holds the decoded fields on success
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for an undeclared report ID,
+ *         ESP_ERR_INVALID_SIZE if the report is shorter than its descriptor declares
+ */
+esp_err_t decode_report(report_map_t *report_map, const uint8_t *data, size_t length, usb_hid_report_t *report);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,68 @@
+#include "report_ring.h"
+#include <stdatomic.h>
+#include <string.h>
+#include "esp_attr.h"
+
+#define RING_MASK (REPORT_RING_SLOTS - 1)
+
+_Static_assert((REPORT_RING_SLOTS & RING_MASK) == 0, "REPORT_RING_SLOTS must be a power of two");
+
+// Single producer (HID host callback) / single consumer (forwarding task).
+// head is only written by the producer, tail only by the consumer.
+static ring_report_t s_slots[REPORT_RING_SLOTS];
+static atomic_uint s_head = 0;
+static atomic_uint s_tail = 0;
+static atomic_uint s_overruns = 0;
+static uint32_t s_pushed = 0;
+static uint8_t s_high_water = 0;
+
+void report_ring_reset(void) {
+    atomic_store(&s_head, 0);
+    atomic_store(&s_tail, 0);
+    atomic_store(&s_overruns, 0);
+    s_pushed = 0;
+    s_high_water = 0;
+}
+
+IRAM_ATTR ring_report_t *report_ring_acquire(void) {
+    const unsigned head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    const unsigned tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+    if (head - tail >= REPORT_RING_SLOTS) {
+        atomic_fetch_add_explicit(&s_overruns, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    return &s_slots[head & RING_MASK];
+}
+
+IRAM_ATTR void report_ring_commit(void) {
+    const unsigned head = atomic_load_explicit(&s_head, memory_order_relaxed) + 1;
+    atomic_store_explicit(&s_head, head, memory_order_release);
+    s_pushed++;
+
+    const unsigned used = head - atomic_load_explicit(&s_tail, memory_order_relaxed);
+    if (used > s_high_water) {
+        s_high_water = used;
+    }
+}
+
+IRAM_ATTR const ring_report_t *report_ring_peek(void) {
+    const unsigned tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    const unsigned head = atomic_load_explicit(&s_head, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+
+    return &s_slots[tail & RING_MASK];
+}
+
+IRAM_ATTR void report_ring_release(void) {
+    const unsigned tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    atomic_store_explicit(&s_tail, tail + 1, memory_order_release);
+}
+
+void report_ring_get_stats(report_ring_stats_t *stats) {
+    stats->pushed = s_pushed;
+    stats->overruns = atomic_load_explicit(&s_overruns, memory_order_relaxed);
+    stats->high_water = s_high_water;
+}
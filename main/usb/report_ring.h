@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPORT_RING_SLOTS      16  // must be a power of two
+#define REPORT_RING_DATA_SIZE  64
+
+typedef struct {
+    int64_t timestamp_us;
+    uint8_t if_id;
+    uint8_t length;
+    uint8_t data[REPORT_RING_DATA_SIZE];
+} ring_report_t;
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t overruns;
+    uint8_t high_water;
+} report_ring_stats_t;
+
+/**
+ * @brief Drop all queued reports and reset counters
+ *
+ * Must not be called while the producer or the consumer are running.
+ */
+void report_ring_reset(void);
+
+/**
+ * @brief Get the next free slot (producer side)
+ * @return Slot to fill in, or NULL if the ring is full (counted as an overrun)
+ */
+ring_report_t *report_ring_acquire(void);
+
+/**
+ * @brief Publish the slot returned by report_ring_acquire() (producer side)
+ */
+void report_ring_commit(void);
+
+/**
+ * @brief Get the oldest queued report (consumer side)
+ * @return Report, or NULL if the ring is empty
+ */
+const ring_report_t *report_ring_peek(void);
+
+/**
+ * @brief Release the report returned by report_ring_peek() (consumer side)
+ */
+void report_ring_release(void);
+
+/**
+ * @brief Get ring counters
+ * @param stats Output structure
+ */
+void report_ring_get_stats(report_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,6 +11,8 @@
 #include <lwip/mem.h>
 #include <soc/rtc_cntl_reg.h>
 #include "descriptor_parser.h"
+#include "report_ring.h"
+#include "esp_timer.h"
 
 #define USB_STATS_INTERVAL_SEC  1
 #define DEVICE_EVENT_QUEUE_SIZE 4
@@ -20,83 +22,135 @@ static QueueHandle_t g_device_event_queue = NULL;
 static TaskHandle_t g_device_task_handle = NULL;
 static usb_hid_report_callback_t g_report_callback = NULL;
 
+#define IFACE_SLOT_NONE  0xFF
+#define IFACE_TABLE_SIZE 32 // open-addressed (device address, interface) -> slot, kept at most half full
+
+_Static_assert((IFACE_TABLE_SIZE & (IFACE_TABLE_SIZE - 1)) == 0 && IFACE_TABLE_SIZE >= 2 * USB_HID_MAX_IFACES,
+               "IFACE_TABLE_SIZE must be a power of two with room to spare");
+
 typedef struct __attribute__((packed)) {
     hid_host_device_handle_t device_handle;
     hid_host_driver_event_t event;
+    uint8_t released_slot; // interface closed by its callback and to be freed, or IFACE_SLOT_NONE
+    uint32_t generation;   // of the released interface, the slot may have been reused since
 } usb_device_type_event_t;
 
-static hid_host_device_handle_t g_hid_device_handles[USB_HOST_MAX_INTERFACES] = {NULL};
-static bool g_device_connected[USB_HOST_MAX_INTERFACES] = {false};
+// One opened interface, allocated when it shows up and freed when it goes away. Handed to the
+// interface callback as its argument, slot is the if_id its reports are forwarded with.
+typedef struct {
+    hid_host_device_handle_t handle;
+    report_map_t report_map;
+    uint8_t dev_addr;
+    uint8_t iface_num;
+    uint8_t slot;
+    bool connected;
+    uint32_t generation;
+} usb_hid_iface_t;
+
+static usb_hid_iface_t *g_ifaces[USB_HID_MAX_IFACES];
+static uint8_t g_iface_table[IFACE_TABLE_SIZE]; // slot + 1, 0 for an empty bucket
 static TaskHandle_t g_usb_events_task_handle = NULL;
 static TaskHandle_t g_stats_task_handle = NULL;
+static TaskHandle_t g_forward_task_handle = NULL;
 static uint16_t s_current_rps = 0;
 static StaticSemaphore_t g_report_maps_mutex_buffer;
 static SemaphoreHandle_t g_report_maps_mutex;
 static usb_hid_report_t g_report;
 static usb_host_client_handle_t client_hdl;
 static uint8_t client_addr;
-static uint8_t g_num_fields;
 static bool usb_host_dev_connected = false;
-static usb_hid_field_t *g_fields = NULL;
-static int64_t *g_field_values = NULL;
-static report_map_t *g_interface_report_maps = NULL;
-static report_info_t ***report_lookup_table = NULL;
-static uint8_t **g_field_counts = NULL;
+static uint32_t s_iface_generation = 0;
 
 static void usb_lib_task(void *arg);
 static void usb_stats_task(void *arg);
 static void device_event_task(void *arg);
+static void report_forward_task(void *arg);
 static void hid_host_device_callback(hid_host_device_handle_t hid_device_handle, hid_host_driver_event_t event, void *arg);
 static void hid_host_interface_callback(hid_host_device_handle_t hid_device_handle, hid_host_interface_event_t event, void *arg);
 
-static void cleanup_all_resources(void) {
-    if (g_fields) {
-        free(g_fields);
-        g_fields = NULL;
-    }
+static inline uint8_t iface_bucket(const uint8_t dev_addr, const uint8_t iface_num) {
+    return (dev_addr * USB_HOST_MAX_INTERFACES + iface_num) & (IFACE_TABLE_SIZE - 1);
+}
 
-    if (g_field_values) {
-        free(g_field_values);
-        g_field_values = NULL;
+static void iface_table_insert(const usb_hid_iface_t *iface) {
+    uint8_t pos = iface_bucket(iface->dev_addr, iface->iface_num);
+    while (g_iface_table[pos] != 0) {
+        pos = (pos + 1) & (IFACE_TABLE_SIZE - 1);
     }
+    g_iface_table[pos] = iface->slot + 1;
+}
 
-    if (g_interface_report_maps) {
-        free(g_interface_report_maps);
-        g_interface_report_maps = NULL;
+// Linear probing can't simply clear a bucket, the table is small enough to rebuild instead
+static void iface_table_rebuild(void) {
+    memset(g_iface_table, 0, sizeof(g_iface_table));
+    for (int i = 0; i < USB_HID_MAX_IFACES; i++) {
+        if (g_ifaces[i]) {
+            iface_table_insert(g_ifaces[i]);
+        }
     }
+}
 
-    if (g_field_counts) {
-        for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-            if (g_field_counts[i]) {
-                free(g_field_counts[i]);
-            }
+static usb_hid_iface_t *iface_find(const uint8_t dev_addr, const uint8_t iface_num) {
+    uint8_t pos = iface_bucket(dev_addr, iface_num);
+    for (int i = 0; i < IFACE_TABLE_SIZE && g_iface_table[pos] != 0; i++) {
+        usb_hid_iface_t *iface = g_ifaces[g_iface_table[pos] - 1];
+        if (iface->dev_addr == dev_addr && iface->iface_num == iface_num) {
+            return iface;
         }
-        free(g_field_counts);
-        g_field_counts = NULL;
+        pos = (pos + 1) & (IFACE_TABLE_SIZE - 1);
     }
+    return NULL;
+}
 
-    if (report_lookup_table) {
-        for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-            if (report_lookup_table[i]) {
-                for (int j = 0; j < MAX_REPORTS_PER_INTERFACE; j++) {
-                    if (report_lookup_table[i][j]) {
-                        free(report_lookup_table[i][j]);
-                    }
-                }
-                free(report_lookup_table[i]);
-            }
+// Caller holds g_report_maps_mutex
+static usb_hid_iface_t *iface_create(const uint8_t dev_addr, const uint8_t iface_num) {
+    for (uint8_t slot = 0; slot < USB_HID_MAX_IFACES; slot++) {
+        if (g_ifaces[slot]) {
+            continue;
         }
-        free(report_lookup_table);
-        report_lookup_table = NULL;
+
+        usb_hid_iface_t *iface = calloc(1, sizeof(usb_hid_iface_t));
+        if (!iface) {
+            return NULL;
+        }
+
+        iface->dev_addr = dev_addr;
+        iface->iface_num = iface_num;
+        iface->slot = slot;
+        iface->generation = ++s_iface_generation;
+        g_ifaces[slot] = iface;
+        iface_table_insert(iface);
+        return iface;
     }
+    return NULL;
+}
+
+// Caller holds g_report_maps_mutex, the handle must be closed already
+static void iface_release(const uint8_t slot) {
+    usb_hid_iface_t *iface = g_ifaces[slot];
+    if (!iface) {
+        return;
+    }
+
+    g_ifaces[slot] = NULL;
+    iface_table_rebuild();
+    report_map_free(&iface->report_map);
+    free(iface);
+}
+
+// Whoever takes the handle closes it, the interface callback or the device task
+static hid_host_device_handle_t iface_take_handle(usb_hid_iface_t *iface) {
+    return __atomic_exchange_n(&iface->handle, NULL, __ATOMIC_ACQ_REL);
+}
 
-    for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-        if (g_hid_device_handles[i]) {
-            hid_host_device_stop(g_hid_device_handles[i]);
-            hid_host_device_close(g_hid_device_handles[i]);
-            g_hid_device_handles[i] = NULL;
+static void cleanup_all_resources(void) {
+    for (int i = 0; i < USB_HID_MAX_IFACES; i++) {
+        const hid_host_device_handle_t handle = g_ifaces[i] ? iface_take_handle(g_ifaces[i]) : NULL;
+        if (handle) {
+            hid_host_device_stop(handle);
+            hid_host_device_close(handle);
         }
-        g_device_connected[i] = false;
+        iface_release(i);
     }
 }
 
@@ -155,11 +209,14 @@ static void send_linux_like_control_transfers() {
     }
 }
 
-uint8_t usb_hid_host_get_num_fields(const uint8_t report_id, const uint8_t interface_num) {
-    if (!g_field_counts || !g_field_counts[interface_num]) {
+uint16_t usb_hid_host_get_num_fields(const uint8_t report_id, const uint8_t interface_num) {
+    usb_hid_iface_t *iface = interface_num < USB_HID_MAX_IFACES ? g_ifaces[interface_num] : NULL;
+    if (!iface) {
         return 0;
     }
-    return g_field_counts[interface_num][report_id];
+
+    const report_info_t *report = report_map_find(&iface->report_map, report_id);
+    return report ? report->num_fields : 0;
 }
 
 static void client_event_callback(const usb_host_client_event_msg_t *event_msg, void *);
@@ -174,38 +231,9 @@ esp_err_t usb_hid_host_init(const usb_hid_report_callback_t report_callback) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    memset(g_hid_device_handles, 0, sizeof(g_hid_device_handles));
-    memset(g_device_connected, 0, sizeof(g_device_connected));
-
-    g_interface_report_maps = calloc(USB_HOST_MAX_INTERFACES, sizeof(report_map_t));
-    if (!g_interface_report_maps) {
-        ESP_LOGE(TAG, "Failed to allocate report maps");
-        return ESP_ERR_NO_MEM;
-    }
-
-    g_field_counts = calloc(USB_HOST_MAX_INTERFACES, sizeof(uint8_t *));
-    if (!g_field_counts) {
-        cleanup_all_resources();
-        ESP_LOGE(TAG, "Failed to allocate field counts array");
-        return ESP_ERR_NO_MEM;
-    }
-
-    report_lookup_table = calloc(USB_HOST_MAX_INTERFACES, sizeof(report_info_t **));
-    if (!report_lookup_table) {
-        cleanup_all_resources();
-        ESP_LOGE(TAG, "Failed to allocate lookup table");
-        return ESP_ERR_NO_MEM;
-    }
-
-    for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-        g_field_counts[i] = calloc(MAX_REPORTS_PER_INTERFACE, sizeof(uint8_t));
-        report_lookup_table[i] = calloc(MAX_REPORTS_PER_INTERFACE, sizeof(report_info_t *));
-        if (!g_field_counts[i] || !report_lookup_table[i]) {
-            cleanup_all_resources();
-            ESP_LOGE(TAG, "Failed to allocate interface resources");
-            return ESP_ERR_NO_MEM;
-        }
-    }
+    memset(g_ifaces, 0, sizeof(g_ifaces));
+    memset(g_iface_table, 0, sizeof(g_iface_table));
+    g_report_maps_mutex = xSemaphoreCreateMutexStatic(&g_report_maps_mutex_buffer);
 
     esp_err_t err = task_monitor_init();
     if (err != ESP_OK) {
@@ -226,7 +254,7 @@ esp_err_t usb_hid_host_init(const usb_hid_report_callback_t report_callback) {
         return ESP_ERR_NO_MEM;
     }
 
-    BaseType_t task_created = xTaskCreatePinnedToCore(device_event_task, "dev_evt", 2048, NULL, 6,
+    BaseType_t task_created = xTaskCreatePinnedToCore(device_event_task, "dev_evt", 3072, NULL, 6,
                                                       &g_device_task_handle, 1);
     if (task_created != pdTRUE) {
         cleanup_all_resources();
@@ -234,7 +262,16 @@ esp_err_t usb_hid_host_init(const usb_hid_report_callback_t report_callback) {
         return ESP_ERR_NO_MEM;
     }
 
-    g_report_maps_mutex = xSemaphoreCreateMutexStatic(&g_report_maps_mutex_buffer);
+    report_ring_reset();
+    task_created = xTaskCreatePinnedToCore(report_forward_task, "usb_fwd", 3072, NULL, 15,
+                                           &g_forward_task_handle, 1);
+    if (task_created != pdTRUE) {
+        cleanup_all_resources();
+        vTaskDelete(g_device_task_handle);
+        vQueueDelete(g_device_event_queue);
+        return ESP_ERR_NO_MEM;
+    }
+
     const usb_host_config_t host_config = {
         .skip_phy_setup = false,
         .intr_flags = ESP_INTR_FLAG_LEVEL1,
@@ -297,10 +334,10 @@ esp_err_t usb_hid_host_deinit(void) {
 
     esp_err_t ret = ESP_OK;
 
-    for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-        if (g_hid_device_handles[i] != NULL && g_device_connected[i]) {
+    for (int i = 0; i < USB_HID_MAX_IFACES; i++) {
+        if (g_ifaces[i] != NULL && g_ifaces[i]->handle != NULL && g_ifaces[i]->connected) {
             ESP_LOGD(TAG, "Stopping device on interface %d", i);
-            const esp_err_t stop_err = hid_host_device_stop(g_hid_device_handles[i]);
+            const esp_err_t stop_err = hid_host_device_stop(g_ifaces[i]->handle);
             if (stop_err != ESP_OK) {
                 ESP_LOGW(TAG, "Failed to stop device on interface %d: %s", i, esp_err_to_name(stop_err));
             }
@@ -309,17 +346,17 @@ esp_err_t usb_hid_host_deinit(void) {
         }
     }
 
-    for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-        if (g_hid_device_handles[i] != NULL) {
+    for (int i = 0; i < USB_HID_MAX_IFACES; i++) {
+        const hid_host_device_handle_t handle = g_ifaces[i] ? iface_take_handle(g_ifaces[i]) : NULL;
+        if (handle != NULL) {
             ESP_LOGD(TAG, "Closing device on interface %d", i);
 
-            const esp_err_t close_err = hid_host_device_close(g_hid_device_handles[i]);
+            const esp_err_t close_err = hid_host_device_close(handle);
             if (close_err != ESP_OK) {
                 ESP_LOGW(TAG, "Close failed for interface %d: %s", i, esp_err_to_name(close_err));
             }
 
-            g_hid_device_handles[i] = NULL;
-            g_device_connected[i] = false;
+            g_ifaces[i]->connected = false;
         }
     }
 
@@ -343,6 +380,11 @@ esp_err_t usb_hid_host_deinit(void) {
         g_device_task_handle = NULL;
     }
 
+    if (g_forward_task_handle != NULL) {
+        vTaskDelete(g_forward_task_handle);
+        g_forward_task_handle = NULL;
+    }
+
     if (g_device_event_queue != NULL) {
         vQueueDelete(g_device_event_queue);
         g_device_event_queue = NULL;
@@ -379,108 +421,128 @@ bool usb_hid_host_device_connected(void) {
         return true;
     }
 
-    for (int i = 0; i < USB_HOST_MAX_INTERFACES; i++) {
-        if (g_device_connected[i]) {
+    for (int i = 0; i < USB_HID_MAX_IFACES; i++) {
+        if (g_ifaces[i] && g_ifaces[i]->connected) {
             return true;
         }
     }
     return false;
 }
 
-static uint8_t *data_ptr = NULL;
-
-static IRAM_ATTR void process_report(uint8_t *const data, const size_t length,
-                                                                   const uint8_t interface_num) {
+static IRAM_ATTR void process_report(const uint8_t *const data, const size_t length,
+                                     const uint8_t slot, const int64_t timestamp_us) {
     s_current_rps++;
-    if (!data || !g_report_callback || length <= 1 || interface_num >= USB_HOST_MAX_INTERFACES) {
-        ESP_LOGW(TAG, "Invalid params: data=%p, cb=%p, len=%d, if=%u", data, g_report_callback, length, interface_num);
+    if (!data || !g_report_callback || length <= 1 || slot >= USB_HID_MAX_IFACES) {
+        ESP_LOGW(TAG, "Invalid params: data=%p, cb=%p, len=%d, if=%u", data, g_report_callback, length, slot);
         return;
     }
 
-    const report_map_t *const report_map = &g_interface_report_maps[interface_num];
-    data_ptr = data;
-    size_t report_length = length;
-    uint8_t report_id = 0;
-
-    if (report_map->num_reports > 1) {
-        report_id = data[0];
-        data_ptr++;
-        report_length--;
-    } else if (report_map->num_reports == 1) {
-        report_id = report_map->report_ids[0];
-    }
-
-    report_info_t *const report_info = report_lookup_table[interface_num][report_id];
-    if (!report_info) {
-        ESP_LOGW(TAG, "Unknown report ID %d for interface %d", report_id, interface_num);
+    usb_hid_iface_t *const iface = g_ifaces[slot];
+    if (!iface) {
+        // Queued before the interface went away
         return;
     }
 
-    if (g_num_fields != report_info->num_fields) {
-        free(g_fields);
-        free(g_field_values);
-        g_fields = NULL;
-        g_field_values = NULL;
-    }
-
-    if (!g_fields || !g_field_values) {
-        g_fields = calloc(report_info->num_fields, sizeof(usb_hid_field_t));
-        g_field_values = calloc(report_info->num_fields, sizeof(int64_t));
-        if (!g_fields || !g_field_values) {
-            ESP_LOGE(TAG, "Failed to allocate field buffers");
+    switch (decode_report(&iface->report_map, data, length, &g_report)) {
+        case ESP_OK:
+            break;
+        case ESP_ERR_NOT_FOUND:
+            ESP_LOGW(TAG, "Unknown report ID %d for device %d interface %d", g_report.report_id, iface->dev_addr,
+                     iface->iface_num);
+            return;
+        default:
+            if (VERBOSE) {
+                ESP_LOGW(TAG, "Dropping short report ID %d: %d bytes, descriptor declares %d bits", g_report.report_id,
+                         g_report.length, g_report.info->total_bits);
+            }
             return;
-        }
     }
 
-    g_report.if_id = interface_num;
-    g_report.report_id = report_id;
-    g_report.type = USB_HID_FIELD_TYPE_INPUT;
-    g_report.fields = g_fields;
-    g_report.info = report_info;
-
-    const report_field_info_t *const field_info = report_info->fields;
-    for (uint8_t i = 0; i < report_info->num_fields; i++) {
-        g_field_values[i] = extract_field_value(data_ptr, field_info[i].bit_offset, field_info[i].bit_size);
-        g_fields[i].attr = field_info[i].attr;
-        g_fields[i].value = &g_field_values[i];
-    }
+    g_report.if_id = slot;
+    g_report.timestamp_us = timestamp_us;
 
     g_report_callback(&g_report);
 }
 
-static uint8_t cur_if_evt_data[64] = {0};
+static void report_forward_task(void *arg) {
+    const ring_report_t *report;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Decode and send everything queued, slow BLE sends only delay this task, never USB servicing.
+        // The mutex keeps the interface alive for one report, the device task gets in between reports.
+        while ((report = report_ring_peek()) != NULL) {
+            if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
+                process_report(report->data, report->length, report->if_id, report->timestamp_us);
+                xSemaphoreGive(g_report_maps_mutex);
+            }
+            report_ring_release();
+        }
+    }
+}
 
+// The driver resubmits its transfer buffer as soon as this returns, so the report is copied
+// once, straight into the ring slot the forwarding task decodes from
 static IRAM_ATTR void hid_host_interface_callback(
     const hid_host_device_handle_t hid_device_handle,
     const hid_host_interface_event_t event, void *arg) {
-    static size_t data_length = 0;
-    static hid_host_dev_params_t dev_params;
+    usb_hid_iface_t *const iface = arg;
+    size_t data_length = 0;
+    ring_report_t *slot;
     esp_err_t err;
 
-    err = hid_host_device_get_params(hid_device_handle, &dev_params);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get device params: %s", esp_err_to_name(err));
+    if (!iface) {
         return;
     }
 
     switch (event) {
         case HID_HOST_INTERFACE_EVENT_INPUT_REPORT:
-            err = hid_host_device_get_raw_input_report_data(hid_device_handle, cur_if_evt_data, sizeof(cur_if_evt_data),
+            slot = report_ring_acquire();
+            if (!slot) {
+                // Forwarding task is behind, drop the newest report, counted as an overrun
+                return;
+            }
+
+            err = hid_host_device_get_raw_input_report_data(hid_device_handle, slot->data, sizeof(slot->data),
                                                             &data_length);
             if (err != ESP_OK || data_length == 0) {
                 ESP_LOGW(TAG, "Failed to get raw input report: %s", esp_err_to_name(err));
                 return;
             }
-            process_report(cur_if_evt_data, data_length, dev_params.iface_num);
+
+            slot->timestamp_us = esp_timer_get_time();
+            slot->if_id = iface->slot;
+            slot->length = data_length;
+            report_ring_commit();
+            xTaskNotifyGive(g_forward_task_handle);
             break;
 
-        case HID_HOST_INTERFACE_EVENT_DISCONNECTED:
+        case HID_HOST_INTERFACE_EVENT_DISCONNECTED: {
             if (VERBOSE) {
-                ESP_LOGI(TAG, "HID Device Disconnected - Interface: %d", dev_params.iface_num);
+                ESP_LOGI(TAG, "HID Device Disconnected - Device: %d, Interface: %d", iface->dev_addr, iface->iface_num);
+            }
+
+            // Freed by the device task, the forwarding task may still be decoding a report of it.
+            // iface isn't touched once the handle is taken, the device task may free it right away.
+            const usb_device_type_event_t evt = {
+                .device_handle = NULL,
+                .released_slot = iface->slot,
+                .generation = iface->generation,
+            };
+            iface->connected = false;
+            const hid_host_device_handle_t handle = iface_take_handle(iface);
+            if (!handle) {
+                // Replaced by a re-enumeration, the device task closed it and released the slot
+                break;
             }
 
-            hid_host_device_close(hid_device_handle);
+            hid_host_device_close(handle);
+            if (xQueueSend(g_device_event_queue, &evt, pdMS_TO_TICKS(100)) != pdTRUE) {
+                ESP_LOGW(TAG, "Failed to queue release of interface slot %d", evt.released_slot);
+            }
             break;
+        }
 
         case HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR:
             ESP_LOGW(TAG, "HID Device Transfer Error");
@@ -510,6 +572,17 @@ static void device_event_task(void *arg) {
 
     while (1) {
         if (xQueueReceive(g_device_event_queue, &evt, portMAX_DELAY) == pdTRUE) {
+            if (evt.released_slot != IFACE_SLOT_NONE) {
+                if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
+                    const usb_hid_iface_t *released = g_ifaces[evt.released_slot];
+                    if (released && released->generation == evt.generation) {
+                        iface_release(evt.released_slot);
+                    }
+                    xSemaphoreGive(g_report_maps_mutex);
+                }
+                continue;
+            }
+
             hid_host_dev_params_t dev_params;
             err = hid_host_device_get_params(evt.device_handle, &dev_params);
             if (err != ESP_OK) {
@@ -524,17 +597,54 @@ static void device_event_task(void *arg) {
                     try++;
                 }
 
+                if (dev_params.iface_num >= USB_HOST_MAX_INTERFACES) {
+                    ESP_LOGW(TAG, "Ignoring interface %d", dev_params.iface_num);
+                    continue;
+                }
+
+                // Re-enumerated without a disconnect event. The old handle is closed before its interface
+                // is freed so its callback can't fire on freed memory, a release it already queued
+                // carries the old generation and is ignored.
+                usb_hid_iface_t *stale = NULL;
+                hid_host_device_handle_t stale_handle = NULL;
+                if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
+                    stale = iface_find(dev_params.addr, dev_params.iface_num);
+                    stale_handle = stale ? iface_take_handle(stale) : NULL;
+                    xSemaphoreGive(g_report_maps_mutex);
+                }
+                if (stale_handle) {
+                    hid_host_device_close(stale_handle);
+                }
+
+                usb_hid_iface_t *iface = NULL;
+                if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
+                    if (stale) {
+                        iface_release(stale->slot);
+                    }
+                    iface = iface_create(dev_params.addr, dev_params.iface_num);
+                    xSemaphoreGive(g_report_maps_mutex);
+                }
+
+                if (!iface) {
+                    ESP_LOGE(TAG, "No room for device %d interface %d", dev_params.addr, dev_params.iface_num);
+                    continue;
+                }
+
                 const hid_host_device_config_t dev_config = {
                     .callback = hid_host_interface_callback,
-                    .callback_arg = NULL
+                    .callback_arg = iface
                 };
 
                 err = hid_host_device_open(evt.device_handle, &dev_config);
                 if (err != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to open device: %s", esp_err_to_name(err));
+                    if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
+                        iface_release(iface->slot);
+                        xSemaphoreGive(g_report_maps_mutex);
+                    }
                     continue;
                 }
-                g_hid_device_handles[dev_params.iface_num] = evt.device_handle;
+                __atomic_store_n(&iface->handle, evt.device_handle, __ATOMIC_RELEASE);
 
                 err = hid_class_request_set_protocol(evt.device_handle, HID_REPORT_PROTOCOL_REPORT);
                 if (err != ESP_OK) {
@@ -557,24 +667,50 @@ static void device_event_task(void *arg) {
                         ESP_LOGI(TAG, "Got report descriptor, length = %d", desc_len);
                     }
 
-                    if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
-                        parse_report_descriptor(desc, desc_len, dev_params.iface_num,
-                                                &g_interface_report_maps[dev_params.iface_num]);
-                        report_map_t *report_map = &g_interface_report_maps[dev_params.iface_num];
-                        for (int i = 0; i < report_map->num_reports; i++) {
-                            if (VERBOSE) {
-                                ESP_LOGI(TAG, "Expecting %d fields for interface=%d report=%d",
-                                         report_map->reports[i].num_fields, dev_params.iface_num,
-                                         report_map->report_ids[i]);
-                            }
-                            g_field_counts[dev_params.iface_num][report_map->report_ids[i]] = report_map->reports[i].
-                                    num_fields;
-                            report_lookup_table[dev_params.iface_num][report_map->report_ids[i]] = &report_map->reports[
-                                i];
+                    hid_host_dev_info_t dev_info = {0};
+                    const bool has_info = hid_host_get_device_info(evt.device_handle, &dev_info) == ESP_OK;
+
+                    // Parsed outside the mutex so other devices keep forwarding, only the swap is locked
+                    report_map_t report_map = {0};
+                    bool store = false;
+                    if (!has_info || !descriptor_cache_load(dev_info.VID, dev_info.PID, desc, desc_len,
+                                                            dev_params.iface_num, &report_map)) {
+                        if (parse_report_descriptor(desc, desc_len, dev_params.iface_num, &report_map) != ESP_OK) {
+                            ESP_LOGE(TAG, "Failed to allocate report map for device %d interface %d",
+                                     dev_params.addr, dev_params.iface_num);
+                        } else {
+                            store = has_info;
+                        }
+                    }
+
+                    if (VERBOSE) {
+                        ESP_LOGI(TAG, "Device %d interface %d: report map takes %d bytes, %d saved",
+                                 dev_params.addr, dev_params.iface_num, report_map.arena_size,
+                                 (int)report_map_fixed_size() - (int)report_map.arena_size);
+
+                        for (int i = 0; i < report_map.num_reports; i++) {
+                            ESP_LOGI(TAG, "Expecting %d fields for device=%d interface=%d report=%d",
+                                     report_map.reports[i].num_fields, dev_params.addr, dev_params.iface_num,
+                                     report_map.report_ids[i]);
                         }
+                    }
+
+                    report_map_t previous = {0};
+                    if (xSemaphoreTake(g_report_maps_mutex, portMAX_DELAY) == pdTRUE) {
+                        previous = iface->report_map;
+                        iface->report_map = report_map;
                         xSemaphoreGive(g_report_maps_mutex);
                     } else {
                         ESP_LOGE(TAG, "Failed to take report maps mutex");
+                        previous = report_map;
+                        store = false;
+                    }
+                    report_map_free(&previous);
+
+                    // A flash write, kept out of the mutex. Only this task frees interfaces, the map stays put.
+                    if (store) {
+                        descriptor_cache_store(dev_info.VID, dev_info.PID, desc, desc_len, dev_params.iface_num,
+                                               &iface->report_map);
                     }
                 }
 
@@ -583,7 +719,7 @@ static void device_event_task(void *arg) {
                     ESP_LOGE(TAG, "Failed to start device: %s", esp_err_to_name(err));
                     continue;
                 }
-                g_device_connected[dev_params.iface_num] = true;
+                iface->connected = true;
             } else {
                 if (VERBOSE) {
                     ESP_LOGI(TAG, "Unknown device event, subclass = %d, proto = %s, iface = %d",
@@ -598,7 +734,9 @@ static void hid_host_device_callback(const hid_host_device_handle_t hid_device_h
                                      const hid_host_driver_event_t event, void *arg) {
     const usb_device_type_event_t evt = {
         .device_handle = hid_device_handle,
-        .event = event
+        .event = event,
+        .released_slot = IFACE_SLOT_NONE,
+        .generation = 0,
     };
 
     xQueueSend(g_device_event_queue, &evt, 0);
@@ -647,12 +785,21 @@ static void usb_stats_task(void *arg) {
     TickType_t last_wake_time = xTaskGetTickCount();
 
     uint16_t s_prev_rps = 0;
+    uint32_t prev_overruns = 0;
+    report_ring_stats_t ring_stats;
     while (1) {
         const uint16_t reports_per_sec = (s_current_rps - s_prev_rps) / USB_STATS_INTERVAL_SEC;
         if (reports_per_sec > 0 && VERBOSE) {
             ESP_LOGI(TAG, "USB: %lu rps", reports_per_sec);
         }
 
+        report_ring_get_stats(&ring_stats);
+        if (ring_stats.overruns != prev_overruns) {
+            ESP_LOGW(TAG, "Report ring: %lu overruns, high water %d/%d", ring_stats.overruns - prev_overruns,
+                     ring_stats.high_water, REPORT_RING_SLOTS);
+            prev_overruns = ring_stats.overruns;
+        }
+
         s_prev_rps = s_current_rps;
         vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(USB_STATS_INTERVAL_SEC * 1000));
     }
@@ -63,7 +63,7 @@ bool usb_hid_host_device_connected(void);
  * @param interface_num Interface number
  * @return Number of fields, or 0 if report ID not found
  */
-uint8_t usb_hid_host_get_num_fields(uint8_t report_id, uint8_t interface_num);
+uint16_t usb_hid_host_get_num_fields(uint8_t report_id, uint8_t interface_num);
 
 #ifdef __cplusplus
 }
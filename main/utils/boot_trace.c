@@ -0,0 +1,87 @@
+#include "boot_trace.h"
+#include <stdbool.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+
+#define BOOT_TRACE_MAGIC 0x42545231 // "BTR1", bump when boot_timeline_t changes
+
+typedef struct {
+    uint32_t magic;
+    uint32_t head;
+    uint32_t count;
+    boot_timeline_t timelines[BOOT_TRACE_HISTORY];
+} boot_trace_t;
+
+// Not initialized on startup, validated by the magic instead
+static RTC_NOINIT_ATTR boot_trace_t s_trace;
+
+// Marks already taken during this boot, checked before touching RTC memory
+static uint32_t s_marked = 0;
+static boot_timeline_t *s_current = NULL;
+
+static const char *s_phase_names[BOOT_PHASE_MAX] = {
+    [BOOT_PHASE_APP_MAIN] = "app_main",
+    [BOOT_PHASE_NVS] = "nvs",
+    [BOOT_PHASE_SETTINGS] = "settings",
+    [BOOT_PHASE_PERIPHERALS] = "peripherals",
+    [BOOT_PHASE_INPUTS] = "inputs",
+    [BOOT_PHASE_DESCRIPTOR_CACHE] = "descriptor_cache",
+    [BOOT_PHASE_USB_HOST] = "usb_host",
+    [BOOT_PHASE_BLE_STACK] = "ble_stack",
+    [BOOT_PHASE_HID_BRIDGE] = "hid_bridge",
+    [BOOT_PHASE_BLE_CONNECTED] = "ble_connected",
+    [BOOT_PHASE_FIRST_USB_REPORT] = "first_usb_report",
+    [BOOT_PHASE_FIRST_BLE_NOTIFY] = "first_ble_notify",
+};
+
+void boot_trace_start(void) {
+    if (s_trace.magic != BOOT_TRACE_MAGIC || s_trace.head >= BOOT_TRACE_HISTORY || s_trace.count > BOOT_TRACE_HISTORY) {
+        memset(&s_trace, 0, sizeof(s_trace));
+        s_trace.magic = BOOT_TRACE_MAGIC;
+    } else {
+        s_trace.head = (s_trace.head + 1) % BOOT_TRACE_HISTORY;
+    }
+
+    if (s_trace.count < BOOT_TRACE_HISTORY) {
+        s_trace.count++;
+    }
+
+    s_current = &s_trace.timelines[s_trace.head];
+    memset(s_current, 0, sizeof(boot_timeline_t));
+    s_current->wakeup_cause = esp_sleep_get_wakeup_cause();
+    s_marked = 0;
+    boot_trace_mark(BOOT_PHASE_APP_MAIN);
+}
+
+IRAM_ATTR void boot_trace_mark(const boot_phase_t phase) {
+    const uint32_t bit = 1UL << phase;
+    if (!s_current || phase >= BOOT_PHASE_MAX || (__atomic_load_n(&s_marked, __ATOMIC_RELAXED) & bit)) {
+        return;
+    }
+
+    if (__atomic_fetch_or(&s_marked, bit, __ATOMIC_RELAXED) & bit) {
+        return;
+    }
+
+    const int64_t now = esp_timer_get_time();
+    s_current->marks_us[phase] = now > 0 ? (uint32_t)now : 1;
+}
+
+size_t boot_trace_get(boot_timeline_t *out, const size_t max_timelines) {
+    if (s_trace.magic != BOOT_TRACE_MAGIC) {
+        return 0;
+    }
+
+    size_t n = 0;
+    for (; n < s_trace.count && n < max_timelines; n++) {
+        const uint32_t idx = (s_trace.head + BOOT_TRACE_HISTORY - n) % BOOT_TRACE_HISTORY;
+        memcpy(&out[n], &s_trace.timelines[idx], sizeof(boot_timeline_t));
+    }
+    return n;
+}
+
+const char* boot_trace_phase_name(const boot_phase_t phase) {
+    return phase < BOOT_PHASE_MAX ? s_phase_names[phase] : "unknown";
+}
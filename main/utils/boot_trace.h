@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of boot timelines kept in RTC memory, newest overwrites oldest
+#define BOOT_TRACE_HISTORY 4
+
+typedef enum {
+    BOOT_PHASE_APP_MAIN = 0,
+    BOOT_PHASE_NVS,
+    BOOT_PHASE_SETTINGS,
+    BOOT_PHASE_PERIPHERALS,
+    BOOT_PHASE_INPUTS,
+    BOOT_PHASE_DESCRIPTOR_CACHE,
+    BOOT_PHASE_USB_HOST,
+    BOOT_PHASE_BLE_STACK,
+    BOOT_PHASE_HID_BRIDGE,
+    BOOT_PHASE_BLE_CONNECTED,
+    BOOT_PHASE_FIRST_USB_REPORT,
+    BOOT_PHASE_FIRST_BLE_NOTIFY,
+    BOOT_PHASE_MAX
+} boot_phase_t;
+
+typedef struct {
+    uint32_t wakeup_cause;
+    // esp_timer_get_time() when the phase completed, 0 if it was not reached
+    uint32_t marks_us[BOOT_PHASE_MAX];
+} boot_timeline_t;
+
+/**
+ * @brief Start a new boot timeline, call first thing in app_main()
+ *
+ * Timelines live in RTC memory and survive deep sleep and software resets.
+ */
+void boot_trace_start(void);
+
+/**
+ * @brief Record completion of a boot phase
+ *
+ * Only the first mark per phase and boot is kept, so it is cheap to call from hot paths.
+ *
+ * @param phase Boot phase
+ */
+void boot_trace_mark(boot_phase_t phase);
+
+/**
+ * @brief Get the recorded boot timelines
+ *
+ * @param out Output array
+ * @param max_timelines Size of the output array
+ * @return size_t Number of timelines written, newest first
+ */
+size_t boot_trace_get(boot_timeline_t *out, size_t max_timelines);
+
+/**
+ * @brief Get the name of a boot phase
+ *
+ * @param phase Boot phase
+ * @return const char* Short name, used as JSON key
+ */
+const char* boot_trace_phase_name(boot_phase_t phase);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,8 +12,13 @@ static int s_long_press_threshold = 1500;
 
 static void buttons_task(void* arg);
 
+static void on_settings_changed(const settings_t *settings, const settings_t *previous) {
+    s_long_press_threshold = settings->buttons.long_press_ms;
+}
+
 void buttons_init() {
-    storage_get_int_setting("buttons.longPressMs", &s_long_press_threshold);
+    s_long_press_threshold = storage_settings()->buttons.long_press_ms;
+    storage_subscribe(on_settings_changed);
     xTaskCreatePinnedToCore(buttons_task, "buttons_task", VERBOSE ? 2600 : 2350, NULL, 8, NULL, 1);
 }
 
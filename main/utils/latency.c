@@ -0,0 +1,69 @@
+#include "latency.h"
+#include <stdbool.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+static uint32_t s_buckets[LATENCY_BUCKETS];
+static uint32_t s_max_us = 0;
+
+// Clamped to the observed max so a single slow report doesn't read as 2x slower
+static uint32_t bucket_upper_bound(const int bucket, const uint32_t max_us) {
+    const uint32_t bound = bucket == 0 ? 0 : (1UL << bucket) - 1;
+    return bound < max_us ? bound : max_us;
+}
+
+IRAM_ATTR void latency_record(const int64_t capture_us) {
+    if (capture_us <= 0) {
+        return;
+    }
+
+    const int64_t elapsed = esp_timer_get_time() - capture_us;
+    const uint32_t us = elapsed < 0 ? 0 : elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= LATENCY_BUCKETS) {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&s_buckets[bucket], 1, __ATOMIC_RELAXED);
+
+    uint32_t max = __atomic_load_n(&s_max_us, __ATOMIC_RELAXED);
+    while (us > max && !__atomic_compare_exchange_n(&s_max_us, &max, us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void latency_get_stats(latency_stats_t *stats) {
+    memset(stats, 0, sizeof(latency_stats_t));
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        stats->buckets[i] = __atomic_load_n(&s_buckets[i], __ATOMIC_RELAXED);
+        stats->count += stats->buckets[i];
+    }
+    stats->max_us = __atomic_load_n(&s_max_us, __ATOMIC_RELAXED);
+
+    if (stats->count == 0) {
+        return;
+    }
+
+    const uint32_t p50_rank = (stats->count + 1) / 2;
+    const uint32_t p99_rank = stats->count - stats->count / 100;
+    uint32_t seen = 0;
+    bool p50_found = false;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (!p50_found && seen >= p50_rank) {
+            stats->p50_us = bucket_upper_bound(i, stats->max_us);
+            p50_found = true;
+        }
+        if (seen >= p99_rank) {
+            stats->p99_us = bucket_upper_bound(i, stats->max_us);
+            break;
+        }
+    }
+}
+
+void latency_reset(void) {
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        __atomic_store_n(&s_buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&s_max_us, 0, __ATOMIC_RELAXED);
+}
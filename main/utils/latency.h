@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bucket 0 holds 0 us, bucket n holds [2^(n-1), 2^n) us, the last bucket holds everything above
+#define LATENCY_BUCKETS 20
+
+typedef struct {
+    uint32_t count;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_stats_t;
+
+/**
+ * @brief Record USB capture to BLE send latency of one report
+ *
+ * Allocation- and lock-free, safe to call from any task.
+ *
+ * @param capture_us esp_timer_get_time() at USB capture, ignored if 0
+ */
+void latency_record(int64_t capture_us);
+
+/**
+ * @brief Get a snapshot of the latency histogram
+ *
+ * Percentiles are reported as the upper bound of the bucket they fall into.
+ *
+ * @param stats Output structure
+ */
+void latency_get_stats(latency_stats_t *stats);
+
+/**
+ * @brief Clear the latency histogram
+ */
+void latency_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,99 @@
+#include "pointer_transform.h"
+#include <stdbool.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include "const.h"
+
+#define FRAC_BITS 16
+#define FRAC_ONE (1 << FRAC_BITS)
+#define LUT_SIZE 128           // covers all 8-bit mice and regular movement of 16-bit ones
+#define POINTER_ACCEL_KNEE 32  // counts per report where acceleration reaches full gain
+
+static const char *TAG = "POINTER";
+
+typedef struct {
+    int32_t lut[LUT_SIZE]; // scaled |delta| in Q16.16 for deltas below LUT_SIZE, gain above it is flat
+    int64_t tail_gain_q16;
+    bool identity;
+} transform_table_t;
+
+// Built into the table that isn't published, then swapped in, the report path never sees a half-written one
+static transform_table_t s_tables[2] = {
+    {.tail_gain_q16 = FRAC_ONE, .identity = true},
+    {.tail_gain_q16 = FRAC_ONE, .identity = true},
+};
+static transform_table_t *s_table = &s_tables[0];
+static bool s_reset_requested = false;
+
+// Only touched by pointer_transform_apply()
+static int32_t s_carry_x = 0;
+static int32_t s_carry_y = 0;
+
+static int64_t gain_q16(const uint32_t counts, const uint16_t sensitivity_pct, const uint16_t acceleration_pct) {
+    const uint32_t ramp = counts < POINTER_ACCEL_KNEE ? counts : POINTER_ACCEL_KNEE;
+    const int64_t num = (int64_t)sensitivity_pct * (100 * POINTER_ACCEL_KNEE + acceleration_pct * ramp) * FRAC_ONE;
+    return num / (100 * 100 * POINTER_ACCEL_KNEE);
+}
+
+void pointer_transform_init(const uint16_t sensitivity_pct, const uint16_t acceleration_pct) {
+    const transform_table_t *current = __atomic_load_n(&s_table, __ATOMIC_ACQUIRE);
+    transform_table_t *next = current == &s_tables[0] ? &s_tables[1] : &s_tables[0];
+
+    for (uint32_t i = 0; i < LUT_SIZE; i++) {
+        const int64_t scaled = i * gain_q16(i, sensitivity_pct, acceleration_pct);
+        next->lut[i] = scaled > INT32_MAX ? INT32_MAX : (int32_t)scaled;
+    }
+
+    next->tail_gain_q16 = gain_q16(LUT_SIZE, sensitivity_pct, acceleration_pct);
+    next->identity = sensitivity_pct == 100 && acceleration_pct == 0;
+    __atomic_store_n(&s_table, next, __ATOMIC_RELEASE);
+    pointer_transform_reset();
+
+    if (VERBOSE) {
+        ESP_LOGI(TAG, "Sensitivity %u%%, acceleration %u%%", sensitivity_pct, acceleration_pct);
+    }
+}
+
+// The carries belong to the report path, it clears them on its next report
+void pointer_transform_reset(void) {
+    __atomic_store_n(&s_reset_requested, true, __ATOMIC_RELEASE);
+}
+
+static IRAM_ATTR int32_t transform_axis(const transform_table_t *table, const int32_t delta, int32_t *carry) {
+    const uint32_t magnitude = delta < 0 ? -(int64_t)delta : delta;
+    int64_t scaled;
+    if (magnitude < LUT_SIZE) {
+        scaled = table->lut[magnitude];
+    } else if (__builtin_mul_overflow((int64_t)magnitude, table->tail_gain_q16, &scaled) ||
+               scaled > INT64_MAX - FRAC_ONE) {
+        // Far beyond what saturates the output anyway, leaves room for the carry
+        scaled = INT64_MAX - FRAC_ONE;
+    }
+    const int64_t total = *carry + (delta < 0 ? -scaled : scaled);
+
+    // Truncate towards zero so both directions behave the same, the remainder keeps the sign of the motion
+    int64_t whole = (total < 0 ? -(-total >> FRAC_BITS) : total >> FRAC_BITS);
+    if (whole > INT32_MAX) whole = INT32_MAX;
+    if (whole < INT32_MIN) whole = INT32_MIN;
+    *carry = (int32_t)(total - whole * FRAC_ONE);
+    if (*carry >= FRAC_ONE || *carry <= -FRAC_ONE) {
+        // Only reachable when saturated, there is no point in carrying that much
+        *carry = 0;
+    }
+    return (int32_t)whole;
+}
+
+void IRAM_ATTR pointer_transform_apply(int32_t *x, int32_t *y) {
+    if (__atomic_exchange_n(&s_reset_requested, false, __ATOMIC_ACQ_REL)) {
+        s_carry_x = 0;
+        s_carry_y = 0;
+    }
+
+    const transform_table_t *table = __atomic_load_n(&s_table, __ATOMIC_ACQUIRE);
+    if (table->identity) {
+        return;
+    }
+
+    *x = transform_axis(table, *x, &s_carry_x);
+    *y = transform_axis(table, *y, &s_carry_y);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Precompute the pointer transform lookup table
+ *
+ * Gain ramps linearly from sensitivity to sensitivity * (1 + acceleration / 100)
+ * between 0 and POINTER_ACCEL_KNEE counts per report, and stays flat above it.
+ * Also clears the sub-count carry. Safe to call while reports are being transformed:
+ * the table is built aside and published atomically. Calls must not overlap each other.
+ *
+ * @param sensitivity_pct Base gain in percent, 100 means 1:1
+ * @param acceleration_pct Extra gain at and above the knee in percent, 0 disables acceleration
+ */
+void pointer_transform_init(uint16_t sensitivity_pct, uint16_t acceleration_pct);
+
+/**
+ * @brief Scale one report worth of motion in place
+ *
+ * Fractions that don't make a whole count are carried over per axis, so the total motion is preserved.
+ * Call from the report processing path only, the carry isn't shared.
+ *
+ * @param x Horizontal delta
+ * @param y Vertical delta
+ */
+void pointer_transform_apply(int32_t *x, int32_t *y);
+
+/**
+ * @brief Drop the sub-count carry, e.g. when the pointing device changes
+ *
+ * Takes effect on the next pointer_transform_apply(), may be called from any task.
+ */
+void pointer_transform_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -274,22 +274,32 @@ uint32_t rgb_color(const uint8_t r, const uint8_t g, const uint8_t b)
     return color_with_brightness(NP_RGB(r, g, b), g_rgb_brightness);
 }
 
-void led_control_init(const int num_leds, const int gpio_pin)
+static void apply_brightness(const settings_t *settings)
 {
-    int brightness;
-    if (storage_get_int_setting("led.brightness", &brightness) == ESP_OK) {
-        if (brightness >= 0 && brightness <= 100) {
-            g_rgb_brightness = brightness;
+    const int brightness = settings->led.brightness;
+    if (brightness >= 0 && brightness <= 100) {
+        g_rgb_brightness = brightness;
 
-            if (VERBOSE) {
-                ESP_LOGI(TAG, "LED brightness set to %d%%", brightness);
-            }
-        } else {
-            ESP_LOGW(TAG, "Invalid brightness value %d, using default", brightness);
+        if (VERBOSE) {
+            ESP_LOGI(TAG, "LED brightness set to %d%%", brightness);
         }
     } else {
-        ESP_LOGW(TAG, "Failed to get brightness from settings, using default");
+        ESP_LOGW(TAG, "Invalid brightness value %d, keeping %d%%", brightness, g_rgb_brightness);
     }
+}
+
+// Picked up by the LED task on its next frame
+static void on_settings_changed(const settings_t *settings, const settings_t *previous)
+{
+    if (settings->led.brightness != previous->led.brightness) {
+        apply_brightness(settings);
+    }
+}
+
+void led_control_init(const int num_leds, const int gpio_pin)
+{
+    apply_brightness(storage_settings());
+    storage_subscribe(on_settings_changed);
     
     if (s_previous_state != NULL) {
         free(s_previous_state);
@@ -36,6 +36,14 @@ static void IRAM_ATTR click_isr_handler(void* arg) {
     xQueueSendFromISR(button_state_queue, &state, NULL);
 }
 
+static void apply_long_press_threshold(const settings_t *settings) {
+    s_long_press_threshold = settings->buttons.long_press_ms < 750 ? 750 : settings->buttons.long_press_ms;
+}
+
+static void on_settings_changed(const settings_t *settings, const settings_t *previous) {
+    apply_long_press_threshold(settings);
+}
+
 void rotary_enc_init() {
     enc_queue = xQueueCreate(2, sizeof(int8_t));
     button_state_queue = xQueueCreate(2, sizeof(uint8_t));
@@ -84,10 +92,8 @@ void rotary_enc_init() {
     ESP_ERROR_CHECK(pcnt_unit_clear_count(pcnt_unit));
     ESP_ERROR_CHECK(pcnt_unit_start(pcnt_unit));
 
-    storage_get_int_setting("buttons.longPressMs", &s_long_press_threshold);
-    if (s_long_press_threshold < 750) {
-        s_long_press_threshold = 750;
-    }
+    apply_long_press_threshold(storage_settings());
+    storage_subscribe(on_settings_changed);
 
     gpio_isr_handler_add(GPIO_ROT_E, click_isr_handler, NULL);
     xTaskCreatePinnedToCore(rotary_enc_task, "rotary_task", VERBOSE ? 2300 : 1950, NULL, 8, NULL, 1);
@@ -10,131 +10,80 @@
 #include "esp_flash_partitions.h"
 #include "esp_ota_ops.h"
 #include "ota_server.h"
+#include "freertos/FreeRTOS.h"
 
-#define MAX_CACHE_SIZE 16
-#define MAX_PATH_LENGTH 32
+#define MAX_SETTINGS_LISTENERS 8
 
-typedef enum {
-    CACHE_TYPE_STRING,
-    CACHE_TYPE_INT,
-    CACHE_TYPE_BOOL,
-    CACHE_TYPE_FLOAT
-} cache_value_type_t;
-
-typedef struct {
-    char path[MAX_PATH_LENGTH];
-    cache_value_type_t type;
-    union {
-        char str[48];
-        int num;
-        bool flag;
-        float fnum;
-    } value;
-} cache_entry_t;
+// Bump whenever the settings_t layout changes and convert the previous version in read_record()
+#define SETTINGS_SCHEMA_VERSION 1
 
 static const char *STORAGE_TAG = "STORAGE";
-static cache_entry_t cache[MAX_CACHE_SIZE];
-static int cache_count = 0;
-
-static void cache_clear(void) {
-    cache_count = 0;
-}
-
-static IRAM_ATTR cache_entry_t* cache_find(const char* path) {
-    for(int i = 0; i < cache_count; i++) {
-        if(strcmp(cache[i].path, path) == 0) {
-            return &cache[i];
-        }
-    }
-    return NULL;
-}
 
-static cache_entry_t* cache_add(const char* path) {
-    if(cache_count >= MAX_CACHE_SIZE) {
-        cache_count = 0;
-    }
-    strncpy(cache[cache_count].path, path, MAX_PATH_LENGTH - 1);
-    cache[cache_count].path[MAX_PATH_LENGTH - 1] = '\0';
-    return &cache[cache_count++];
-}
-
-static const char *default_settings = "{"
-    "\"deviceInfo\":{"
-        "\"name\":\"" DEVICE_NAME "\","
-        "\"fwVersion\":\"" FIRMWARE_VERSION "\","
-        "\"hwVersion\":\"" HARDWARE_VERSION "\","
-        "\"macAddress\":\"00:00:00:00:00:00\","
-        "\"newFirmware\":false"
-    "},"
-    "\"power\":{"
-        "\"enableSleep\":true,"
-        "\"warpSpeed\":\"slow\","
-        "\"twoSleeps\":true,"
-        "\"sleepTimeout\":180,"
-        "\"deepSleep\":true,"
-        "\"disableSlowPhase\":false,"
-        "\"disableWarn\":false,"
-        "\"fastCharge\":true,"
-        "\"deepSleepTimeout\":450"
-    "},"
-    "\"led\":{"
-        "\"brightness\":35"
-    "},"
-    "\"mouse\":{"
-        "\"sensitivity\":100"
-    "},"
-    "\"connectivity\":{"
-        "\"bleTxPower\":\"p3\","
-        "\"bleRecDelay\":3"
-    "},"
-    "\"buttons\":{"
-        "\"longPressMs\":750,"
-        "\"keys\":["
-            "{"
-                "\"acType\":\"keyboard_key\","
-                "\"action\":\"KC_HOME\""
-            "},"
-            "{"
-                "\"acType\":\"keyboard_key\","
-                "\"action\":\"KC_PAGE_UP\""
-            "},"
-            "{"
-                "\"acType\":\"keyboard_key\","
-                "\"action\":\"KC_PAGE_DOWN\""
-            "},"
-            "{"
-                "\"acType\":\"keyboard_key\","
-                "\"action\":\"KC_END\""
-            "}"
-        "],"
-        "\"longPress\":["
-            "{"
-                "\"acType\":\"keyboard_key\","
-                "\"action\":\"KC_ESCAPE\""
-            "},"
-            "{"
-                "\"acType\":\"mouse_button\","
-                "\"action\":\"KC_MS_BTN4\""
-            "},"
-            "{"
-                "\"acType\":\"mouse_button\","
-                "\"action\":\"KC_MS_BTN5\""
-            "},"
-            "{"
-                "\"acType\":\"keyboard_key\","
-                "\"action\":\"KC_ENTER\""
-            "}"
-        "],"
-        "\"encoder\":{"
-            "\"mode\":\"volume_control\","
-            "\"click\":\"KC_AUDIO_MUTE\","
-            "\"left\":\"KC_AUDIO_VOL_DOWN\","
-            "\"right\":\"KC_AUDIO_VOL_UP\""
-        "}"
-    "}"
-"}";
-
-static char *current_settings = NULL;
+typedef struct {
+    uint16_t version;
+    uint16_t size;
+    settings_t settings;
+} settings_record_t;
+
+// Two snapshots so that readers of the current one are not disturbed by the next update
+static settings_t s_snapshots[2];
+static const settings_t *volatile s_settings = NULL;
+
+// Last JSON handed out by storage_get_settings()
+static char *s_settings_json = NULL;
+
+static settings_listener_t s_listeners[MAX_SETTINGS_LISTENERS];
+static uint8_t s_num_listeners = 0;
+static portMUX_TYPE s_listeners_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const settings_t s_default_settings = {
+    .device_info = {
+        .name = DEVICE_NAME,
+    },
+    .power = {
+        .enable_sleep = true,
+        .warp_speed = "slow",
+        .two_sleeps = true,
+        .sleep_timeout = 180,
+        .deep_sleep = true,
+        .disable_slow_phase = false,
+        .disable_warn = false,
+        .fast_charge = true,
+        .deep_sleep_timeout = 450,
+    },
+    .led = {
+        .brightness = 35,
+    },
+    .mouse = {
+        .sensitivity = 100,
+        .acceleration = 0,
+    },
+    .connectivity = {
+        .ble_tx_power = "p3",
+        .ble_rec_delay = 3,
+    },
+    .buttons = {
+        .long_press_ms = 750,
+        .keys = {
+            { .ac_type = "keyboard_key", .action = "KC_HOME" },
+            { .ac_type = "keyboard_key", .action = "KC_PAGE_UP" },
+            { .ac_type = "keyboard_key", .action = "KC_PAGE_DOWN" },
+            { .ac_type = "keyboard_key", .action = "KC_END" },
+        },
+        .long_press = {
+            { .ac_type = "keyboard_key", .action = "KC_ESCAPE" },
+            { .ac_type = "mouse_button", .action = "KC_MS_BTN4" },
+            { .ac_type = "mouse_button", .action = "KC_MS_BTN5" },
+            { .ac_type = "keyboard_key", .action = "KC_ENTER" },
+        },
+        .encoder = {
+            .mode = "volume_control",
+            .click = "KC_AUDIO_MUTE",
+            .left = "KC_AUDIO_VOL_DOWN",
+            .right = "KC_AUDIO_VOL_UP",
+        },
+    },
+};
 
 static void get_mac_address_str(char *mac_str, const size_t size) {
     uint8_t mac[6];
@@ -153,395 +102,401 @@ static bool is_verifying_new_fw() {
     return false;
 }
 
-static char* update_device_info_in_settings(const char* settings_json) {
-    if (!settings_json) return NULL;
-    
-    cJSON *root = cJSON_Parse(settings_json);
-    if (!root) {
-        ESP_LOGE(STORAGE_TAG, "Error parsing settings JSON");
-        return strdup(settings_json); // Return original if parsing fails
-    }
-    
-    cJSON *device_info = cJSON_GetObjectItem(root, "deviceInfo");
-    if (!device_info) {
-        if (VERBOSE) {
-            ESP_LOGW(STORAGE_TAG, "deviceInfo not found in settings");
-        }
-
-        char *result = strdup(settings_json);
-        cJSON_Delete(root);
-        return result;
-    }
-    
-    char mac_str[18]; // XX:XX:XX:XX:XX:XX + null terminator
-    get_mac_address_str(mac_str, sizeof(mac_str));
-    
-    cJSON *mac_address = cJSON_GetObjectItem(device_info, "macAddress");
-    if (mac_address) {
-        cJSON_SetValuestring(mac_address, mac_str);
-    } else {
-        cJSON_AddStringToObject(device_info, "macAddress", mac_str);
+static void decode_string(const cJSON *obj, const char *key, char *out, const size_t len) {
+    const cJSON *item = cJSON_GetObjectItem(obj, key);
+    if (cJSON_IsString(item)) {
+        strncpy(out, item->valuestring, len - 1);
+        out[len - 1] = '\0';
     }
+}
 
-    cJSON *fw_version = cJSON_GetObjectItem(device_info, "fwVersion");
-    if (fw_version) {
-        cJSON_SetValuestring(fw_version, FIRMWARE_VERSION);
-    } else {
-        cJSON_AddStringToObject(device_info, "fwVersion", FIRMWARE_VERSION);
+static void decode_int(const cJSON *obj, const char *key, int *out) {
+    const cJSON *item = cJSON_GetObjectItem(obj, key);
+    if (cJSON_IsNumber(item)) {
+        *out = item->valueint;
     }
+}
 
-    const bool is_new_fw = is_verifying_new_fw();
-    cJSON *new_fw = cJSON_GetObjectItem(device_info, "newFirmware");
-    if (new_fw) {
-        cJSON_SetBoolValue(new_fw, is_new_fw);
-    } else {
-        cJSON_AddBoolToObject(device_info, "newFirmware", is_new_fw);
+static void decode_bool(const cJSON *obj, const char *key, bool *out) {
+    const cJSON *item = cJSON_GetObjectItem(obj, key);
+    if (cJSON_IsBool(item)) {
+        *out = cJSON_IsTrue(item);
     }
-    
-    char *updated_settings = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
-    return updated_settings;
 }
 
-esp_err_t init_global_settings(void) {
-    if (current_settings != NULL) {
-        free(current_settings);
-        current_settings = NULL;
-    }
-    
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(STORAGE_TAG, "Error opening NVS: %s", esp_err_to_name(err));
-        char *updated_settings = update_device_info_in_settings(default_settings);
-        current_settings = updated_settings ? updated_settings : strdup(default_settings);
-        return err;
+static void decode_button_actions(const cJSON *array, settings_button_action_t *out) {
+    if (!cJSON_IsArray(array)) {
+        return;
     }
-    
-    size_t required_size = 0;
-    err = nvs_get_str(nvs_handle, SETTINGS_NVS_KEY, NULL, &required_size);
-    if (err == ESP_OK && required_size > 0) {
-        char *nvs_settings = malloc(required_size);
-        if (nvs_settings == NULL) {
-            ESP_LOGE(STORAGE_TAG, "Failed to allocate memory for settings");
-            nvs_close(nvs_handle);
-            char *updated_settings = update_device_info_in_settings(default_settings);
-            current_settings = updated_settings ? updated_settings : strdup(default_settings);
-            return ESP_ERR_NO_MEM;
-        }
-        
-        err = nvs_get_str(nvs_handle, SETTINGS_NVS_KEY, nvs_settings, &required_size);
-        if (err != ESP_OK) {
-            ESP_LOGE(STORAGE_TAG, "Error getting settings from NVS: %s", esp_err_to_name(err));
-            free(nvs_settings);
-            char *updated_settings = update_device_info_in_settings(default_settings);
-            current_settings = updated_settings ? updated_settings : strdup(default_settings);
-            if (current_settings) {
-                err = nvs_set_str(nvs_handle, SETTINGS_NVS_KEY, current_settings);
-                if (err == ESP_OK) nvs_commit(nvs_handle);
-            }
-        } else {
-            char *updated_settings = update_device_info_in_settings(nvs_settings);
-            current_settings = updated_settings ? updated_settings : strdup(nvs_settings);
-            if (current_settings) {
-                err = nvs_set_str(nvs_handle, SETTINGS_NVS_KEY, current_settings);
-                if (err == ESP_OK) nvs_commit(nvs_handle);
-            }
-            free(nvs_settings);
-        }
-    } else {
-        if (VERBOSE) {
-            ESP_LOGI(STORAGE_TAG, "No settings found in NVS, using defaults");
+
+    for (int i = 0; i < SETTINGS_NUM_BUTTONS; i++) {
+        const cJSON *item = cJSON_GetArrayItem(array, i);
+        if (!cJSON_IsObject(item)) {
+            continue;
         }
 
-        char *updated_settings = update_device_info_in_settings(default_settings);
-        current_settings = updated_settings ? updated_settings : strdup(default_settings);
-        
-        if (current_settings) {
-            err = nvs_set_str(nvs_handle, SETTINGS_NVS_KEY, current_settings);
-            if (err != ESP_OK) {
-                ESP_LOGE(STORAGE_TAG, "Error saving settings to NVS: %s", esp_err_to_name(err));
-            } else {
-                err = nvs_commit(nvs_handle);
-                if (err != ESP_OK) {
-                    ESP_LOGE(STORAGE_TAG, "Error committing NVS: %s", esp_err_to_name(err));
+        decode_string(item, "acType", out[i].ac_type, sizeof(out[i].ac_type));
+        decode_string(item, "action", out[i].action, sizeof(out[i].action));
+
+        const cJSON *mods = cJSON_GetObjectItem(item, "mods");
+        if (cJSON_IsArray(mods)) {
+            out[i].num_mods = 0;
+            const cJSON *mod;
+            cJSON_ArrayForEach(mod, mods) {
+                if (out[i].num_mods >= SETTINGS_MAX_MODS) {
+                    break;
+                }
+                if (cJSON_IsString(mod)) {
+                    char *dst = out[i].mods[out[i].num_mods++];
+                    strncpy(dst, mod->valuestring, SETTINGS_MOD_LEN - 1);
+                    dst[SETTINGS_MOD_LEN - 1] = '\0';
                 }
             }
         }
     }
+}
 
-    if (VERBOSE) {
-        ESP_LOGI(STORAGE_TAG, "Current settings: %s", current_settings);
-    }
-
-    nvs_close(nvs_handle);
-    return ESP_OK;
+// Only overwrites what is present, so decoding the defaults first fills the gaps
+static void decode_settings(const cJSON *root, settings_t *out) {
+    const cJSON *device_info = cJSON_GetObjectItem(root, "deviceInfo");
+    decode_string(device_info, "name", out->device_info.name, sizeof(out->device_info.name));
+
+    const cJSON *power = cJSON_GetObjectItem(root, "power");
+    decode_bool(power, "enableSleep", &out->power.enable_sleep);
+    decode_string(power, "warpSpeed", out->power.warp_speed, sizeof(out->power.warp_speed));
+    decode_bool(power, "twoSleeps", &out->power.two_sleeps);
+    decode_int(power, "sleepTimeout", &out->power.sleep_timeout);
+    decode_bool(power, "deepSleep", &out->power.deep_sleep);
+    decode_bool(power, "disableSlowPhase", &out->power.disable_slow_phase);
+    decode_bool(power, "disableWarn", &out->power.disable_warn);
+    decode_bool(power, "fastCharge", &out->power.fast_charge);
+    decode_int(power, "deepSleepTimeout", &out->power.deep_sleep_timeout);
+
+    decode_int(cJSON_GetObjectItem(root, "led"), "brightness", &out->led.brightness);
+
+    const cJSON *mouse = cJSON_GetObjectItem(root, "mouse");
+    decode_int(mouse, "sensitivity", &out->mouse.sensitivity);
+    decode_int(mouse, "acceleration", &out->mouse.acceleration);
+
+    const cJSON *connectivity = cJSON_GetObjectItem(root, "connectivity");
+    decode_string(connectivity, "bleTxPower", out->connectivity.ble_tx_power, sizeof(out->connectivity.ble_tx_power));
+    decode_int(connectivity, "bleRecDelay", &out->connectivity.ble_rec_delay);
+
+    const cJSON *buttons = cJSON_GetObjectItem(root, "buttons");
+    decode_int(buttons, "longPressMs", &out->buttons.long_press_ms);
+    decode_button_actions(cJSON_GetObjectItem(buttons, "keys"), out->buttons.keys);
+    decode_button_actions(cJSON_GetObjectItem(buttons, "longPress"), out->buttons.long_press);
+
+    const cJSON *encoder = cJSON_GetObjectItem(buttons, "encoder");
+    decode_string(encoder, "mode", out->buttons.encoder.mode, sizeof(out->buttons.encoder.mode));
+    decode_string(encoder, "click", out->buttons.encoder.click, sizeof(out->buttons.encoder.click));
+    decode_string(encoder, "left", out->buttons.encoder.left, sizeof(out->buttons.encoder.left));
+    decode_string(encoder, "right", out->buttons.encoder.right, sizeof(out->buttons.encoder.right));
 }
 
-const char* storage_get_settings(void) {
-    if (current_settings == NULL) {
-        init_global_settings();
+static void encode_button_actions(cJSON *parent, const char *key, const settings_button_action_t *actions) {
+    cJSON *array = cJSON_AddArrayToObject(parent, key);
+    if (!array) {
+        return;
     }
-    
-    if (current_settings) {
-        char *updated_settings = update_device_info_in_settings(current_settings);
-        if (updated_settings) {
-            free(current_settings);
-            current_settings = updated_settings;
+
+    for (int i = 0; i < SETTINGS_NUM_BUTTONS; i++) {
+        cJSON *item = cJSON_CreateObject();
+        if (!item) {
+            return;
+        }
+
+        cJSON_AddStringToObject(item, "acType", actions[i].ac_type);
+        cJSON_AddStringToObject(item, "action", actions[i].action);
+        cJSON *mods = cJSON_AddArrayToObject(item, "mods");
+        for (int j = 0; mods && j < actions[i].num_mods; j++) {
+            cJSON_AddItemToArray(mods, cJSON_CreateString(actions[i].mods[j]));
         }
+        cJSON_AddItemToArray(array, item);
     }
-    
-    return current_settings;
 }
 
-esp_err_t storage_update_settings(const char* settings_json) {
-    if (!settings_json) return ESP_ERR_INVALID_ARG;
-    
-    char *updated_settings = update_device_info_in_settings(settings_json);
-    if (!updated_settings) return ESP_ERR_NO_MEM;
-    
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+// Inverse of decode_settings(), deviceInfo also carries the fields that are not stored
+static char* encode_settings(const settings_t *settings) {
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
+
+    char mac_str[18]; // XX:XX:XX:XX:XX:XX + null terminator
+    get_mac_address_str(mac_str, sizeof(mac_str));
+
+    cJSON *device_info = cJSON_AddObjectToObject(root, "deviceInfo");
+    cJSON_AddStringToObject(device_info, "name", settings->device_info.name);
+    cJSON_AddStringToObject(device_info, "fwVersion", FIRMWARE_VERSION);
+    cJSON_AddStringToObject(device_info, "hwVersion", HARDWARE_VERSION);
+    cJSON_AddStringToObject(device_info, "macAddress", mac_str);
+    cJSON_AddBoolToObject(device_info, "newFirmware", is_verifying_new_fw());
+
+    cJSON *power = cJSON_AddObjectToObject(root, "power");
+    cJSON_AddBoolToObject(power, "enableSleep", settings->power.enable_sleep);
+    cJSON_AddStringToObject(power, "warpSpeed", settings->power.warp_speed);
+    cJSON_AddBoolToObject(power, "twoSleeps", settings->power.two_sleeps);
+    cJSON_AddNumberToObject(power, "sleepTimeout", settings->power.sleep_timeout);
+    cJSON_AddBoolToObject(power, "deepSleep", settings->power.deep_sleep);
+    cJSON_AddBoolToObject(power, "disableSlowPhase", settings->power.disable_slow_phase);
+    cJSON_AddBoolToObject(power, "disableWarn", settings->power.disable_warn);
+    cJSON_AddBoolToObject(power, "fastCharge", settings->power.fast_charge);
+    cJSON_AddNumberToObject(power, "deepSleepTimeout", settings->power.deep_sleep_timeout);
+
+    cJSON *led = cJSON_AddObjectToObject(root, "led");
+    cJSON_AddNumberToObject(led, "brightness", settings->led.brightness);
+
+    cJSON *mouse = cJSON_AddObjectToObject(root, "mouse");
+    cJSON_AddNumberToObject(mouse, "sensitivity", settings->mouse.sensitivity);
+    cJSON_AddNumberToObject(mouse, "acceleration", settings->mouse.acceleration);
+
+    cJSON *connectivity = cJSON_AddObjectToObject(root, "connectivity");
+    cJSON_AddStringToObject(connectivity, "bleTxPower", settings->connectivity.ble_tx_power);
+    cJSON_AddNumberToObject(connectivity, "bleRecDelay", settings->connectivity.ble_rec_delay);
+
+    cJSON *buttons = cJSON_AddObjectToObject(root, "buttons");
+    cJSON_AddNumberToObject(buttons, "longPressMs", settings->buttons.long_press_ms);
+    encode_button_actions(buttons, "keys", settings->buttons.keys);
+    encode_button_actions(buttons, "longPress", settings->buttons.long_press);
+
+    cJSON *encoder = cJSON_AddObjectToObject(buttons, "encoder");
+    cJSON_AddStringToObject(encoder, "mode", settings->buttons.encoder.mode);
+    cJSON_AddStringToObject(encoder, "click", settings->buttons.encoder.click);
+    cJSON_AddStringToObject(encoder, "left", settings->buttons.encoder.left);
+    cJSON_AddStringToObject(encoder, "right", settings->buttons.encoder.right);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
+
+static esp_err_t read_record(const nvs_handle_t nvs_handle, settings_t *out) {
+    size_t length = 0;
+    esp_err_t err = nvs_get_blob(nvs_handle, SETTINGS_NVS_RECORD_KEY, NULL, &length);
     if (err != ESP_OK) {
-        ESP_LOGE(STORAGE_TAG, "Error opening NVS: %s", esp_err_to_name(err));
-        free(updated_settings);
         return err;
     }
-    
-    err = nvs_set_str(nvs_handle, SETTINGS_NVS_KEY, updated_settings);
+
+    settings_record_t *record = malloc(sizeof(settings_record_t));
+    if (!record) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (length > sizeof(settings_record_t)) {
+        err = ESP_ERR_INVALID_SIZE;
+    } else {
+        err = nvs_get_blob(nvs_handle, SETTINGS_NVS_RECORD_KEY, record, &length);
+    }
+
+    if (err == ESP_OK) {
+        switch (record->version) {
+            case SETTINGS_SCHEMA_VERSION:
+                if (length == sizeof(settings_record_t) && record->size == sizeof(settings_t)) {
+                    memcpy(out, &record->settings, sizeof(settings_t));
+                } else {
+                    err = ESP_ERR_INVALID_SIZE;
+                }
+                break;
+            default:
+                err = ESP_ERR_INVALID_VERSION;
+                break;
+        }
+    }
+
+    free(record);
+    return err;
+}
+
+static esp_err_t write_record(const nvs_handle_t nvs_handle, const settings_t *settings) {
+    settings_record_t *record = malloc(sizeof(settings_record_t));
+    if (!record) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    record->version = SETTINGS_SCHEMA_VERSION;
+    record->size = sizeof(settings_t);
+    memcpy(&record->settings, settings, sizeof(settings_t));
+
+    esp_err_t err = nvs_set_blob(nvs_handle, SETTINGS_NVS_RECORD_KEY, record, sizeof(settings_record_t));
+    free(record);
     if (err != ESP_OK) {
         ESP_LOGE(STORAGE_TAG, "Error saving settings to NVS: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
         return err;
     }
-    
+
     err = nvs_commit(nvs_handle);
     if (err != ESP_OK) {
         ESP_LOGE(STORAGE_TAG, "Error committing NVS: %s", esp_err_to_name(err));
     }
-    
-    nvs_close(nvs_handle);
-    
-    if (err == ESP_OK) {
-        if (current_settings) {
-            free(current_settings);
-        }
-        current_settings = updated_settings;
-        cache_clear();
-    } else {
-        free(updated_settings);
-    }
-    
     return err;
 }
 
-static cJSON* find_json_by_path(const char* path) {
-    if (!path || !current_settings) return NULL;
-    
-    cJSON *root = cJSON_Parse(current_settings);
-    if (!root) {
-        ESP_LOGE(STORAGE_TAG, "Error parsing settings JSON");
-        return NULL;
+// Schema version 0 was the JSON string, decoded once and converted to a record
+static esp_err_t migrate_json_settings(const nvs_handle_t nvs_handle, settings_t *out) {
+    size_t required_size = 0;
+    esp_err_t err = nvs_get_str(nvs_handle, SETTINGS_NVS_KEY, NULL, &required_size);
+    if (err != ESP_OK) {
+        return err;
     }
-    
-    char *path_copy = strdup(path);
-    if (!path_copy) {
-        cJSON_Delete(root);
-        return NULL;
+
+    char *json = malloc(required_size);
+    if (!json) {
+        return ESP_ERR_NO_MEM;
     }
-    
-    char *token;
-    char *rest = path_copy;
-    cJSON *current = root;
-    
-    while ((token = strtok_r(rest, ".", &rest))) {
-        char *array_index = strchr(token, '[');
-        if (array_index) {
-            *array_index = '\0';
-            array_index++;
-            char *end_bracket = strchr(array_index, ']');
-            if (end_bracket) {
-                *end_bracket = '\0';
-                const int index = atoi(array_index);
-                
-                if (token[0] != '\0') {
-                    current = cJSON_GetObjectItem(current, token);
-                    if (!current) {
-                        if (VERBOSE) {
-                            ESP_LOGW(STORAGE_TAG, "Object %s not found in settings", token);
-                        }
-
-                        free(path_copy);
-                        cJSON_Delete(root);
-                        return NULL;
-                    }
-                }
-                
-                current = cJSON_GetArrayItem(current, index);
-                if (!current) {
-                    if (VERBOSE) {
-                        ESP_LOGW(STORAGE_TAG, "Array index %d not found in settings", index);
-                    }
-
-                    free(path_copy);
-                    cJSON_Delete(root);
-                    return NULL;
-                }
-            }
-        } else {
-            current = cJSON_GetObjectItem(current, token);
-            if (!current) {
-                if (VERBOSE) {
-                    ESP_LOGW(STORAGE_TAG, "Path %s not found in settings", path);
-                }
 
-                free(path_copy);
-                cJSON_Delete(root);
-                return NULL;
-            }
-        }
+    err = nvs_get_str(nvs_handle, SETTINGS_NVS_KEY, json, &required_size);
+    cJSON *root = err == ESP_OK ? cJSON_Parse(json) : NULL;
+    free(json);
+    if (!root) {
+        ESP_LOGE(STORAGE_TAG, "Error parsing legacy settings JSON");
+        return err == ESP_OK ? ESP_ERR_INVALID_STATE : err;
     }
-    
-    free(path_copy);
-    
-    cJSON *result = cJSON_Duplicate(current, true);
+
+    decode_settings(root, out);
     cJSON_Delete(root);
-    
-    return result;
+
+    // The JSON key stays behind so that a rolled back firmware still finds its settings
+    err = write_record(nvs_handle, out);
+    if (err == ESP_OK) {
+        ESP_LOGW(STORAGE_TAG, "Settings migrated to schema version %d", SETTINGS_SCHEMA_VERSION);
+    }
+    return err;
 }
 
-esp_err_t storage_get_string_setting(const char* path, char* value, const size_t max_len) {
-    if (!path || !value || max_len == 0) return ESP_ERR_INVALID_ARG;
-    
-    cache_entry_t* entry = cache_find(path);
-    if(entry && entry->type == CACHE_TYPE_STRING) {
-        strncpy(value, entry->value.str, max_len - 1);
-        value[max_len - 1] = '\0';
-        return ESP_OK;
+// Boot path: a single blob read, NVS is only written when migrating from an older format
+static esp_err_t load_settings(settings_t *out) {
+    memcpy(out, &s_default_settings, sizeof(settings_t));
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(STORAGE_TAG, "Error opening NVS: %s", esp_err_to_name(err));
+        return err;
     }
-    
-    cJSON *item = find_json_by_path(path);
-    if (!item) return ESP_ERR_NOT_FOUND;
-    
-    if (cJSON_IsString(item)) {
-        entry = cache_add(path);
-        entry->type = CACHE_TYPE_STRING;
-        strncpy(entry->value.str, item->valuestring, sizeof(entry->value.str) - 1);
-        entry->value.str[sizeof(entry->value.str) - 1] = '\0';
-        
-        strncpy(value, item->valuestring, max_len - 1);
-        value[max_len - 1] = '\0';
-        cJSON_Delete(item);
-        return ESP_OK;
+
+    err = read_record(nvs_handle, out);
+    if (err != ESP_OK) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(STORAGE_TAG, "Unusable settings record: %s", esp_err_to_name(err));
+        }
+
+        memcpy(out, &s_default_settings, sizeof(settings_t));
+        err = migrate_json_settings(nvs_handle, out);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            if (VERBOSE) {
+                ESP_LOGI(STORAGE_TAG, "No settings found in NVS, using defaults");
+            }
+            err = ESP_OK;
+        }
     }
-    
-    cJSON_Delete(item);
-    return ESP_ERR_INVALID_ARG;
+
+    nvs_close(nvs_handle);
+    return err;
 }
 
-esp_err_t storage_get_int_setting(const char* path, int* value) {
-    if (!path || !value) return ESP_ERR_INVALID_ARG;
-    
-    cache_entry_t* entry = cache_find(path);
-    if(entry && entry->type == CACHE_TYPE_INT) {
-        *value = entry->value.num;
-        return ESP_OK;
+static settings_t* spare_snapshot(void) {
+    return s_settings == &s_snapshots[0] ? &s_snapshots[1] : &s_snapshots[0];
+}
+
+esp_err_t init_global_settings(void) {
+    settings_t *next = spare_snapshot();
+    const esp_err_t err = load_settings(next);
+    s_settings = next;
+    return err;
+}
+
+const settings_t* storage_settings(void) {
+    if (s_settings == NULL) {
+        init_global_settings();
     }
-    
-    cJSON *item = find_json_by_path(path);
-    if (!item) return ESP_ERR_NOT_FOUND;
-    
-    if (cJSON_IsNumber(item)) {
-        entry = cache_add(path);
-        entry->type = CACHE_TYPE_INT;
-        entry->value.num = item->valueint;
-        
-        *value = item->valueint;
-        cJSON_Delete(item);
-        return ESP_OK;
+
+    return s_settings;
+}
+
+const char* storage_get_settings(void) {
+    char *json = encode_settings(storage_settings());
+    if (json) {
+        free(s_settings_json);
+        s_settings_json = json;
     }
-    
-    cJSON_Delete(item);
-    return ESP_ERR_INVALID_ARG;
+
+    return s_settings_json;
 }
 
-esp_err_t storage_get_bool_setting(const char* path, bool* value) {
-    if (!path || !value) return ESP_ERR_INVALID_ARG;
-    
-    cache_entry_t* entry = cache_find(path);
-    if(entry && entry->type == CACHE_TYPE_BOOL) {
-        *value = entry->value.flag;
-        return ESP_OK;
+esp_err_t storage_subscribe(const settings_listener_t listener) {
+    if (!listener) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&s_listeners_lock);
+    if (s_num_listeners < MAX_SETTINGS_LISTENERS) {
+        s_listeners[s_num_listeners++] = listener;
+    } else {
+        err = ESP_ERR_NO_MEM;
     }
-    
-    cJSON *item = find_json_by_path(path);
-    if (!item) return ESP_ERR_NOT_FOUND;
-    
-    if (cJSON_IsBool(item)) {
-        entry = cache_add(path);
-        entry->type = CACHE_TYPE_BOOL;
-        entry->value.flag = cJSON_IsTrue(item);
-        
-        *value = cJSON_IsTrue(item);
-        cJSON_Delete(item);
-        return ESP_OK;
+    taskEXIT_CRITICAL(&s_listeners_lock);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(STORAGE_TAG, "No free settings listener slots");
     }
-    
-    cJSON_Delete(item);
-    return ESP_ERR_INVALID_ARG;
+    return err;
 }
 
-esp_err_t storage_get_float_setting(const char* path, float* value) {
-    if (!path || !value) return ESP_ERR_INVALID_ARG;
-    
-    cache_entry_t* entry = cache_find(path);
-    if(entry && entry->type == CACHE_TYPE_FLOAT) {
-        *value = entry->value.fnum;
-        return ESP_OK;
-    }
-    
-    cJSON *item = find_json_by_path(path);
-    if (!item) return ESP_ERR_NOT_FOUND;
-    
-    if (cJSON_IsNumber(item)) {
-        entry = cache_add(path);
-        entry->type = CACHE_TYPE_FLOAT;
-        entry->value.fnum = (float)item->valuedouble;
-        
-        *value = (float)item->valuedouble;
-        cJSON_Delete(item);
-        return ESP_OK;
+// Everything else is applied live by the subscribed listeners
+static bool requires_restart(const settings_t *settings, const settings_t *previous) {
+    return strcmp(settings->device_info.name, previous->device_info.name) != 0;
+}
+
+static void notify_listeners(const settings_t *settings, const settings_t *previous) {
+    taskENTER_CRITICAL(&s_listeners_lock);
+    const uint8_t count = s_num_listeners;
+    taskEXIT_CRITICAL(&s_listeners_lock);
+
+    for (uint8_t i = 0; i < count; i++) {
+        s_listeners[i](settings, previous);
     }
-    
-    cJSON_Delete(item);
-    return ESP_ERR_INVALID_ARG;
 }
 
-esp_err_t storage_get_string_array_setting(const char* path, char** values, size_t* max_strings, const size_t max_len) {
-    if (!path || !values || *max_strings == 0 || max_len == 0) return ESP_ERR_INVALID_ARG;
-    
-    cJSON *array = find_json_by_path(path);
-    if (!array) return ESP_ERR_NOT_FOUND;
-    
-    if (!cJSON_IsArray(array)) {
-        cJSON_Delete(array);
+esp_err_t storage_update_settings(const char* settings_json, bool *restart_required) {
+    if (restart_required) *restart_required = false;
+    if (!settings_json) return ESP_ERR_INVALID_ARG;
+
+    cJSON *root = cJSON_Parse(settings_json);
+    if (!root) {
+        ESP_LOGE(STORAGE_TAG, "Error parsing settings JSON");
         return ESP_ERR_INVALID_ARG;
     }
 
-    const int array_size = cJSON_GetArraySize(array);
-    const size_t items_to_read = (array_size < *max_strings) ? array_size : *max_strings;
-    *max_strings = items_to_read;
-    
-    for (size_t i = 0; i < items_to_read; i++) {
-        const cJSON *item = cJSON_GetArrayItem(array, i);
-        if (cJSON_IsString(item)) {
-            strncpy(values[i], item->valuestring, max_len - 1);
-            values[i][max_len - 1] = '\0';
+    // The spare snapshot is decoded into, the current one stays intact for the listeners
+    const settings_t *previous = storage_settings();
+    settings_t *next = spare_snapshot();
+    memcpy(next, &s_default_settings, sizeof(settings_t));
+    decode_settings(root, next);
+    cJSON_Delete(root);
+
+    if (memcmp(next, previous, sizeof(settings_t)) == 0) {
+        if (VERBOSE) {
+            ESP_LOGI(STORAGE_TAG, "Settings unchanged, nothing to write");
         }
+        return ESP_OK;
     }
-    
-    cJSON_Delete(array);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(STORAGE_TAG, "Error opening NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = write_record(nvs_handle, next);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_settings = next;
+    if (restart_required) {
+        *restart_required = requires_restart(next, previous);
+    }
+    notify_listeners(next, previous);
     return ESP_OK;
 }
 
@@ -2,82 +2,122 @@
 
 #include <esp_err.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Settings namespace and keys for NVS
 #define SETTINGS_NVS_NAMESPACE "device_settings"
-#define SETTINGS_NVS_KEY "settings"
+#define SETTINGS_NVS_KEY "settings"         // Legacy JSON string, migrated on first boot
+#define SETTINGS_NVS_RECORD_KEY "settings_bin" // Versioned binary record
 #define WIFI_CONFIG_NAMESPACE "wifi_config"
 #define BOOT_WIFI_KEY "boot_wifi"
 
-/**
- * @brief Initialize device settings from NVS or defaults
- * 
- * @return esp_err_t ESP_OK on success
- */
-esp_err_t init_global_settings(void);
+#define SETTINGS_NUM_BUTTONS 4
+#define SETTINGS_MAX_MODS 4
+#define SETTINGS_MOD_LEN 8
+#define SETTINGS_ACTION_LEN 24
 
-/**
- * @brief Get the current settings as a JSON string
- * 
- * @return const char* Current settings JSON string
- */
-const char* storage_get_settings(void);
+typedef struct {
+    char ac_type[SETTINGS_ACTION_LEN];
+    char action[SETTINGS_ACTION_LEN];
+    char mods[SETTINGS_MAX_MODS][SETTINGS_MOD_LEN];
+    uint8_t num_mods;
+} settings_button_action_t;
+
+// Typed view of the settings JSON, decoded once whenever the settings change.
+// Fields missing from the stored JSON keep the values of the built-in defaults.
+typedef struct {
+    struct {
+        char name[32];
+    } device_info;
+    struct {
+        bool enable_sleep;
+        char warp_speed[12];
+        bool two_sleeps;
+        int sleep_timeout;
+        bool deep_sleep;
+        bool disable_slow_phase;
+        bool disable_warn;
+        bool fast_charge;
+        int deep_sleep_timeout;
+    } power;
+    struct {
+        int brightness;
+    } led;
+    struct {
+        int sensitivity;
+        int acceleration;
+    } mouse;
+    struct {
+        char ble_tx_power[8];
+        int ble_rec_delay;
+    } connectivity;
+    struct {
+        int long_press_ms;
+        settings_button_action_t keys[SETTINGS_NUM_BUTTONS];
+        settings_button_action_t long_press[SETTINGS_NUM_BUTTONS];
+        struct {
+            char mode[SETTINGS_ACTION_LEN];
+            char click[SETTINGS_ACTION_LEN];
+            char left[SETTINGS_ACTION_LEN];
+            char right[SETTINGS_ACTION_LEN];
+        } encoder;
+    } buttons;
+} settings_t;
 
 /**
- * @brief Update device settings with new JSON
- * 
- * @param settings_json New settings JSON string
- * @return esp_err_t ESP_OK on success
+ * @brief Settings change listener
+ *
+ * Called from the task that applied the update, after the new snapshot has been published.
+ * Both pointers stay valid until the listener returns.
+ *
+ * @param settings New settings
+ * @param previous Settings before the update
  */
-esp_err_t storage_update_settings(const char* settings_json);
+typedef void (*settings_listener_t)(const settings_t *settings, const settings_t *previous);
 
 /**
- * @brief Get a specific setting value as a string
+ * @brief Initialize device settings from NVS or defaults
  * 
- * @param path JSON path to the setting (e.g., "power.sleepTimeout")
- * @param value Buffer to store the value
- * @param max_len Maximum length of the value buffer
  * @return esp_err_t ESP_OK on success
  */
-esp_err_t storage_get_string_setting(const char* path, char* value, size_t max_len);
+esp_err_t init_global_settings(void);
 
 /**
- * @brief Get a specific setting value as an integer
+ * @brief Get the current settings as a JSON string
+ *
+ * Generated from the settings snapshot on every call, meant for the web UI only.
  * 
- * @param path JSON path to the setting (e.g., "power.sleepTimeout")
- * @param value Pointer to store the integer value
- * @return esp_err_t ESP_OK on success
+ * @return const char* Current settings JSON string, valid until the next call
  */
-esp_err_t storage_get_int_setting(const char* path, int* value);
+const char* storage_get_settings(void);
 
 /**
- * @brief Get a specific setting value as a boolean
+ * @brief Update device settings with new JSON and notify the subscribed listeners
  * 
- * @param path JSON path to the setting (e.g., "power.lowPowerMode")
- * @param value Pointer to store the boolean value
+ * @param settings_json New settings JSON string
+ * @param restart_required Optional, set to true if a changed setting only takes effect after a reboot
  * @return esp_err_t ESP_OK on success
  */
-esp_err_t storage_get_bool_setting(const char* path, bool* value);
+esp_err_t storage_update_settings(const char* settings_json, bool *restart_required);
 
 /**
- * @brief Get a specific setting value as a float
- * 
- * @param path JSON path to the setting (e.g., "power.output")
- * @param value Pointer to store the float value
- * @return esp_err_t ESP_OK on success
+ * @brief Subscribe to settings changes
+ *
+ * Listeners are never removed, subscribe once during init.
+ *
+ * @param listener Callback invoked after every successful settings update
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if all listener slots are taken
  */
-esp_err_t storage_get_float_setting(const char* path, float* value);
+esp_err_t storage_subscribe(settings_listener_t listener);
 
 /**
- * @brief Get a specific setting value as a string array
- * 
- * @param path JSON path to the setting array
- * @param values Array of char arrays to store the strings
- * @param max_strings Maximum number of strings to read
- * @param max_len Maximum length of each string
- * @return esp_err_t ESP_OK on success
+ * @brief Get the decoded settings snapshot
+ *
+ * Plain field reads, meant for hot paths. The pointer stays valid until the next settings update.
+ *
+ * @return const settings_t* Current settings, loaded on first use
  */
-esp_err_t storage_get_string_array_setting(const char* path, char** values, size_t* max_strings, size_t max_len);
+const settings_t* storage_settings(void);
 
 /**
  * @brief Set the one-time boot with WiFi flag
@@ -30,6 +30,7 @@ static float bat_volts = 0;
 static bool s_slow_phase = false;
 static bool s_charging_finished = false;
 static bool s_disable_warn = false;
+static volatile bool s_charge_settings_changed = false;
 
 // ToDo remove this and impement proper termination
 static void slow_phase_timer_cb(TimerHandle_t xTimer) {
@@ -71,8 +72,7 @@ void enable_no_wire_mode() {
 static void start_charging() {
     gpio_set_level(GPIO_BAT_CE, 1);
 
-    static bool fast_charge;
-    if (storage_get_bool_setting("power.fastCharge", &fast_charge) == ESP_OK && fast_charge) {
+    if (storage_settings()->power.fast_charge) {
         ESP_LOGW(TAG, "Fast charging ENABLED!");
 
         // ±5W
@@ -100,13 +100,17 @@ static void start_charging() {
     gpio_set_level(GPIO_BAT_CE, 0);
 }
 
-void vmon_task(void *pvParameters) {
-    bool disable_slow_phase;
-    bool fast_charge;
+// Charger pins belong to vmon_task, so a changed charge current is only flagged here
+static void on_settings_changed(const settings_t *settings, const settings_t *previous) {
+    s_disable_warn = settings->power.disable_warn;
+    if (settings->power.fast_charge != previous->power.fast_charge) {
+        s_charge_settings_changed = true;
+    }
+}
 
-    storage_get_bool_setting("power.disableSlowPhase", &disable_slow_phase);
-    storage_get_bool_setting("power.fastCharge", &fast_charge);
-    storage_get_bool_setting("power.disableWarn", &s_disable_warn);
+void vmon_task(void *pvParameters) {
+    s_disable_warn = storage_settings()->power.disable_warn;
+    storage_subscribe(on_settings_changed);
     vTaskDelay(pdMS_TO_TICKS(50));
 
     uint16_t i = 0;
@@ -176,6 +180,17 @@ void vmon_task(void *pvParameters) {
             continue;
         }
 
+        if (s_charge_settings_changed) {
+            s_charge_settings_changed = false;
+            if (s_psu_connected && !s_slow_phase) {
+                start_charging();
+            }
+        }
+
+        const settings_t *settings = storage_settings();
+        const bool disable_slow_phase = settings->power.disable_slow_phase;
+        const bool fast_charge = settings->power.fast_charge;
+
         if (s_slow_phase && s_psu_connected && !s_charging) {
             ESP_LOGW(TAG, "Charging finished!");
 
@@ -126,6 +126,35 @@ const ConfirmModal = ({ isOpen, onClose, title, message, onYes, onNo, showCancel
     );
 };
 
+// esp_sleep_wakeup_cause_t
+const WAKEUP_CAUSES = {
+    0: 'Power on / reset',
+    2: 'EXT0',
+    3: 'EXT1',
+    4: 'Timer',
+    6: 'ULP',
+    7: 'GPIO',
+};
+
+const BootTimeline = ({ phases, boot }) => {
+    const last = Math.max(1, ...boot.marks);
+
+    return (
+        <div className="boot-timeline">
+            <div className="setting-title">{WAKEUP_CAUSES[boot.cause] || `Wakeup cause ${boot.cause}`}</div>
+            {phases.map((phase, i) => (
+                <div key={phase} className="boot-phase">
+                    <div className="boot-phase-name">{phase}</div>
+                    <div className="boot-phase-bar">
+                        {boot.marks[i] > 0 && <div style={{width: `${boot.marks[i] / last * 100}%`}}></div>}
+                    </div>
+                    <div className="boot-phase-time">{boot.marks[i] > 0 ? `${(boot.marks[i] / 1000).toFixed(1)} ms` : '—'}</div>
+                </div>
+            ))}
+        </div>
+    );
+};
+
 const App = () => {
     const [isModalOpen, setIsModalOpen] = React.useState(false);
     const [confirmModal, setConfirmModal] = React.useState({ isOpen: false, config: {} });
@@ -164,6 +193,7 @@ const App = () => {
         },
         mouse: {
             sensitivity: 100,
+            acceleration: 0,
         },
         buttons: {
             longPressMs: 750,
@@ -225,6 +255,7 @@ const App = () => {
     const [otaProgress, setOtaProgress] = React.useState(0);
     const [otaInProgress, setOtaInProgress] = React.useState(false);
     const [deviceInfoExpanded, setDeviceInfoExpanded] = React.useState(false);
+    const [bootTrace, setBootTrace] = React.useState({ phases: [], boots: [] });
     const fileInputRef = React.useRef(null);
     const initialSettingsRef = React.useRef(null);
 
@@ -269,12 +300,20 @@ const App = () => {
                     }
                     break;
                 case 'settings_update_status':
-                    if (message.content.success) {
+                    if (message.content.success && message.content.restart === false) {
+                        initialSettingsRef.current = JSON.stringify(settings);
+                        showStatus('Settings applied.', 'success');
+                    } else if (message.content.success) {
                         showStatus('Settings updated successfully. The device is restarting.', 'success');
                     } else {
                         showStatus(`Failed to update settings: ${message.content.error}`, 'error');
                     }
                     break;
+                case 'boot_trace':
+                    if (message.content && message.content.boots) {
+                        setBootTrace(message.content);
+                    }
+                    break;
                 case 'log':
                     console.log('Server log:', message.content);
                     break;
@@ -299,7 +338,7 @@ const App = () => {
         } catch (error) {
             console.error('Error parsing WebSocket message:', error);
         }
-    }, [ showStatus, setSettings, settings, setSystemInfo, systemInfo ]);
+    }, [ showStatus, setSettings, settings, setSystemInfo, systemInfo, setBootTrace ]);
 
     const { connected, loading, error, send } = useWebSocket(handleWebSocketMessage);
 
@@ -312,18 +351,26 @@ const App = () => {
         }
     }, [send]);
 
+    const requestBootTrace = React.useCallback(() => {
+        send({
+            type: 'command',
+            command: 'get_boot_trace'
+        });
+    }, [send]);
+
     React.useEffect(() => {
         if (connected) {
             requestSettings();
+            requestBootTrace();
         }
-    }, [connected, requestSettings]);
+    }, [connected, requestSettings, requestBootTrace]);
 
     const saveSettings = () => {
         setConfirmModal({
             isOpen: true,
             config: {
                 title: 'Save Settings',
-                message: 'Do you want to keep WiFi and web stack on after reboot?',
+                message: 'Do you want to keep WiFi and web stack on? Turning them off reboots the device.',
                 showCancel: true,
                 yesClassName: 'neutral',
                 noClassName: 'success',
@@ -333,7 +380,7 @@ const App = () => {
                         command: 'update_settings',
                         content: { ...settings, keepWifi: true }
                     })) {
-                        showStatus('Settings saved. WiFi kept on.', 'success');
+                        showStatus('Saving settings…', 'info');
                     }
                 },
                 onNo: () => {
@@ -550,25 +597,6 @@ const App = () => {
                 <div className="setting-group">
                     <h2>Connectivity</h2>
 
-                    <div className="setting-item">
-                        <div className="setting-title">BLE report rate</div>
-                        <div className="setting-description">
-                            For high speed (polling rate) devices, it is possible to choose higher BLE report rate.
-                            Please note that it is not supported by the BLE standard and may or may not work in your case.
-                            This option will not affect normal speed (125 rps) devices in any way.
-                            The values are calibrated for 1000 Hz USB devices, other rates not supported.
-                            Some modes might work better than others with your device(s).
-                        </div>
-                        <select
-                            value={settings.power.warpSpeed}
-                            onChange={(e) => updateSetting('power', 'warpSpeed', e.target.value)}
-                        >
-                            <option value="slow">±125 rps</option>
-                            <option value="fast">±175 rps</option>
-                            <option value="veryfast">±250 rps</option>
-                        </select>
-                    </div>
-
                     <div className="setting-item">
                         <div className="setting-title">BLE TX power</div>
                         <div className="setting-description">
@@ -761,6 +789,23 @@ const App = () => {
                         </div>
                     </div>
 
+                    <div className="setting-item">
+                        <div className="setting-title">Mouse acceleration</div>
+                        <div className="setting-description">
+                            Extra gain applied to fast movements on top of the sensitivity. Zero disables acceleration.
+                        </div>
+                        <div className="range-container">
+                            <input
+                                type="range"
+                                min="0"
+                                max="200"
+                                value={settings.mouse.acceleration || 0}
+                                onChange={(e) => updateSetting('mouse', 'acceleration', parseInt(e.target.value))}
+                            />
+                            <span className="range-value">{settings.mouse.acceleration || 0}%</span>
+                        </div>
+                    </div>
+
                     <div className="setting-item">
                         <div className="setting-title">Brightness</div>
                         <div className="setting-description">
@@ -791,6 +836,29 @@ const App = () => {
                     </div>
                 </div>
 
+                <div className="setting-group">
+                    <h2>Boot timeline</h2>
+
+                    <div className="setting-item">
+                        <div className="setting-description">
+                            Time since reset at which each startup phase was reached, newest boot first.
+                        </div>
+                        <button onClick={requestBootTrace} disabled={!connected}>
+                            Refresh
+                        </button>
+                    </div>
+
+                    {bootTrace.boots.length === 0 ? (
+                        <div className="setting-item">
+                            <div className="setting-description">No boots recorded yet.</div>
+                        </div>
+                    ) : bootTrace.boots.map((boot, i) => (
+                        <div key={i} className="setting-item">
+                            <BootTimeline phases={bootTrace.phases} boot={boot}/>
+                        </div>
+                    ))}
+                </div>
+
                 <div className="setting-group">
                     <h2>Firmware</h2>
 
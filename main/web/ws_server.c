@@ -9,6 +9,9 @@
 #include "esp_gap_ble_api.h"
 #include "esp_ota_ops.h"
 #include "nvs.h"
+#include "latency.h"
+#include "boot_trace.h"
+#include "reconnect.h"
 
 static const char *WS_TAG = "WS";
 static httpd_handle_t server = NULL;
@@ -252,6 +255,69 @@ esp_err_t init_device_settings(void) {
 //     free(dev_list);
 // }
 
+static void send_latency_stats(void) {
+    latency_stats_t stats;
+    latency_get_stats(&stats);
+
+    char json[320];
+    int len = snprintf(json, sizeof(json), "{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"buckets\":[",
+                       stats.count, stats.p50_us, stats.p99_us, stats.max_us);
+    for (int i = 0; i < LATENCY_BUCKETS && len < sizeof(json); i++) {
+        len += snprintf(json + len, sizeof(json) - len, "%s%lu", i ? "," : "", stats.buckets[i]);
+    }
+    if (len < sizeof(json)) {
+        snprintf(json + len, sizeof(json) - len, "]}");
+        ws_broadcast_json("latency", json);
+    }
+}
+
+static void send_reconnect_stats(void) {
+    reconnect_stats_t stats;
+    reconnect_get_stats(&stats);
+
+    char json[224];
+    snprintf(json, sizeof(json),
+             "{\"attempts\":%lu,\"directed\":%lu,\"undirected\":%lu,\"last\":%lu,\"min\":%lu,\"max\":%lu,"
+             "\"avg\":%lu,\"stage\":%d,\"elapsed\":%lu}",
+             stats.attempts, stats.directed, stats.undirected, stats.last_ms, stats.min_ms, stats.max_ms,
+             stats.avg_ms, stats.stage, stats.elapsed_ms);
+    ws_broadcast_json("reconnect", json);
+}
+
+// Boot timelines, newest first: {"phases":[names],"boots":[{"cause":n,"marks":[us per phase, 0 if not reached]}]}
+static void send_boot_trace(void) {
+    boot_timeline_t timelines[BOOT_TRACE_HISTORY];
+    const size_t count = boot_trace_get(timelines, BOOT_TRACE_HISTORY);
+
+    const size_t size = 64 + BOOT_PHASE_MAX * 24 + BOOT_TRACE_HISTORY * (32 + BOOT_PHASE_MAX * 11);
+    char *json = malloc(size);
+    if (!json) {
+        return;
+    }
+
+    int len = snprintf(json, size, "{\"phases\":[");
+    for (int i = 0; i < BOOT_PHASE_MAX && len < size; i++) {
+        len += snprintf(json + len, size - len, "%s\"%s\"", i ? "," : "", boot_trace_phase_name(i));
+    }
+    if (len < size) {
+        len += snprintf(json + len, size - len, "],\"boots\":[");
+    }
+    for (size_t b = 0; b < count && len < size; b++) {
+        len += snprintf(json + len, size - len, "%s{\"cause\":%lu,\"marks\":[", b ? "," : "", timelines[b].wakeup_cause);
+        for (int i = 0; i < BOOT_PHASE_MAX && len < size; i++) {
+            len += snprintf(json + len, size - len, "%s%lu", i ? "," : "", timelines[b].marks_us[i]);
+        }
+        if (len < size) {
+            len += snprintf(json + len, size - len, "]}");
+        }
+    }
+    if (len < size) {
+        snprintf(json + len, size - len, "]}");
+        ws_broadcast_json("boot_trace", json);
+    }
+    free(json);
+}
+
 static void process_settings_ws_message(const char* message) {
     if (!message) return;
     update_web_access_timestamp();
@@ -290,6 +356,15 @@ static void process_settings_ws_message(const char* message) {
             if (settings) {
                 ws_broadcast_json("settings", settings);
             }
+        } else if (strcmp(command, "get_latency") == 0) {
+            send_latency_stats();
+        } else if (strcmp(command, "get_boot_trace") == 0) {
+            send_boot_trace();
+        } else if (strcmp(command, "get_reconnect_stats") == 0) {
+            send_reconnect_stats();
+        } else if (strcmp(command, "reset_latency") == 0) {
+            latency_reset();
+            send_latency_stats();
         } else if (strcmp(command, "update_settings") == 0) {
             cJSON *content_obj = cJSON_GetObjectItem(root, "content");
             if (!content_obj) {
@@ -305,23 +380,31 @@ static void process_settings_ws_message(const char* message) {
                 return;
             }
 
-            const esp_err_t err = storage_update_settings(new_settings);
+            // Subsystems reapply changed settings live, a reboot is only needed for the device name
+            // or to shut the web stack down (its memory is not reclaimed otherwise)
+            const bool keep_wifi = cJSON_IsTrue(cJSON_GetObjectItem(content_obj, "keepWifi"));
+            bool restart_required = false;
+            const esp_err_t err = storage_update_settings(new_settings, &restart_required);
+            free(new_settings);
+
+            const bool restart = err == ESP_OK && (restart_required || !keep_wifi);
             if (err == ESP_OK) {
-                ws_broadcast_small_json("settings_update_status", "{\"success\":true}");
+                ws_broadcast_small_json("settings_update_status", restart ? "{\"success\":true,\"restart\":true}" : "{\"success\":true,\"restart\":false}");
             } else {
                 char error_msg[64];
                 snprintf(error_msg, sizeof(error_msg), "{\"success\":false,\"error\":\"%s\"}", esp_err_to_name(err));
                 ws_broadcast_json("settings_update_status", error_msg);
             }
-            
-            free(new_settings);
-            if (cJSON_IsTrue(cJSON_GetObjectItem(content_obj, "keepWifi"))) {
-                storage_set_boot_with_wifi();
-            } else {
-                storage_clear_boot_with_wifi();
+
+            if (restart) {
+                if (keep_wifi) {
+                    storage_set_boot_with_wifi();
+                } else {
+                    storage_clear_boot_with_wifi();
+                }
+                vTaskDelay(pdMS_TO_TICKS(250));
+                esp_restart();
             }
-            vTaskDelay(pdMS_TO_TICKS(250));
-            esp_restart();
         }
     }
     
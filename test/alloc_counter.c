@@ -0,0 +1,41 @@
+#include "alloc_counter.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static bool s_counting = false;
+static uint32_t s_calls = 0;
+
+void alloc_counter_start(void) {
+    s_calls = 0;
+    s_counting = true;
+}
+
+uint32_t alloc_counter_stop(void) {
+    s_counting = false;
+    return s_calls;
+}
+
+void *__wrap_malloc(const size_t size) {
+    s_calls += s_counting;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(const size_t count, const size_t size) {
+    s_calls += s_counting;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, const size_t size) {
+    s_calls += s_counting;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+    s_calls += s_counting && ptr;
+    __real_free(ptr);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+// Heap calls made by the code under test, counted through the linker's --wrap of malloc, calloc,
+// realloc and free. Link with the alloc_counter library to get the wrappers.
+
+/**
+ * @brief Start counting from zero
+ */
+void alloc_counter_start(void);
+
+/**
+ * @brief Stop counting
+ * @return Heap calls made since alloc_counter_start()
+ */
+uint32_t alloc_counter_stop(void);
@@ -0,0 +1,133 @@
+// Dispatch cost of a physical input, before and after bindings were compiled when settings load.
+// Before: three sprintf-built settings paths, the settings lookups and execute_action_from_string()
+// classifying the strings. After: an array index and execute_compiled_action(). Both end in the same
+// HID sends and release scheduling, checked through the fake HID profile.
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "idf_fakes.h"
+#include "hid_actions.h"
+
+#define ROUNDS 200000
+
+typedef struct {
+    const char *type;
+    const char *action;
+    const char *mods[2];
+    int mod_count;
+} binding_t;
+
+// Button 0..5 bindings as set from the web UI
+static binding_t s_bindings[] = {
+    {"keyboard_key", "KC_HOME"},
+    {"keyboard_combo", "KC_C", {"Ctrl", "Shift"}, 2},
+    {"consumer_control", "KC_AUDIO_VOL_UP"},
+    {"mouse_button", "KC_MS_BTN4"},
+    {"", "KC_MEDIA_PLAY_PAUSE"},
+    {"", "KC_MS_WH_UP"},
+};
+#define NUM_BINDINGS (sizeof(s_bindings) / sizeof(s_bindings[0]))
+
+// Stand-in for storage_get_string_setting(): a flat key/value lookup. The real one walks the
+// settings JSON, so this only gives a lower bound for the old path.
+typedef struct {
+    char key[32];
+    const char *value;
+} setting_t;
+
+static setting_t s_settings[NUM_BINDINGS * 3];
+
+static const char *get_setting(const char *key) {
+    for (size_t i = 0; i < sizeof(s_settings) / sizeof(s_settings[0]); i++) {
+        if (strcmp(s_settings[i].key, key) == 0) {
+            return s_settings[i].value;
+        }
+    }
+    return NULL;
+}
+
+static void load_settings(void) {
+    for (size_t i = 0; i < NUM_BINDINGS; i++) {
+        snprintf(s_settings[i * 3].key, sizeof(s_settings[0].key), "buttons.keys[%d].acType", (int)i);
+        s_settings[i * 3].value = s_bindings[i].type;
+        snprintf(s_settings[i * 3 + 1].key, sizeof(s_settings[0].key), "buttons.keys[%d].action", (int)i);
+        s_settings[i * 3 + 1].value = s_bindings[i].action;
+        snprintf(s_settings[i * 3 + 2].key, sizeof(s_settings[0].key), "buttons.keys[%d].mods", (int)i);
+        s_settings[i * 3 + 2].value = "";
+    }
+}
+
+// The click path before the compiled table, minus logging
+static void dispatch_from_strings(const uint8_t button) {
+    char type_path[32];
+    char action_path[32];
+    char mods_path[32];
+    sprintf(type_path, "buttons.%s[%d].acType", "keys", button);
+    sprintf(action_path, "buttons.%s[%d].action", "keys", button);
+
+    const char *type = get_setting(type_path);
+    const char *action = get_setting(action_path);
+    if (!type || !action) {
+        return;
+    }
+    if (strcmp(type, "keyboard_combo") == 0) {
+        sprintf(mods_path, "buttons.%s[%d].mods", "keys", button);
+        get_setting(mods_path);
+    }
+    execute_action_from_string(0, type, action, s_bindings[button].mods, s_bindings[button].mod_count);
+}
+
+static compiled_action_t s_compiled[NUM_BINDINGS];
+
+static void dispatch_compiled(const uint8_t button) {
+    execute_compiled_action(0, &s_compiled[button]);
+}
+
+static double time_dispatch(void (*dispatch)(uint8_t)) {
+    const double start = now_ns();
+    for (int round = 0; round < ROUNDS; round++) {
+        dispatch(round % NUM_BINDINGS);
+    }
+    return (now_ns() - start) / ROUNDS;
+}
+
+// HID sends of one press per binding, releases included
+static fake_hidd_counts_t run_once(void (*dispatch)(uint8_t)) {
+    const fake_hidd_counts_t before = *fake_hidd_counts();
+    for (uint8_t i = 0; i < NUM_BINDINGS; i++) {
+        dispatch(i);
+        fake_time_advance(20000);
+    }
+    const fake_hidd_counts_t *after = fake_hidd_counts();
+    return (fake_hidd_counts_t){
+        .keyboard = after->keyboard - before.keyboard,
+        .mouse = after->mouse - before.mouse,
+        .system = after->system - before.system,
+        .consumer = after->consumer - before.consumer,
+        .releases = after->releases - before.releases,
+    };
+}
+
+int main(void) {
+    fake_reset();
+    CHECK_EQ(hid_actions_init(), ESP_OK);
+    load_settings();
+    for (size_t i = 0; i < NUM_BINDINGS; i++) {
+        CHECK(compile_action(s_bindings[i].type, s_bindings[i].action, s_bindings[i].mods, s_bindings[i].mod_count,
+                             &s_compiled[i]));
+    }
+
+    // Both paths send the same reports, releases included
+    const fake_hidd_counts_t strings = run_once(dispatch_from_strings);
+    const fake_hidd_counts_t compiled = run_once(dispatch_compiled);
+    CHECK(memcmp(&strings, &compiled, sizeof(strings)) == 0);
+    CHECK_EQ(compiled.releases, 5); // the wheel step has nothing to release
+
+    // Both include the same sends and release scheduling, the difference is the dispatch itself
+    const double strings_ns = time_dispatch(dispatch_from_strings);
+    const double compiled_ns = time_dispatch(dispatch_compiled);
+    printf("dispatch from strings %7.1f ns/input, compiled %7.1f ns/input (%.1fx), HID sends included\n", strings_ns,
+           compiled_ns, strings_ns / compiled_ns);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Compares the compiled extraction plan with the generic bit-by-bit extractor on the corpus
+// descriptors: every field must decode identically, then both are timed in ns/report.
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "descriptor_dump.h"
+#include "descriptor_parser.h"
+
+#define MAX_DESCRIPTOR 4096
+#define REPORTS 256
+#define ROUNDS 2000
+#define MAX_REPORT_BYTES 64
+#define MAX_FIELDS 256
+
+static uint8_t s_reports[REPORTS][MAX_REPORT_BYTES];
+
+// What process_report() did before the plan: one generic call per field
+static void extract_generic(const uint8_t *data, const report_info_t *report, int64_t *values) {
+    for (int i = 0; i < report->num_fields; i++) {
+        values[i] = extract_field_value(data, report->bit_offsets[i], report->bit_sizes[i]);
+    }
+}
+
+static double time_extractor(void (*extract)(const uint8_t *, const report_info_t *, int64_t *),
+                             const report_info_t *report, int64_t *values) {
+    volatile int64_t sink = 0;
+    const double start = now_ns();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int r = 0; r < REPORTS; r++) {
+            extract(s_reports[r], report, values);
+            sink += values[report->num_fields - 1];
+        }
+    }
+    (void)sink;
+    return (now_ns() - start) / ((double)ROUNDS * REPORTS);
+}
+
+static void bench_descriptor(const char *path) {
+    static uint8_t desc[MAX_DESCRIPTOR];
+    const long length = read_hex_file(path, desc, sizeof(desc));
+    CHECK(length >= 0);
+
+    report_map_t map = {0};
+    CHECK_EQ(parse_report_descriptor(desc, length, 0, &map), ESP_OK);
+
+    uint32_t seed = 0xC0FFEE;
+    for (int r = 0; r < REPORTS; r++) {
+        for (int b = 0; b < MAX_REPORT_BYTES; b++) {
+            s_reports[r][b] = test_rand(&seed);
+        }
+    }
+
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    for (int i = 0; i < map.num_reports; i++) {
+        const report_info_t *report = &map.reports[i];
+        if (report->num_fields == 0 || report->num_fields > MAX_FIELDS) {
+            continue;
+        }
+        CHECK((report->total_bits + 7) / 8 <= MAX_REPORT_BYTES);
+
+        int64_t planned[MAX_FIELDS];
+        int64_t generic[MAX_FIELDS];
+        for (int r = 0; r < REPORTS; r++) {
+            extract_report_fields(s_reports[r], report, planned);
+            extract_generic(s_reports[r], report, generic);
+            for (int f = 0; f < report->num_fields; f++) {
+                if (report->plan[f].op == FIELD_OP_SKIP) {
+                    // Constant fields are never read, their value is 0 by definition
+                    CHECK_EQ(planned[f], 0);
+                    continue;
+                }
+                if (report->plan[f].op == FIELD_OP_BITMAP) {
+                    // Bitmaps are unsigned, the generic path sign-extends the top bit
+                    generic[f] &= report->plan[f].mask;
+                }
+                if (planned[f] != generic[f]) {
+                    fprintf(stderr, "%s id %d field %d (offset %d size %d): plan %lld, generic %lld\n", name,
+                            map.report_ids[i], f, report->bit_offsets[f], report->bit_sizes[f],
+                            (long long)planned[f], (long long)generic[f]);
+                    exit(1);
+                }
+            }
+        }
+
+        const double generic_ns = time_extractor(extract_generic, report, generic);
+        const double plan_ns = time_extractor(extract_report_fields, report, planned);
+        printf("%-24s id %3d %3d fields %4d bits  generic %7.1f ns/report  plan %7.1f ns/report  %.1fx\n", name,
+               map.report_ids[i], report->num_fields, report->total_bits, generic_ns, plan_ns, generic_ns / plan_ns);
+    }
+    report_map_free(&map);
+}
+
+int main(const int argc, char **argv) {
+    CHECK(argc > 1);
+    for (int i = 1; i < argc; i++) {
+        bench_descriptor(argv[i]);
+    }
+    return 0;
+}
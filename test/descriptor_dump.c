@@ -0,0 +1,79 @@
+#include "descriptor_dump.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+long read_hex_file(const char *path, uint8_t *out, const size_t capacity) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    long length = 0;
+    int c;
+    int nibbles = 0;
+    uint8_t byte = 0;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') {
+                c = fgetc(file);
+            }
+            continue;
+        }
+        if (!isxdigit(c)) {
+            continue;
+        }
+
+        byte = byte << 4 | (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+        if (++nibbles == 2) {
+            if ((size_t)length >= capacity) {
+                fclose(file);
+                return -1;
+            }
+            out[length++] = byte;
+            nibbles = 0;
+            byte = 0;
+        }
+    }
+    fclose(file);
+    return nibbles ? -1 : length;
+}
+
+static const char *op_name(const uint8_t op) {
+    static const char *names[] = {"generic", "skip", "s8", "s16", "s32", "bytes", "packed", "bitmap"};
+    return op < sizeof(names) / sizeof(names[0]) ? names[op] : "?";
+}
+
+static const char *dst_name(const uint8_t dst) {
+    static const char *names[] = {"x", "y", "wheel", "pan", "buttons", "consumer", "system"};
+    return dst < sizeof(names) / sizeof(names[0]) ? names[dst] : "?";
+}
+
+static const char *transform_name(const uint8_t transform) {
+    static const char *names[] = {"value", "bitmap", "flags", "array"};
+    return transform < sizeof(names) / sizeof(names[0]) ? names[transform] : "?";
+}
+
+void dump_report_map(const report_map_t *map, FILE *out) {
+    fprintf(out, "reports %u report_ids %d\n", map->num_reports, map->has_report_ids);
+    for (int i = 0; i < map->num_reports; i++) {
+        const report_info_t *report = &map->reports[i];
+        fprintf(out, "report %u bits %u fields %u keyboard %d\n", map->report_ids[i], report->total_bits,
+                report->num_fields, report->is_keyboard);
+
+        for (int j = 0; j < report->num_fields; j++) {
+            const usb_hid_field_attr_t *attr = &report->attrs[j];
+            fprintf(out, "  field %d page 0x%02x usage 0x%02x-0x%02x size %u count %u logical %d..%d %s%s%s%s"
+                         "offset %u bits %u op %s\n",
+                    j, attr->usage_page, attr->usage, attr->usage_maximum, attr->report_size, attr->report_count,
+                    attr->logical_min, attr->logical_max, attr->constant ? "const " : "",
+                    attr->variable ? "var " : "", attr->relative ? "rel " : "", attr->array ? "array " : "",
+                    report->bit_offsets[j], report->bit_sizes[j], op_name(report->plan[j].op));
+        }
+
+        for (int k = 0; k < report->num_routes; k++) {
+            const usage_route_t *route = &report->routes[k];
+            fprintf(out, "  route field %u -> %s %s base %ld\n", route->field, dst_name(route->dst),
+                    transform_name(route->transform), (long)route->base);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "hid_bridge.h"
+
+/**
+ * @brief Read a corpus file: hex bytes separated by whitespace, '#' starts a comment
+ * @param path File path
+ * @param out Output buffer
+ * @param capacity Size of out
+ * @return Number of bytes read, or -1 if the file can't be read or doesn't fit
+ */
+long read_hex_file(const char *path, uint8_t *out, size_t capacity);
+
+/**
+ * @brief Print a parsed report map in the format of the golden files
+ * @param map Report map
+ * @param out Output stream
+ */
+void dump_report_map(const report_map_t *map, FILE *out);
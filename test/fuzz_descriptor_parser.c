@@ -0,0 +1,39 @@
+// libFuzzer target: any byte string is a descriptor. ASan catches reads outside desc, the checks
+// below catch a runtime map that doesn't hold together.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "descriptor_parser.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // Copy so the parser can't rely on anything past size
+    uint8_t *desc = malloc(size ? size : 1);
+    for (size_t i = 0; i < size; i++) {
+        desc[i] = data[i];
+    }
+
+    report_map_t map = {0};
+    if (parse_report_descriptor(desc, size, 0, &map) == ESP_OK) {
+        uint8_t report[64] = {0};
+        for (int i = 0; i < map.num_reports; i++) {
+            const report_info_t *info = &map.reports[i];
+            for (int j = 0; j < info->num_fields; j++) {
+                if (info->bit_offsets[j] + info->bit_sizes[j] > info->total_bits) {
+                    abort();
+                }
+            }
+            for (int k = 0; k < info->num_routes; k++) {
+                if (info->routes[k].field >= info->num_fields) {
+                    abort();
+                }
+            }
+            if ((info->total_bits + 7) / 8 <= sizeof(report)) {
+                extract_report_fields(report, info, info->values);
+            }
+        }
+    }
+    report_map_free(&map);
+    free(desc);
+    return 0;
+}
@@ -0,0 +1,43 @@
+// Runs the fuzz target over given files (corpus .hex files are decoded) and a fixed number of
+// pseudo-random descriptors, for compilers without libFuzzer
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "descriptor_dump.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define RANDOM_RUNS 20000
+#define MAX_INPUT 4096
+
+// Mostly valid item prefixes, so the parser gets past the first few bytes
+static size_t random_descriptor(uint32_t *seed, uint8_t *out, const size_t capacity) {
+    static const uint8_t prefixes[] = {0x05, 0x09, 0x19, 0x29, 0x15, 0x25, 0x75, 0x95, 0x81, 0xA1, 0xC0,
+                                       0x85, 0xA4, 0xB4, 0xA9, 0x0B, 0x1B, 0x27, 0x17, 0xFE, 0x55, 0x65};
+    const size_t length = test_rand(seed) % capacity;
+    for (size_t i = 0; i < length; i++) {
+        out[i] = test_rand(seed) % 3 ? prefixes[test_rand(seed) % sizeof(prefixes)] : test_rand(seed);
+    }
+    return length;
+}
+
+int main(const int argc, char **argv) {
+    static uint8_t input[MAX_INPUT];
+
+    for (int i = 1; i < argc; i++) {
+        const long length = read_hex_file(argv[i], input, sizeof(input));
+        CHECK(length >= 0);
+        for (long cut = 0; cut <= length; cut++) {
+            LLVMFuzzerTestOneInput(input, cut);
+        }
+    }
+
+    uint32_t seed = 0x1234567;
+    for (int run = 0; run < RANDOM_RUNS; run++) {
+        LLVMFuzzerTestOneInput(input, random_descriptor(&seed, input, 512));
+    }
+
+    printf("%d files, %d random descriptors\n", argc - 1, RANDOM_RUNS);
+    return 0;
+}
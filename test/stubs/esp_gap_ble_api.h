@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+typedef struct {
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_ble_conn_update_params_t;
+
+// Forwarded to the hook installed with fake_gap_set_update_hook()
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params);
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef uint8_t esp_gatt_if_t;
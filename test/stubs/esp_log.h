@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdarg.h>
+#include "esp_attr.h"
+
+// Silent unless TEST_LOG is set in the environment, the fuzz and stress runs log a lot
+void fake_log(char level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) fake_log('E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fake_log('W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fake_log('I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) fake_log('D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) fake_log('V', tag, format, ##__VA_ARGS__)
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_attr.h"
+
+// The tested modules only need critical sections and tick types. Tests that touch the same
+// module from several threads synchronise themselves, so critical sections are no-ops. Includes
+// what the IDF headers pull in on the target.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define taskENTER_CRITICAL(mux) ((void)(mux))
+#define taskEXIT_CRITICAL(mux) ((void)(mux))
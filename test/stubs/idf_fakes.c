@@ -0,0 +1,296 @@
+#include "idf_fakes.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "esp_hidd_prf_api.h"
+
+#define FAKE_TIMERS 16
+#define FAKE_NVS_ENTRIES 64
+#define FAKE_NVS_KEY_LEN 32
+
+struct fake_timer {
+    bool used;
+    bool active;
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t deadline_us;
+    uint64_t period_us; // 0 for one-shot
+};
+
+typedef struct {
+    bool used;
+    char name[FAKE_NVS_KEY_LEN];
+    char key[FAKE_NVS_KEY_LEN];
+    uint8_t *value;
+    size_t length;
+} fake_nvs_entry_t;
+
+static int64_t s_now_us = 0;
+static struct fake_timer s_timers[FAKE_TIMERS];
+static fake_nvs_entry_t s_nvs[FAKE_NVS_ENTRIES];
+static const char *s_nvs_names[8];
+static fake_hidd_counts_t s_hidd;
+static fake_gap_update_hook_t s_gap_hook = NULL;
+
+void fake_log(const char level, const char *tag, const char *format, ...) {
+    static int enabled = -1;
+    if (enabled < 0) {
+        enabled = getenv("TEST_LOG") != NULL;
+    }
+    if (!enabled) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", level, tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(const esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+void fake_reset(void) {
+    s_now_us = 0;
+    memset(s_timers, 0, sizeof(s_timers));
+    for (int i = 0; i < FAKE_NVS_ENTRIES; i++) {
+        free(s_nvs[i].value);
+    }
+    memset(s_nvs, 0, sizeof(s_nvs));
+    memset(&s_hidd, 0, sizeof(s_hidd));
+    s_gap_hook = NULL;
+}
+
+// Timers
+
+void fake_time_set(const int64_t now_us) {
+    s_now_us = now_us;
+}
+
+void fake_time_advance(const int64_t delta_us) {
+    const int64_t target = s_now_us + delta_us;
+    while (1) {
+        struct fake_timer *next = NULL;
+        for (int i = 0; i < FAKE_TIMERS; i++) {
+            if (s_timers[i].used && s_timers[i].active && s_timers[i].deadline_us <= target &&
+                (next == NULL || s_timers[i].deadline_us < next->deadline_us)) {
+                next = &s_timers[i];
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+
+        if (next->deadline_us > s_now_us) {
+            s_now_us = next->deadline_us;
+        }
+        if (next->period_us) {
+            next->deadline_us += next->period_us;
+        } else {
+            next->active = false;
+        }
+        next->callback(next->arg);
+    }
+    s_now_us = target;
+}
+
+int64_t esp_timer_get_time(void) {
+    return s_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    for (int i = 0; i < FAKE_TIMERS; i++) {
+        if (!s_timers[i].used) {
+            memset(&s_timers[i], 0, sizeof(s_timers[i]));
+            s_timers[i].used = true;
+            s_timers[i].callback = create_args->callback;
+            s_timers[i].arg = create_args->arg;
+            *out_handle = &s_timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, const uint64_t timeout_us) {
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->period_us = 0;
+    timer->deadline_us = s_now_us + timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, const uint64_t period) {
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->period_us = period;
+    timer->deadline_us = s_now_us + period;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    timer->used = false;
+    timer->active = false;
+    return ESP_OK;
+}
+
+int fake_timers_in_use(void) {
+    int count = 0;
+    for (int i = 0; i < FAKE_TIMERS; i++) {
+        count += s_timers[i].used;
+    }
+    return count;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timer->active;
+}
+
+// NVS, handles index s_nvs_names
+
+static fake_nvs_entry_t *nvs_find(const nvs_handle_t handle, const char *key) {
+    for (int i = 0; i < FAKE_NVS_ENTRIES; i++) {
+        if (s_nvs[i].used && strcmp(s_nvs[i].name, s_nvs_names[handle]) == 0 && strcmp(s_nvs[i].key, key) == 0) {
+            return &s_nvs[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *name, const nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    bool exists = false;
+    for (int i = 0; i < FAKE_NVS_ENTRIES; i++) {
+        exists |= s_nvs[i].used && strcmp(s_nvs[i].name, name) == 0;
+    }
+    if (!exists && open_mode == NVS_READONLY) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    for (nvs_handle_t i = 0; i < sizeof(s_nvs_names) / sizeof(s_nvs_names[0]); i++) {
+        if (s_nvs_names[i] == NULL || strcmp(s_nvs_names[i], name) == 0) {
+            s_nvs_names[i] = name;
+            *out_handle = i;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(const nvs_handle_t handle) {
+    (void)handle;
+}
+
+esp_err_t nvs_commit(const nvs_handle_t handle) {
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(const nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    const fake_nvs_entry_t *entry = nvs_find(handle, key);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value != NULL) {
+        if (*length < entry->length) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(out_value, entry->value, entry->length);
+    }
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(const nvs_handle_t handle, const char *key, const void *value, const size_t length) {
+    fake_nvs_entry_t *entry = nvs_find(handle, key);
+    for (int i = 0; entry == NULL && i < FAKE_NVS_ENTRIES; i++) {
+        if (!s_nvs[i].used) {
+            entry = &s_nvs[i];
+            entry->used = true;
+            snprintf(entry->name, sizeof(entry->name), "%s", s_nvs_names[handle]);
+            snprintf(entry->key, sizeof(entry->key), "%s", key);
+        }
+    }
+    if (entry == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    free(entry->value);
+    entry->value = malloc(length ? length : 1);
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    return ESP_OK;
+}
+
+// BLE
+
+void fake_gap_set_update_hook(const fake_gap_update_hook_t hook) {
+    s_gap_hook = hook;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params) {
+    return s_gap_hook ? s_gap_hook(params) : ESP_OK;
+}
+
+const fake_hidd_counts_t *fake_hidd_counts(void) {
+    return &s_hidd;
+}
+
+void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, const uint8_t *keyboard_cmd) {
+    static const uint8_t no_keys[6] = {0};
+    s_hidd.keyboard++;
+    if (special_key_mask == 0 && memcmp(keyboard_cmd, no_keys, sizeof(no_keys)) == 0) {
+        s_hidd.releases++;
+    }
+}
+
+void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, uint16_t mickeys_x, uint16_t mickeys_y,
+                               int8_t wheel, int8_t pan) {
+    s_hidd.mouse++;
+    if (mouse_button == 0 && mickeys_x == 0 && mickeys_y == 0 && wheel == 0 && pan == 0) {
+        s_hidd.releases++;
+    }
+}
+
+void esp_hidd_send_system_control_value(uint16_t conn_id, uint16_t sys_ctrl) {
+    s_hidd.system++;
+    if (sys_ctrl == 0) {
+        s_hidd.releases++;
+    }
+}
+
+void esp_hidd_send_consumer_value(uint16_t conn_id, uint16_t consumer_control) {
+    s_hidd.consumer++;
+    if (consumer_control == 0) {
+        s_hidd.releases++;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_gap_ble_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set the fake clock, without firing timers
+ * @param now_us New time
+ */
+void fake_time_set(int64_t now_us);
+
+/**
+ * @brief Move the fake clock forward, firing every timer that comes due in deadline order
+ * @param delta_us Time to advance
+ */
+void fake_time_advance(int64_t delta_us);
+
+/**
+ * @brief Count the timers created and not deleted
+ * @return Number of live timers
+ */
+int fake_timers_in_use(void);
+
+/**
+ * @brief Drop every timer and NVS entry and reset the clock and the HID recorder
+ */
+void fake_reset(void);
+
+// What the HID profile was asked to send, see esp_hidd_prf_api.h
+typedef struct {
+    uint32_t keyboard;
+    uint32_t mouse;
+    uint32_t system;
+    uint32_t consumer;
+    uint32_t releases; // sends with an all-zero payload
+} fake_hidd_counts_t;
+
+/**
+ * @brief Get the HID send counters
+ * @return Counters since the last fake_reset()
+ */
+const fake_hidd_counts_t *fake_hidd_counts(void);
+
+typedef esp_err_t (*fake_gap_update_hook_t)(const esp_ble_conn_update_params_t *params);
+
+/**
+ * @brief Route esp_ble_gap_update_conn_params() to a test, NULL accepts silently
+ * @param hook Hook
+ */
+void fake_gap_set_update_hook(fake_gap_update_hook_t hook);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+// Only the handle and event types hid_bridge.h refers to
+
+typedef struct hid_interface *hid_host_device_handle_t;
+
+typedef enum {
+    HID_HOST_DRIVER_EVENT_CONNECTED = 0,
+} hid_host_driver_event_t;
+
+typedef enum {
+    HID_HOST_INTERFACE_EVENT_INPUT_REPORT = 0,
+    HID_HOST_INTERFACE_EVENT_DISCONNECTED,
+    HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR,
+} hid_host_interface_event_t;
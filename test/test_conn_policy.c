@@ -0,0 +1,339 @@
+// Simulates the connection parameter policy against usage traces on the fake clock: the evaluation
+// timer runs as on the target, requested parameters reach a modelled central through the GAP hook and
+// its answer comes back as ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT 100 ms later. Checks how fast the link
+// speeds up, that it only relaxes one tier at a time after sustained quiet, and the reject backoff.
+// Prints an estimate of radio-on time against the old fixed 7.5 ms / latency 0 parameters.
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "idf_fakes.h"
+#include "esp_timer.h"
+#include "conn_policy.h"
+
+#define RESPONSE_DELAY_US 100000
+#define WINDOW_US 500000          // POLICY_WINDOW_MS
+#define RELAX_US (6 * WINDOW_US)  // RELAX_WINDOWS
+#define REJECT_BACKOFF_US 10000000
+#define MAX_REQUESTS 64
+
+// Radio-on model per attended connection event: an empty exchange, plus airtime per notification
+#define EVENT_BASE_US 250
+#define EVENT_PER_REPORT_US 120
+
+typedef enum {
+    CENTRAL_ACCEPT,      // picks the lowest interval of the requested range
+    CENTRAL_REJECT,      // refuses every update
+    CENTRAL_KEEP_FAST,   // reports success but keeps 7.5 ms
+    CENTRAL_SILENT,      // never answers
+} central_t;
+
+typedef struct {
+    int64_t at_us;
+    esp_ble_conn_update_params_t params;
+} request_t;
+
+static struct {
+    central_t central;
+    request_t requests[MAX_REQUESTS];
+    int num_requests;
+    bool answer_pending;
+    int64_t answer_at_us;
+    bool answer_success;
+    uint16_t answer_interval;
+    uint16_t answer_latency;
+    // Parameters the link runs with
+    uint16_t interval;
+    uint16_t latency;
+} s_sim;
+
+static esp_err_t gap_update_hook(const esp_ble_conn_update_params_t *params) {
+    CHECK(s_sim.num_requests < MAX_REQUESTS);
+    s_sim.requests[s_sim.num_requests++] = (request_t){.at_us = esp_timer_get_time(), .params = *params};
+    CHECK(params->min_int <= params->max_int);
+
+    if (s_sim.central == CENTRAL_SILENT) {
+        return ESP_OK;
+    }
+    s_sim.answer_pending = true;
+    s_sim.answer_at_us = esp_timer_get_time() + RESPONSE_DELAY_US;
+    s_sim.answer_success = s_sim.central != CENTRAL_REJECT;
+    s_sim.answer_interval = s_sim.central == CENTRAL_KEEP_FAST ? 0x06 : params->min_int;
+    s_sim.answer_latency = s_sim.central == CENTRAL_KEEP_FAST ? 0 : params->latency;
+    return ESP_OK;
+}
+
+// Reports forwarded in one millisecond of a trace
+typedef uint32_t (*trace_fn_t)(int64_t ms, bool *is_mouse);
+
+// Gaming: 1000 Hz motion, short pauses between engagements, a 20 s break in the middle
+static uint32_t trace_gaming(const int64_t ms, bool *is_mouse) {
+    *is_mouse = true;
+    const int64_t s = ms / 1000;
+    if (s >= 60 && s < 80) {
+        return 0;
+    }
+    return ms % 4000 < 3300 ? 1 : 0;
+}
+
+// Typing: ~6 keys/s (press + release reports) in sentences, pauses of 1-2 s between them
+static uint32_t trace_typing(const int64_t ms, bool *is_mouse) {
+    *is_mouse = false;
+    const int64_t phase = ms % 9000;
+    if (phase < 7000) {
+        return ms % 166 == 0 || ms % 166 == 60 ? 1 : 0;
+    }
+    return 0;
+}
+
+// Office: typing with a mouse reach every 20 s
+static uint32_t trace_office(const int64_t ms, bool *is_mouse) {
+    if (ms % 20000 < 1500) {
+        *is_mouse = true;
+        return ms % 8 == 0 ? 1 : 0; // 125 Hz office mouse
+    }
+    return trace_typing(ms, is_mouse);
+}
+
+// Reading: a key every 8 s
+static uint32_t trace_idle(const int64_t ms, bool *is_mouse) {
+    *is_mouse = false;
+    return ms % 8000 == 0 ? 1 : 0;
+}
+
+typedef struct {
+    int64_t radio_on_us;
+    int64_t baseline_on_us;
+    int64_t time_in_tier_us[CONN_TIER_MAX];
+    int64_t slow_motion_us; // longest run of pointer motion forwarded on a slower tier than fast
+    int64_t reports;
+} sim_result_t;
+
+typedef struct {
+    uint32_t queued;         // reports waiting for a connection event
+    int64_t next_event_us;
+    uint16_t skipped;        // events skipped in a row under slave latency
+} radio_t;
+
+// Attends the connection events up to now: always when there is data, otherwise at least every latency + 1
+static int64_t run_radio(radio_t *radio, const int64_t now, const uint16_t interval, const uint16_t latency) {
+    int64_t on_us = 0;
+    while (radio->next_event_us <= now) {
+        if (radio->queued > 0 || radio->skipped >= latency) {
+            on_us += EVENT_BASE_US + radio->queued * EVENT_PER_REPORT_US;
+            radio->queued = 0;
+            radio->skipped = 0;
+        } else {
+            radio->skipped++;
+        }
+        radio->next_event_us += interval * 1250;
+    }
+    return on_us;
+}
+
+static sim_result_t simulate(const trace_fn_t trace, const int64_t duration_ms, const central_t central) {
+    fake_reset();
+    fake_time_set(1000000);
+    memset(&s_sim, 0, sizeof(s_sim));
+    s_sim.central = central;
+    s_sim.interval = 0x06;
+    s_sim.latency = 0;
+    fake_gap_set_update_hook(gap_update_hook);
+    CHECK_EQ(conn_policy_init(), ESP_OK);
+
+    static const esp_bd_addr_t peer = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    conn_policy_on_connect(peer);
+    // The profile requests the connect-time parameters itself
+    conn_policy_on_params_updated(true, 0x06);
+
+    sim_result_t result = {0};
+    int64_t slow_motion_since = -1;
+    radio_t radio = {.next_event_us = esp_timer_get_time()};
+    radio_t baseline = {.next_event_us = esp_timer_get_time()};
+    for (int64_t ms = 0; ms < duration_ms; ms++) {
+        bool is_mouse = false;
+        const uint32_t reports = trace(ms, &is_mouse);
+        for (uint32_t i = 0; i < reports; i++) {
+            conn_policy_record_report(is_mouse);
+        }
+        radio.queued += reports;
+        baseline.queued += reports;
+        result.reports += reports;
+
+        fake_time_advance(1000);
+        const int64_t now = esp_timer_get_time();
+
+        if (s_sim.answer_pending && now >= s_sim.answer_at_us) {
+            s_sim.answer_pending = false;
+            if (s_sim.answer_success) {
+                s_sim.interval = s_sim.answer_interval;
+                s_sim.latency = s_sim.answer_latency;
+            }
+            conn_policy_on_params_updated(s_sim.answer_success, s_sim.interval);
+        }
+
+        result.radio_on_us += run_radio(&radio, now, s_sim.interval, s_sim.latency);
+        result.baseline_on_us += run_radio(&baseline, now, 0x06, 0);
+        result.time_in_tier_us[conn_policy_tier()] += 1000;
+        if (is_mouse && reports && conn_policy_tier() != CONN_TIER_FAST) {
+            if (slow_motion_since < 0) {
+                slow_motion_since = now;
+            }
+            if (now - slow_motion_since > result.slow_motion_us) {
+                result.slow_motion_us = now - slow_motion_since;
+            }
+        } else if (conn_policy_tier() == CONN_TIER_FAST) {
+            slow_motion_since = -1;
+        }
+    }
+
+    conn_policy_deinit();
+    return result;
+}
+
+static void print_result(const char *name, const sim_result_t *r, const int64_t duration_ms) {
+    const double total = duration_ms * 1000.0;
+    printf("%-7s %3d requests  fast %5.1f%% normal %5.1f%% relaxed %5.1f%% idle %5.1f%%  radio on %5.2f%% "
+           "(fixed 7.5 ms: %5.2f%%)\n",
+           name, s_sim.num_requests, 100 * r->time_in_tier_us[CONN_TIER_FAST] / total,
+           100 * r->time_in_tier_us[CONN_TIER_NORMAL] / total, 100 * r->time_in_tier_us[CONN_TIER_RELAXED] / total,
+           100 * r->time_in_tier_us[CONN_TIER_IDLE] / total, 100 * r->radio_on_us / total,
+           100 * r->baseline_on_us / total);
+}
+
+static conn_tier_t tier_of_request(const request_t *request) {
+    if (request->params.max_int <= 0x06) return CONN_TIER_FAST;
+    if (request->params.max_int <= 0x0C) return CONN_TIER_NORMAL;
+    if (request->params.max_int <= 0x24) return CONN_TIER_RELAXED;
+    return CONN_TIER_IDLE;
+}
+
+// Slower tiers are only requested one step at a time, after sustained quiet since the last change
+static void check_relax_steps(void) {
+    conn_tier_t tier = CONN_TIER_FAST;
+    int64_t last_change = 0;
+    for (int i = 0; i < s_sim.num_requests; i++) {
+        const conn_tier_t requested = tier_of_request(&s_sim.requests[i]);
+        if (requested > tier) {
+            CHECK_EQ(requested, tier + 1);
+            CHECK(i == 0 || s_sim.requests[i].at_us - last_change >= RELAX_US);
+        }
+        tier = requested;
+        last_change = s_sim.requests[i].at_us;
+    }
+}
+
+static void test_gaming(void) {
+    const int64_t duration_ms = 120000;
+    const sim_result_t r = simulate(trace_gaming, duration_ms, CENTRAL_ACCEPT);
+    print_result("gaming", &r, duration_ms);
+    check_relax_steps();
+
+    // Coming back from the break, motion runs on the relaxed link for at most one window plus the answer
+    CHECK(r.slow_motion_us > 0);
+    CHECK(r.slow_motion_us <= WINDOW_US + RESPONSE_DELAY_US);
+    CHECK(r.time_in_tier_us[CONN_TIER_FAST] > 0.8 * duration_ms * 1000);
+    // Short pauses between engagements don't relax the link, only the 20 s break does: two steps down, one up
+    CHECK_EQ(s_sim.num_requests, 3);
+    CHECK_EQ(tier_of_request(&s_sim.requests[2]), CONN_TIER_FAST);
+}
+
+static void test_typing(void) {
+    const int64_t duration_ms = 120000;
+    const sim_result_t r = simulate(trace_typing, duration_ms, CENTRAL_ACCEPT);
+    print_result("typing", &r, duration_ms);
+    check_relax_steps();
+
+    for (int i = 0; i < s_sim.num_requests; i++) {
+        CHECK(tier_of_request(&s_sim.requests[i]) != CONN_TIER_FAST);
+    }
+    // Pauses between sentences are shorter than the relax time: settles on normal and stays there
+    CHECK(r.time_in_tier_us[CONN_TIER_NORMAL] > 0.9 * duration_ms * 1000);
+    CHECK(s_sim.num_requests <= 2);
+    CHECK(r.radio_on_us < r.baseline_on_us / 2);
+}
+
+static void test_office(void) {
+    const int64_t duration_ms = 120000;
+    const sim_result_t r = simulate(trace_office, duration_ms, CENTRAL_ACCEPT);
+    print_result("office", &r, duration_ms);
+    check_relax_steps();
+    CHECK(r.radio_on_us < r.baseline_on_us);
+}
+
+static void test_idle(void) {
+    const int64_t duration_ms = 120000;
+    const sim_result_t r = simulate(trace_idle, duration_ms, CENTRAL_ACCEPT);
+    print_result("idle", &r, duration_ms);
+    check_relax_steps();
+
+    // fast -> normal -> relaxed, the idle tier is left to the inactivity handling
+    CHECK_EQ(s_sim.num_requests, 2);
+    CHECK_EQ(tier_of_request(&s_sim.requests[1]), CONN_TIER_RELAXED);
+    CHECK_EQ(conn_policy_tier(), CONN_TIER_RELAXED);
+    CHECK(r.radio_on_us < r.baseline_on_us / 4);
+}
+
+static void test_rejecting_central(void) {
+    const int64_t duration_ms = 60000;
+    simulate(trace_idle, duration_ms, CENTRAL_REJECT);
+    CHECK(s_sim.num_requests >= 2);
+    for (int i = 1; i < s_sim.num_requests; i++) {
+        CHECK(s_sim.requests[i].at_us - s_sim.requests[i - 1].at_us >= REJECT_BACKOFF_US);
+    }
+    CHECK_EQ(conn_policy_tier(), CONN_TIER_FAST);
+
+    // Success with an interval outside the requested range counts the same
+    simulate(trace_idle, duration_ms, CENTRAL_KEEP_FAST);
+    for (int i = 1; i < s_sim.num_requests; i++) {
+        CHECK(s_sim.requests[i].at_us - s_sim.requests[i - 1].at_us >= REJECT_BACKOFF_US);
+    }
+    CHECK_EQ(conn_policy_tier(), CONN_TIER_FAST);
+}
+
+static void test_silent_central(void) {
+    // The request times out after 5 s, the policy tries again rather than waiting forever
+    simulate(trace_idle, 30000, CENTRAL_SILENT);
+    CHECK(s_sim.num_requests >= 2);
+    CHECK(s_sim.requests[1].at_us - s_sim.requests[0].at_us > 5000000);
+}
+
+static void test_idle_override(void) {
+    fake_reset();
+    fake_time_set(1000000);
+    memset(&s_sim, 0, sizeof(s_sim));
+    s_sim.central = CENTRAL_ACCEPT;
+    fake_gap_set_update_hook(gap_update_hook);
+    CHECK_EQ(conn_policy_init(), ESP_OK);
+
+    CHECK_EQ(conn_policy_set_idle(true), ESP_ERR_INVALID_STATE);
+    static const esp_bd_addr_t peer = {1, 2, 3, 4, 5, 6};
+    conn_policy_on_connect(peer);
+    conn_policy_on_params_updated(true, 0x06);
+
+    CHECK_EQ(conn_policy_set_idle(true), ESP_OK);
+    CHECK_EQ(tier_of_request(&s_sim.requests[0]), CONN_TIER_IDLE);
+    conn_policy_on_params_updated(true, s_sim.requests[0].params.min_int);
+    CHECK_EQ(conn_policy_tier(), CONN_TIER_IDLE);
+
+    // Mouse traffic while parked doesn't move the link, only leaving idle does
+    for (int i = 0; i < 2000; i++) {
+        conn_policy_record_report(true);
+        fake_time_advance(1000);
+    }
+    CHECK_EQ(s_sim.num_requests, 1);
+    CHECK_EQ(conn_policy_set_idle(false), ESP_OK);
+    CHECK_EQ(tier_of_request(&s_sim.requests[1]), CONN_TIER_FAST);
+    conn_policy_deinit();
+}
+
+int main(void) {
+    test_gaming();
+    test_typing();
+    test_office();
+    test_idle();
+    test_rejecting_central();
+    test_silent_central();
+    test_idle_override();
+    return 0;
+}
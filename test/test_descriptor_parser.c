@@ -0,0 +1,109 @@
+// Parses every corpus descriptor given on the command line and compares the result with its .golden
+// file next to it. Run with --update to rewrite the golden files after an intended change.
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "idf_fakes.h"
+#include "descriptor_dump.h"
+#include "descriptor_parser.h"
+
+#define MAX_DESCRIPTOR 4096
+
+static char *dump_to_string(const report_map_t *map) {
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    dump_report_map(map, out);
+    fclose(out);
+    return text;
+}
+
+static char *read_text_file(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = calloc(1, size + 1);
+    CHECK(fread(text, 1, size, file) == (size_t)size);
+    fclose(file);
+    return text;
+}
+
+static int check_golden(const char *hex_path, const bool update) {
+    static uint8_t desc[MAX_DESCRIPTOR];
+    const long length = read_hex_file(hex_path, desc, sizeof(desc));
+    if (length < 0) {
+        fprintf(stderr, "%s: can't read descriptor\n", hex_path);
+        return 1;
+    }
+
+    report_map_t map = {0};
+    CHECK_EQ(parse_report_descriptor(desc, length, 0, &map), ESP_OK);
+    char *actual = dump_to_string(&map);
+
+    char golden_path[512];
+    snprintf(golden_path, sizeof(golden_path), "%.*s.golden", (int)(strlen(hex_path) - 4), hex_path);
+
+    int failed = 0;
+    if (update) {
+        FILE *out = fopen(golden_path, "w");
+        CHECK(out != NULL);
+        fputs(actual, out);
+        fclose(out);
+    } else {
+        char *expected = read_text_file(golden_path);
+        if (!expected || strcmp(expected, actual) != 0) {
+            fprintf(stderr, "%s: output differs from %s, got:\n%s", hex_path, golden_path, actual);
+            failed = 1;
+        }
+        free(expected);
+    }
+
+    // The NVS cache must give back exactly what the parser produced
+    if (map.num_reports > 0) {
+        fake_reset();
+        descriptor_parser_init();
+        CHECK_EQ(descriptor_cache_store(0x046d, 0xc08b, desc, length, 0, &map), ESP_OK);
+        descriptor_parser_init();
+
+        report_map_t cached = {0};
+        CHECK(descriptor_cache_load(0x046d, 0xc08b, desc, length, 0, &cached));
+        char *reloaded = dump_to_string(&cached);
+        if (strcmp(reloaded, actual) != 0) {
+            fprintf(stderr, "%s: cached map differs:\n%s", hex_path, reloaded);
+            failed = 1;
+        }
+        free(reloaded);
+        report_map_free(&cached);
+
+        // A different descriptor must not hit the same entry
+        desc[length - 1] ^= 0xFF;
+        CHECK(!descriptor_cache_load(0x046d, 0xc08b, desc, length, 0, &cached));
+    }
+
+    free(actual);
+    report_map_free(&map);
+    return failed;
+}
+
+int main(const int argc, char **argv) {
+    bool update = false;
+    int failed = 0;
+    int checked = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+            continue;
+        }
+        failed += check_golden(argv[i], update);
+        checked++;
+    }
+
+    CHECK(checked > 0);
+    printf("%d descriptors, %d failed\n", checked, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+// The forwarding path must not touch the heap: for every corpus descriptor, reports cycling through
+// all of its report IDs (keyboard + consumer interfaces, vendor reports next to mouse reports) go
+// through the ring and decode_report(), the decode step of usb_hid_host.c, then every route the way
+// hid_bridge.c walks them, with malloc/calloc/realloc/free wrapped and counted.
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "alloc_counter.h"
+#include "descriptor_dump.h"
+#include "descriptor_parser.h"
+#include "report_ring.h"
+
+#define MAX_DESCRIPTOR 4096
+#define REPORTS 100000
+
+// Capture side: copy the transfer into a ring slot
+static void capture(const report_map_t *map, const int index, uint32_t *seed) {
+    ring_report_t *slot = report_ring_acquire();
+    CHECK(slot != NULL);
+    const uint8_t header = map->has_report_ids ? 1 : 0;
+    slot->if_id = 0;
+    slot->length = header + (map->reports[index].total_bits + 7) / 8;
+    CHECK(slot->length <= REPORT_RING_DATA_SIZE);
+    slot->data[0] = map->report_ids[index];
+    for (int i = header; i < slot->length; i++) {
+        slot->data[i] = test_rand(seed);
+    }
+    report_ring_commit();
+}
+
+// Forwarding side: decode and walk the routes, returns something depending on every routed value
+static int64_t forward(report_map_t *map) {
+    const ring_report_t *report = report_ring_peek();
+    CHECK(report != NULL);
+    usb_hid_report_t decoded;
+    CHECK_EQ(decode_report(map, report->data, report->length, &decoded), ESP_OK);
+    CHECK_EQ(decoded.report_id, map->has_report_ids ? report->data[0] : 0);
+
+    const report_info_t *info = decoded.info;
+    int64_t sum = 0;
+    for (uint16_t i = 0; i < info->num_routes; i++) {
+        const usage_route_t *route = &info->routes[i];
+        sum += route->dst * info->values[route->field] + route->base;
+    }
+    report_ring_release();
+    return sum;
+}
+
+// Short reports and undeclared report IDs are refused before anything is decoded
+static void check_rejects(report_map_t *map) {
+    static uint8_t data[REPORT_RING_DATA_SIZE];
+    const uint8_t header = map->has_report_ids ? 1 : 0;
+    usb_hid_report_t decoded;
+
+    for (int i = 0; i < map->num_reports; i++) {
+        const size_t length = header + (map->reports[i].total_bits + 7) / 8;
+        data[0] = map->report_ids[i];
+        if (length > header) {
+            CHECK_EQ(decode_report(map, data, length - 1, &decoded), ESP_ERR_INVALID_SIZE);
+        }
+    }
+
+    if (map->has_report_ids) {
+        for (int id = 1; id <= 255; id++) {
+            data[0] = id;
+            if (report_map_find(map, id) == NULL) {
+                CHECK_EQ(decode_report(map, data, sizeof(data), &decoded), ESP_ERR_NOT_FOUND);
+                break;
+            }
+        }
+    }
+}
+
+static void check_descriptor(const char *path) {
+    static uint8_t desc[MAX_DESCRIPTOR];
+    const long length = read_hex_file(path, desc, sizeof(desc));
+    CHECK(length >= 0);
+
+    // Parsing allocates, once for the whole map
+    report_map_t map = {0};
+    const uint32_t arenas = report_map_get_alloc_count();
+    alloc_counter_start();
+    CHECK_EQ(parse_report_descriptor(desc, length, 0, &map), ESP_OK);
+    CHECK(alloc_counter_stop() > 0);
+    CHECK_EQ(report_map_get_alloc_count(), arenas + (map.num_reports > 0));
+    if (map.num_reports == 0) {
+        return;
+    }
+
+    report_ring_reset();
+    uint32_t seed = 0xA110C;
+    volatile int64_t sink = 0;
+    alloc_counter_start();
+    for (int n = 0; n < REPORTS; n++) {
+        capture(&map, n % map.num_reports, &seed);
+        sink += forward(&map);
+    }
+    const uint32_t calls = alloc_counter_stop();
+    (void)sink;
+
+    if (calls != 0) {
+        fprintf(stderr, "%s: %lu heap calls while forwarding\n", path, (unsigned long)calls);
+        exit(1);
+    }
+    check_rejects(&map);
+    CHECK_EQ(report_map_get_alloc_count(), arenas + 1);
+
+    report_map_free(&map);
+    CHECK_EQ(report_map_get_alloc_count(), arenas + 1);
+}
+
+int main(const int argc, char **argv) {
+    CHECK(argc > 1);
+    for (int i = 1; i < argc; i++) {
+        check_descriptor(argv[i]);
+    }
+    printf("%d descriptors, %d reports each, no heap calls while forwarding\n", argc - 1, REPORTS);
+    return 0;
+}
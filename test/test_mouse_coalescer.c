@@ -0,0 +1,454 @@
+// Unit tests for the mouse coalescer, then a simulator replaying 1000 Hz mouse traces through it the
+// way ble_hid_device.c drives it (report path + flush timer), for each emit period. Prints the
+// notification rate, interval jitter, added latency and the motion left unsent at the end.
+//
+// Besides the generated traces, every file given on the command line is replayed: one row per 1 ms
+// USB report, "dx,dy,buttons", '#' starts a comment (test/corpus/*.csv).
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "mouse_coalescer.h"
+
+#define PERIOD_US 7500
+#define MAX_TRACE_MS 120000
+
+typedef struct {
+    int64_t x;
+    int64_t y;
+    int64_t wheel;
+    int64_t pan;
+} motion_sum_t;
+
+static void add_snapshot(motion_sum_t *sum, const mouse_snapshot_t *s) {
+    sum->x += s->x;
+    sum->y += s->y;
+    sum->wheel += s->wheel;
+    sum->pan += s->pan;
+}
+
+static bool snapshot_has_motion(const mouse_snapshot_t *s) {
+    return s->x || s->y || s->wheel || s->pan;
+}
+
+static void test_button_change_order(void) {
+    mouse_coalescer_t c;
+    mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT];
+    mouse_coalescer_reset(&c);
+
+    // First report goes straight out, the next one is held for the period
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 5, 0, 0, 0, 101000, 101000, PERIOD_US, out), 1);
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 3, -2, 0, 0, 102000, 102000, PERIOD_US, out), 0);
+    CHECK(c.pending);
+
+    // Press with motion: the held motion leaves first with the old buttons, then the press with its own motion
+    CHECK_EQ(mouse_coalescer_add(&c, 1, 4, 1, 0, 0, 103000, 103000, PERIOD_US, out), 2);
+    CHECK_EQ(out[0].buttons, 0);
+    CHECK_EQ(out[0].x, 3);
+    CHECK_EQ(out[0].y, -2);
+    CHECK_EQ(out[0].timestamp_us, 102000);
+    CHECK_EQ(out[1].buttons, 1);
+    CHECK_EQ(out[1].x, 4);
+    CHECK_EQ(out[1].y, 1);
+    CHECK_EQ(out[1].timestamp_us, 103000);
+    CHECK(!c.pending);
+
+    // Release without motion still goes out right away, with nothing pending in front of it
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 0, 0, 0, 0, 104000, 104000, PERIOD_US, out), 1);
+    CHECK_EQ(out[0].buttons, 0);
+    CHECK(!snapshot_has_motion(&out[0]));
+}
+
+static void test_no_empty_notifications(void) {
+    mouse_coalescer_t c;
+    mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT];
+    mouse_coalescer_reset(&c);
+
+    CHECK(!mouse_coalescer_flush(&c, 0, out));
+    for (int64_t t = 0; t < 100000; t += 1000) {
+        CHECK_EQ(mouse_coalescer_add(&c, 0, 0, 0, 0, 0, t, t, PERIOD_US, out), 0);
+    }
+    CHECK(!c.pending);
+
+    // Motion that cancels out within the period leaves nothing to send
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 7, 0, 0, 0, 0, 200000, PERIOD_US, out), 1);
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 3, 0, 0, 0, 0, 201000, PERIOD_US, out), 0);
+    CHECK_EQ(mouse_coalescer_add(&c, 0, -3, 0, 0, 0, 0, 202000, PERIOD_US, out), 0);
+    CHECK(!c.pending);
+    CHECK(!mouse_coalescer_flush(&c, 210000, out));
+}
+
+static void test_period(void) {
+    mouse_coalescer_t c;
+    mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT];
+    mouse_coalescer_reset(&c);
+
+    int64_t last_emit = -PERIOD_US;
+    for (int64_t t = 0; t < 1000000; t += 1000) {
+        if (mouse_coalescer_add(&c, 0, 1, 1, 0, 0, t, t, PERIOD_US, out)) {
+            CHECK(t - last_emit >= PERIOD_US);
+            last_emit = t;
+        }
+    }
+}
+
+// Random small deltas with random button changes and flushes, nothing may be lost or invented
+static void test_small_deltas_preserved(void) {
+    mouse_coalescer_t c;
+    mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT];
+    mouse_coalescer_reset(&c);
+
+    motion_sum_t in = {0};
+    motion_sum_t sent = {0};
+    uint32_t seed = 0x5EED;
+    uint8_t buttons = 0;
+    int64_t now = 0;
+
+    for (int i = 0; i < 3000000; i++) {
+        const uint32_t r = test_rand(&seed);
+        const int32_t x = (int32_t)(r % 7) - 3;
+        const int32_t y = (int32_t)((r >> 3) % 7) - 3;
+        const int32_t wheel = (r >> 6) % 50 == 0 ? (int32_t)((r >> 12) % 3) - 1 : 0;
+        const int32_t pan = (r >> 14) % 200 == 0 ? 1 : 0;
+        if ((r >> 20) % 500 == 0) {
+            buttons ^= 1 << ((r >> 29) % 3);
+        }
+        now += 200 + (r >> 22) % 1600;
+
+        in.x += x;
+        in.y += y;
+        in.wheel += wheel;
+        in.pan += pan;
+
+        const uint8_t previous = c.buttons;
+        const uint8_t n = mouse_coalescer_add(&c, buttons, x, y, wheel, pan, now, now, PERIOD_US, out);
+        for (uint8_t k = 0; k < n; k++) {
+            CHECK(snapshot_has_motion(&out[k]) || out[k].buttons != previous);
+            add_snapshot(&sent, &out[k]);
+        }
+        if ((r >> 9) % 11 == 0 && mouse_coalescer_flush(&c, now, out)) {
+            CHECK(snapshot_has_motion(&out[0]));
+            add_snapshot(&sent, &out[0]);
+        }
+    }
+    while (mouse_coalescer_flush(&c, now, out)) {
+        add_snapshot(&sent, &out[0]);
+    }
+
+    CHECK_EQ(sent.x, in.x);
+    CHECK_EQ(sent.y, in.y);
+    CHECK_EQ(sent.wheel, in.wheel);
+    CHECK_EQ(sent.pan, in.pan);
+}
+
+// Drains the coalescer, every snapshot must move the same way as the input and stay in BLE range
+static motion_sum_t drain_same_sign(mouse_coalescer_t *c, const int sign, uint32_t *snapshots) {
+    motion_sum_t sent = {0};
+    mouse_snapshot_t out;
+    *snapshots = 0;
+    while (mouse_coalescer_flush(c, 0, &out)) {
+        CHECK(out.x * sign >= 0 && out.y * sign >= 0 && out.wheel * sign >= 0 && out.pan * sign >= 0);
+        CHECK(out.x >= -MOUSE_COALESCER_XY_MAX && out.x <= MOUSE_COALESCER_XY_MAX);
+        CHECK(out.wheel >= -MOUSE_COALESCER_WHEEL_MAX && out.wheel <= MOUSE_COALESCER_WHEEL_MAX);
+        add_snapshot(&sent, &out);
+        (*snapshots)++;
+    }
+    return sent;
+}
+
+static void test_extreme_deltas(void) {
+    mouse_coalescer_t c;
+    mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT];
+    uint32_t snapshots;
+
+    // A delta beyond one report is split, not truncated or wrapped
+    mouse_coalescer_reset(&c);
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 100000, -70000, 300, -1000, 1, PERIOD_US, PERIOD_US, out), 1);
+    CHECK_EQ(out[0].x, MOUSE_COALESCER_XY_MAX);
+    CHECK_EQ(out[0].y, -MOUSE_COALESCER_XY_MAX);
+    CHECK_EQ(out[0].wheel, MOUSE_COALESCER_WHEEL_MAX);
+    CHECK_EQ(out[0].pan, -MOUSE_COALESCER_WHEEL_MAX);
+    CHECK(c.pending);
+    motion_sum_t sent = {0};
+    add_snapshot(&sent, &out[0]);
+    while (mouse_coalescer_flush(&c, 0, out)) {
+        add_snapshot(&sent, &out[0]);
+    }
+    CHECK_EQ(sent.x, 100000);
+    CHECK_EQ(sent.y, -70000);
+    CHECK_EQ(sent.wheel, 300);
+    CHECK_EQ(sent.pan, -1000);
+
+    // int32 extremes from a 32-bit field, in both directions
+    for (int sign = -1; sign <= 1; sign += 2) {
+        const int32_t extreme = sign > 0 ? INT32_MAX : INT32_MIN;
+        mouse_coalescer_reset(&c);
+        CHECK_EQ(mouse_coalescer_add(&c, 0, extreme, extreme, 0, 0, 1, 1, PERIOD_US, out), 0);
+        sent = drain_same_sign(&c, sign, &snapshots);
+        CHECK_EQ(sent.x, extreme);
+        CHECK_EQ(sent.y, extreme);
+        CHECK_EQ(snapshots, (llabs((int64_t)extreme) + MOUSE_COALESCER_XY_MAX - 1) / MOUSE_COALESCER_XY_MAX);
+    }
+
+    // A batch of 1000 Hz reports that overflows int32 saturates instead of wrapping to the other side
+    for (int sign = -1; sign <= 1; sign += 2) {
+        mouse_coalescer_reset(&c);
+        for (int i = 0; i < 8; i++) {
+            mouse_coalescer_add(&c, 0, sign * 0x40000000, sign * 12345, sign * 0x40000000, sign, 1, 1, PERIOD_US, out);
+        }
+        CHECK_EQ(c.x, sign > 0 ? INT32_MAX : INT32_MIN);
+        CHECK_EQ(c.y, sign * 8 * 12345);
+        CHECK_EQ(c.wheel, sign > 0 ? INT32_MAX : INT32_MIN);
+        CHECK_EQ(c.pan, sign * 8);
+        drain_same_sign(&c, sign, &snapshots);
+    }
+
+    // Splitting keeps going across button changes: the remainder rides along, never with the wrong sign
+    mouse_coalescer_reset(&c);
+    CHECK_EQ(mouse_coalescer_add(&c, 0, 50000, 0, 0, 0, 1, PERIOD_US, PERIOD_US, out), 1);
+    CHECK_EQ(out[0].x, MOUSE_COALESCER_XY_MAX);
+    CHECK_EQ(mouse_coalescer_add(&c, 1, 50000, 0, 0, 0, 2, PERIOD_US + 1, PERIOD_US, out), 2);
+    CHECK_EQ(out[0].buttons, 0);
+    CHECK_EQ(out[0].x, 50000 - MOUSE_COALESCER_XY_MAX);
+    CHECK_EQ(out[1].buttons, 1);
+    CHECK_EQ(out[1].x, MOUSE_COALESCER_XY_MAX);
+    sent = drain_same_sign(&c, 1, &snapshots);
+    CHECK_EQ(sent.x, 50000 - MOUSE_COALESCER_XY_MAX);
+}
+
+// Trace simulator
+
+typedef struct {
+    const char *name;
+    int32_t (*dx)(int ms);
+    int32_t (*dy)(int ms);
+    uint8_t (*buttons)(int ms);
+    int duration_ms;
+} trace_t;
+
+// Fast flicks: 150 ms bursts peaking at ~120 counts/ms, pauses in between
+static int32_t flick_dx(const int ms) {
+    const int phase = ms % 400;
+    return phase < 150 ? (int32_t)(120 * sin(M_PI * phase / 150.0)) * ((ms / 400) % 2 ? -1 : 1) : 0;
+}
+static int32_t flick_dy(const int ms) {
+    return flick_dx(ms) / 4;
+}
+
+// Slow precise aiming, one count every few reports
+static int32_t aim_dx(const int ms) {
+    return ms % 3 == 0 ? 1 : 0;
+}
+static int32_t aim_dy(const int ms) {
+    return ms % 7 == 0 ? -1 : 0;
+}
+
+// Circles at ~2 turns/s
+static int32_t circle_dx(const int ms) {
+    return (int32_t)lround(12 * cos(2 * M_PI * ms / 500.0));
+}
+static int32_t circle_dy(const int ms) {
+    return (int32_t)lround(12 * sin(2 * M_PI * ms / 500.0));
+}
+
+static uint8_t no_buttons(const int ms) {
+    (void)ms;
+    return 0;
+}
+
+// Drag: button held for 300 ms every 500 ms
+static uint8_t drag_buttons(const int ms) {
+    return ms % 500 < 300 ? 1 : 0;
+}
+
+// Recorded trace, read by the rec_* functions below
+static struct {
+    int32_t dx[MAX_TRACE_MS];
+    int32_t dy[MAX_TRACE_MS];
+    uint8_t buttons[MAX_TRACE_MS];
+    int length;
+} s_recorded;
+
+static int32_t rec_dx(const int ms) {
+    return s_recorded.dx[ms];
+}
+static int32_t rec_dy(const int ms) {
+    return s_recorded.dy[ms];
+}
+static uint8_t rec_buttons(const int ms) {
+    return s_recorded.buttons[ms];
+}
+
+static bool load_trace(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[128];
+    int number = 0;
+    s_recorded.length = 0;
+    while (fgets(line, sizeof(line), file)) {
+        number++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+        int dx;
+        int dy;
+        unsigned buttons;
+        if (sscanf(line, "%d,%d,%u", &dx, &dy, &buttons) != 3 || buttons > 0xFF ||
+            s_recorded.length >= MAX_TRACE_MS) {
+            fprintf(stderr, "%s:%d: expected dx,dy,buttons\n", path, number);
+            fclose(file);
+            return false;
+        }
+        s_recorded.dx[s_recorded.length] = dx;
+        s_recorded.dy[s_recorded.length] = dy;
+        s_recorded.buttons[s_recorded.length] = buttons;
+        s_recorded.length++;
+    }
+    fclose(file);
+    return s_recorded.length > 0;
+}
+
+typedef struct {
+    uint32_t notifications;
+    uint32_t motion_intervals;
+    double interval_sum;
+    double interval_sq_sum;
+    double latency_sum;
+    int64_t latency_max;
+    motion_sum_t in;
+    motion_sum_t sent;
+    int64_t last_motion_emit;
+    int64_t travel; // sum of |dx| + |dy| over all USB reports
+} sim_stats_t;
+
+static void sim_emit(sim_stats_t *stats, const mouse_snapshot_t *s, const int64_t now) {
+    stats->notifications++;
+    add_snapshot(&stats->sent, s);
+    if (!snapshot_has_motion(s)) {
+        return;
+    }
+    if (stats->last_motion_emit >= 0 && now - stats->last_motion_emit < 50000) {
+        const double interval = now - stats->last_motion_emit;
+        stats->motion_intervals++;
+        stats->interval_sum += interval;
+        stats->interval_sq_sum += interval * interval;
+    }
+    stats->last_motion_emit = now;
+    const int64_t latency = now - s->timestamp_us;
+    stats->latency_sum += latency;
+    if (latency > stats->latency_max) {
+        stats->latency_max = latency;
+    }
+}
+
+// Same control flow as ble_hid_device_send_mouse_report() and flush_timer_callback(). USB reports
+// arrive every 1 ms with up to 250 us of scheduling jitter, the timer fires on its deadline.
+static void simulate(const trace_t *trace, const uint32_t period_us) {
+    mouse_coalescer_t c;
+    mouse_coalescer_reset(&c);
+    sim_stats_t stats = {.latency_max = 0, .last_motion_emit = -1};
+    mouse_snapshot_t out[MOUSE_COALESCER_MAX_OUT];
+    int64_t timer_deadline = -1;
+    uint32_t seed = 0x77ACE;
+
+    for (int ms = 0; ms < trace->duration_ms; ms++) {
+        const int64_t now = ms * 1000LL + test_rand(&seed) % 250;
+
+        while (timer_deadline >= 0 && timer_deadline <= now) {
+            const int64_t fired = timer_deadline;
+            timer_deadline = -1;
+            if (mouse_coalescer_flush(&c, fired, out)) {
+                sim_emit(&stats, &out[0], fired);
+                if (c.pending) {
+                    timer_deadline = fired + period_us;
+                }
+            }
+        }
+
+        const int32_t x = trace->dx(ms);
+        const int32_t y = trace->dy(ms);
+        const uint8_t buttons = trace->buttons(ms);
+        stats.in.x += x;
+        stats.travel += llabs(x) + llabs(y);
+        stats.in.y += y;
+
+        const uint8_t n = mouse_coalescer_add(&c, buttons, x, y, 0, 0, now, now, period_us, out);
+        if (n > 0) {
+            timer_deadline = -1;
+        }
+        for (uint8_t k = 0; k < n; k++) {
+            sim_emit(&stats, &out[k], now);
+        }
+        if (c.pending && timer_deadline < 0) {
+            const int64_t next = c.last_emit_us + period_us;
+            timer_deadline = next > now ? next : now;
+        }
+    }
+
+    // Motion still held when the trace ends is what a user would lose if the mouse stopped here
+    const int64_t lost = llabs(stats.in.x - stats.sent.x) + llabs(stats.in.y - stats.sent.y);
+    const double mean = stats.motion_intervals ? stats.interval_sum / stats.motion_intervals : 0;
+    const double jitter = stats.motion_intervals
+                              ? sqrt(stats.interval_sq_sum / stats.motion_intervals - mean * mean)
+                              : 0;
+    printf("%-16s %6.2f ms  %5.0f notif/s  interval %6.2f ms  jitter %5.2f ms  latency avg %5.2f max %5.2f ms"
+           "  unsent at end %lld counts\n",
+           trace->name, period_us / 1000.0, stats.notifications * 1000.0 / trace->duration_ms, mean / 1000.0,
+           jitter / 1000.0, stats.notifications ? stats.latency_sum / stats.notifications / 1000.0 : 0,
+           stats.latency_max / 1000.0, (long long)lost);
+
+    // Nothing beyond one period may be held back, and draining the coalescer gives back the rest
+    CHECK(stats.latency_max <= period_us);
+    while (mouse_coalescer_flush(&c, 0, out)) {
+        add_snapshot(&stats.sent, &out[0]);
+    }
+    CHECK_EQ(stats.sent.x, stats.in.x);
+    CHECK_EQ(stats.sent.y, stats.in.y);
+    CHECK(stats.travel > 0);
+}
+
+// The emit period is the connection interval: conn_policy's fast tier, both ends of normal and the
+// relaxed tier motion can run on until the link speeds up again
+static const uint32_t s_periods[] = {7500, 11250, 15000, 30000};
+#define NUM_PERIODS (sizeof(s_periods) / sizeof(s_periods[0]))
+
+static void run_simulator(void) {
+    static const trace_t traces[] = {
+        {"flick", flick_dx, flick_dy, no_buttons, 10000},
+        {"aim", aim_dx, aim_dy, no_buttons, 10000},
+        {"circle", circle_dx, circle_dy, no_buttons, 10000},
+        {"drag", circle_dx, circle_dy, drag_buttons, 10000},
+    };
+
+    for (size_t p = 0; p < NUM_PERIODS; p++) {
+        for (size_t t = 0; t < sizeof(traces) / sizeof(traces[0]); t++) {
+            simulate(&traces[t], s_periods[p]);
+        }
+    }
+}
+
+static void run_recorded(const char *path) {
+    CHECK(load_trace(path));
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    const trace_t trace = {name, rec_dx, rec_dy, rec_buttons, s_recorded.length};
+    for (size_t p = 0; p < NUM_PERIODS; p++) {
+        simulate(&trace, s_periods[p]);
+    }
+}
+
+int main(const int argc, char **argv) {
+    test_button_change_order();
+    test_no_empty_notifications();
+    test_period();
+    test_small_deltas_preserved();
+    test_extreme_deltas();
+    run_simulator();
+    for (int i = 1; i < argc; i++) {
+        run_recorded(argv[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Total motion through the pointer transform over millions of small deltas must match the ideal
+// (double precision) gain curve to within the Q16.16 table rounding and one carried count, for
+// sensitivities below 100 where the old integer scaling dropped slow movement entirely.
+
+#include <math.h>
+#include <stdint.h>
+#include "test_util.h"
+#include "pointer_transform.h"
+
+#define REPORTS 2000000
+#define KNEE 32 // POINTER_ACCEL_KNEE
+
+static double ideal_gain(const uint32_t counts, const uint16_t sensitivity_pct, const uint16_t acceleration_pct) {
+    const double ramp = counts < KNEE ? counts : KNEE;
+    return sensitivity_pct / 100.0 * (1.0 + acceleration_pct / 100.0 * ramp / KNEE);
+}
+
+typedef struct {
+    int64_t out;
+    double ideal;
+    int64_t travel;
+    int64_t legacy; // x * sensitivity / 100 per report
+} axis_sum_t;
+
+static void feed(axis_sum_t *sum, const int32_t delta, const int32_t out, const uint16_t sensitivity_pct,
+                 const uint16_t acceleration_pct) {
+    sum->out += out;
+    sum->ideal += delta * ideal_gain(delta < 0 ? -delta : delta, sensitivity_pct, acceleration_pct);
+    sum->travel += delta < 0 ? -delta : delta;
+    sum->legacy += delta * sensitivity_pct / 100;
+}
+
+static void check_sum(const axis_sum_t *sum, const char *what) {
+    // Each report's table entry is at most one Q16 step per count low, plus the carry still held
+    const double tolerance = 1.0 + sum->travel / 65536.0;
+    if (fabs(sum->out - sum->ideal) > tolerance) {
+        fprintf(stderr, "%s: out %lld, ideal %.2f, tolerance %.2f\n", what, (long long)sum->out, sum->ideal,
+                tolerance);
+        exit(1);
+    }
+}
+
+// Same-direction creep: one count per report on x, one every third report on y
+static void test_slow_motion(const uint16_t sensitivity_pct, const uint16_t acceleration_pct) {
+    pointer_transform_init(sensitivity_pct, acceleration_pct);
+    axis_sum_t sx = {0};
+    axis_sum_t sy = {0};
+
+    for (int i = 0; i < REPORTS; i++) {
+        int32_t x = 1;
+        int32_t y = i % 3 == 0 ? -1 : 0;
+        pointer_transform_apply(&x, &y);
+        feed(&sx, 1, x, sensitivity_pct, acceleration_pct);
+        feed(&sy, i % 3 == 0 ? -1 : 0, y, sensitivity_pct, acceleration_pct);
+        CHECK(x >= 0 && y <= 0);
+    }
+    check_sum(&sx, "slow x");
+    check_sum(&sy, "slow y");
+    CHECK(sx.out > 0);
+
+    printf("sensitivity %3u%% acceleration %3u%%: slow x %lld counts (ideal %.1f, old scaling %lld)\n",
+           sensitivity_pct, acceleration_pct, (long long)sx.out, sx.ideal, (long long)sx.legacy);
+}
+
+// Small deltas in both directions with the odd larger one, beyond the table too
+static void test_random_motion(const uint16_t sensitivity_pct, const uint16_t acceleration_pct) {
+    pointer_transform_init(sensitivity_pct, acceleration_pct);
+    axis_sum_t sx = {0};
+    axis_sum_t sy = {0};
+    uint32_t seed = 0xACCE1;
+
+    for (int i = 0; i < REPORTS; i++) {
+        const uint32_t r = test_rand(&seed);
+        const int32_t dx = r % 64 == 0 ? (int32_t)(r >> 8) % 400 - 200 : (int32_t)(r % 5) - 2;
+        const int32_t dy = (int32_t)((r >> 3) % 7) - 3;
+        int32_t x = dx;
+        int32_t y = dy;
+        pointer_transform_apply(&x, &y);
+        feed(&sx, dx, x, sensitivity_pct, acceleration_pct);
+        feed(&sy, dy, y, sensitivity_pct, acceleration_pct);
+    }
+    check_sum(&sx, "random x");
+    check_sum(&sy, "random y");
+}
+
+static void test_identity_and_reset(void) {
+    pointer_transform_init(100, 0);
+    int32_t x = INT32_MAX;
+    int32_t y = -12345;
+    pointer_transform_apply(&x, &y);
+    CHECK_EQ(x, INT32_MAX);
+    CHECK_EQ(y, -12345);
+
+    // Half a count is carried, a reset drops it
+    pointer_transform_init(50, 0);
+    x = 1;
+    y = 0;
+    pointer_transform_apply(&x, &y);
+    CHECK_EQ(x, 0);
+    pointer_transform_reset();
+    x = 1;
+    pointer_transform_apply(&x, &y);
+    CHECK_EQ(x, 0);
+    x = 1;
+    pointer_transform_apply(&x, &y);
+    CHECK_EQ(x, 1);
+
+    // Saturates instead of wrapping
+    pointer_transform_init(400, 100);
+    x = INT32_MAX;
+    y = INT32_MIN;
+    pointer_transform_apply(&x, &y);
+    CHECK_EQ(x, INT32_MAX);
+    CHECK_EQ(y, INT32_MIN);
+
+    // Largest gain the API takes, the tail multiply itself would overflow
+    pointer_transform_init(UINT16_MAX, UINT16_MAX);
+    x = INT32_MAX;
+    y = INT32_MIN;
+    pointer_transform_apply(&x, &y);
+    CHECK_EQ(x, INT32_MAX);
+    CHECK_EQ(y, INT32_MIN);
+    x = -200;
+    y = 200;
+    pointer_transform_apply(&x, &y);
+    CHECK(x < -200 && y > 200);
+}
+
+int main(void) {
+    static const uint16_t settings[][2] = {{100, 0}, {50, 0}, {33, 0}, {10, 0}, {99, 0}, {150, 0}, {50, 100}, {75, 40}};
+
+    test_identity_and_reset();
+    for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+        test_slow_motion(settings[i][0], settings[i][1]);
+        test_random_motion(settings[i][0], settings[i][1]);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Synthesized presses from hid_actions.c get their release from one shared timer. Bursts of 1000
+// actions must not touch the heap or create timers, presses of the same report type push their
+// pending release back instead of queueing another one, and every type gets released on time.
+
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "alloc_counter.h"
+#include "idf_fakes.h"
+#include "hid_actions.h"
+
+#define BURST 1000
+#define RELEASE_DELAY_US 7000 // hid_actions.c
+
+static uint32_t releases(void) {
+    return fake_hidd_counts()->releases;
+}
+
+static void press(const int i) {
+    switch (i % 4) {
+        case 0:
+            execute_keyboard_action(0, KC_A + i % 26, i % 3 ? 0 : MOD_SHIFT);
+            break;
+        case 1:
+            execute_mouse_button_action(0, KC_MS_BTN1);
+            break;
+        case 2:
+            execute_consumer_control_action(0, KC_AUDIO_VOL_UP);
+            break;
+        default:
+            execute_system_control_action(0, KC_SYSTEM_WAKE);
+            break;
+    }
+}
+
+// Encoder spin: 1000 mixed presses 100 us apart, all within each other's release delay
+static void test_burst(void) {
+    const int timers = fake_timers_in_use();
+    const uint32_t before = releases();
+
+    alloc_counter_start();
+    for (int i = 0; i < BURST; i++) {
+        press(i);
+        fake_time_advance(100);
+    }
+    CHECK_EQ(alloc_counter_stop(), 0);
+    CHECK_EQ(fake_timers_in_use(), timers);
+
+    // Nothing released mid-burst, then each of the four types exactly once, 7 ms after its last press
+    CHECK_EQ(releases(), before);
+    fake_time_advance(RELEASE_DELAY_US - 500);
+    CHECK_EQ(releases(), before);
+    fake_time_advance(500);
+    CHECK_EQ(releases(), before + 4);
+    fake_time_advance(100000);
+    CHECK_EQ(releases(), before + 4);
+}
+
+// Presses further apart than the release delay each get their own release
+static void test_spaced(void) {
+    const uint32_t before = releases();
+    alloc_counter_start();
+    for (int i = 0; i < BURST; i++) {
+        execute_keyboard_action(0, KC_ENTER, 0);
+        fake_time_advance(RELEASE_DELAY_US);
+        CHECK_EQ(releases(), before + i + 1);
+        fake_time_advance(1000);
+    }
+    CHECK_EQ(alloc_counter_stop(), 0);
+}
+
+// Different types keep their own deadlines
+static void test_interleaved_deadlines(void) {
+    const uint32_t before = releases();
+    execute_keyboard_action(0, KC_B, 0);
+    fake_time_advance(3000);
+    execute_consumer_control_action(0, KC_AUDIO_MUTE);
+    fake_time_advance(RELEASE_DELAY_US - 3000);
+    CHECK_EQ(releases(), before + 1);
+    fake_time_advance(2999);
+    CHECK_EQ(releases(), before + 1);
+    fake_time_advance(1);
+    CHECK_EQ(releases(), before + 2);
+}
+
+int main(void) {
+    fake_reset();
+    fake_time_set(1000000);
+    CHECK_EQ(hid_actions_init(), ESP_OK);
+
+    test_burst();
+    test_spaced();
+    test_interleaved_deadlines();
+    printf("%d-action bursts: no heap calls, no timers created, releases coalesced per report type\n", BURST);
+    return 0;
+}
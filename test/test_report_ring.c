@@ -0,0 +1,133 @@
+// Runs the report ring with the producer and the consumer on two threads. Every report carries its
+// sequence number and a payload derived from it, the consumer checks it sees complete reports in
+// order. A retrying producer must get every report through without gaps, a dropping one must
+// account for every lost report as an overrun.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include "test_util.h"
+#include "report_ring.h"
+
+#define REPORTS 2000000
+
+typedef struct {
+    bool retry;  // producer waits for a free slot instead of dropping the report
+    bool done;
+} stress_t;
+
+static uint8_t payload_byte(const uint32_t seq, const int i) {
+    return (uint8_t)(seq * 31 + i * 7);
+}
+
+static void *producer(void *arg) {
+    stress_t *stress = arg;
+    for (uint32_t seq = 0; seq < REPORTS; seq++) {
+        ring_report_t *slot;
+        while (!(slot = report_ring_acquire()) && stress->retry) {
+            sched_yield();
+        }
+        if (!slot) {
+            continue;
+        }
+        slot->timestamp_us = seq;
+        slot->if_id = seq & 0xFF;
+        slot->length = 1 + seq % REPORT_RING_DATA_SIZE;
+        for (int i = 0; i < slot->length; i++) {
+            slot->data[i] = payload_byte(seq, i);
+        }
+        report_ring_commit();
+    }
+    __atomic_store_n(&stress->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static uint32_t consume(stress_t *stress) {
+    uint32_t consumed = 0;
+    int64_t last_seq = -1;
+    for (;;) {
+        const ring_report_t *report = report_ring_peek();
+        if (!report) {
+            if (__atomic_load_n(&stress->done, __ATOMIC_ACQUIRE) && !report_ring_peek()) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        const uint32_t seq = report->timestamp_us;
+        if (stress->retry) {
+            CHECK_EQ(report->timestamp_us, last_seq + 1);
+        } else {
+            CHECK(report->timestamp_us > last_seq);
+        }
+        CHECK_EQ(report->if_id, seq & 0xFF);
+        CHECK_EQ(report->length, 1 + seq % REPORT_RING_DATA_SIZE);
+        for (int i = 0; i < report->length; i++) {
+            CHECK_EQ(report->data[i], payload_byte(seq, i));
+        }
+        last_seq = report->timestamp_us;
+        report_ring_release();
+        consumed++;
+    }
+    return consumed;
+}
+
+static void run(const bool retry) {
+    report_ring_reset();
+    stress_t stress = {.retry = retry};
+
+    pthread_t thread;
+    CHECK_EQ(pthread_create(&thread, NULL, producer, &stress), 0);
+    const uint32_t consumed = consume(&stress);
+    CHECK_EQ(pthread_join(thread, NULL), 0);
+
+    report_ring_stats_t stats;
+    report_ring_get_stats(&stats);
+    CHECK_EQ(consumed, stats.pushed);
+    if (retry) {
+        CHECK_EQ(stats.pushed, REPORTS);
+    } else {
+        CHECK_EQ(stats.pushed + stats.overruns, REPORTS);
+    }
+    CHECK(stats.high_water >= 1 && stats.high_water <= REPORT_RING_SLOTS);
+    if (stats.overruns > 0) {
+        CHECK_EQ(stats.high_water, REPORT_RING_SLOTS);
+    }
+    printf("%s: %lu pushed, %lu overruns, high water %d/%d\n", retry ? "retrying producer" : "dropping producer",
+           (unsigned long)stats.pushed, (unsigned long)stats.overruns, stats.high_water, REPORT_RING_SLOTS);
+}
+
+static void test_single_thread_edges(void) {
+    report_ring_reset();
+    CHECK(report_ring_peek() == NULL);
+    for (int i = 0; i < REPORT_RING_SLOTS; i++) {
+        ring_report_t *slot = report_ring_acquire();
+        CHECK(slot != NULL);
+        slot->timestamp_us = i;
+        report_ring_commit();
+    }
+    CHECK(report_ring_acquire() == NULL);
+
+    report_ring_stats_t stats;
+    report_ring_get_stats(&stats);
+    CHECK_EQ(stats.overruns, 1);
+    CHECK_EQ(stats.high_water, REPORT_RING_SLOTS);
+
+    for (int i = 0; i < REPORT_RING_SLOTS; i++) {
+        const ring_report_t *report = report_ring_peek();
+        CHECK(report != NULL);
+        CHECK_EQ(report->timestamp_us, i);
+        report_ring_release();
+    }
+    CHECK(report_ring_peek() == NULL);
+    CHECK(report_ring_acquire() != NULL);
+}
+
+int main(void) {
+    test_single_thread_edges();
+    run(false);
+    run(true);
+    return 0;
+}